@@ -0,0 +1,559 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "CreateRagdoll.h"
+#include "CrowdSteering.h"
+#include "ParallelLogic.h"
+#include "RagdollPose.h"
+#include "Ragdolls.h"
+#include "Sample.h"
+#include "SpatialQueries.h"
+#include "ZombieDollsBench.h"
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+URHO3D_DEFINE_APPLICATION_MAIN(ZombieDollsBench);
+
+namespace
+{
+
+/// Frames stepped before timing the crowd, walkers join the steering in their delayed start.
+const unsigned CROWD_WARMUP_FRAMES = 10;
+/// Timed crowd frames per run.
+const unsigned CROWD_FRAMES = 60;
+/// Projectiles spawned per run.
+const unsigned NUM_PROJECTILES = 200;
+/// Bone lookups per zombie and run.
+const unsigned LOOKUPS_PER_ZOMBIE = 100;
+/// Samples of the walk clip per run.
+const unsigned NUM_CLIP_SAMPLES = 1000;
+/// Wall boxes of the occlusion benchmarks.
+const unsigned NUM_OCCLUDERS = 32;
+/// Boxes tested per occlusion run.
+const unsigned NUM_OCCLUSION_TESTS = 10000;
+/// Frames of bone matrices resolved per skinning run.
+const unsigned SKINNING_FRAMES = 10;
+/// Static walls between the crowd and the line of sight target.
+const unsigned NUM_SIGHT_WALLS = 16;
+/// Line of sight batches per run.
+const unsigned SIGHT_BATCHES = 10;
+/// Frames the ragdolls of the spread crowd fall before the line of sight is timed.
+const unsigned SIGHT_RAGDOLL_FRAMES = 30;
+/// Frames of falling ragdolls per run.
+const unsigned RAGDOLL_FRAMES = 60;
+/// Fixed frame time.
+const float BENCH_TIME_STEP = 1.0f / 60.0f;
+
+}
+
+BenchStatistics BenchStatistics::FromSamples(ea::vector<double> samples, unsigned operations)
+{
+	BenchStatistics statistics;
+	statistics.operations_ = operations;
+	if (samples.empty())
+		return statistics;
+
+	ea::sort(samples.begin(), samples.end());
+	statistics.min_ = samples.front();
+	statistics.median_ = samples[samples.size() / 2];
+
+	for (double sample : samples)
+		statistics.mean_ += sample;
+	statistics.mean_ /= samples.size();
+
+	for (double sample : samples)
+		statistics.stdDev_ += (sample - statistics.mean_) * (sample - statistics.mean_);
+	statistics.stdDev_ = std::sqrt(statistics.stdDev_ / samples.size());
+
+	return statistics;
+}
+
+ZombieDollsBench::ZombieDollsBench(Context* context) :
+	Application(context)
+{
+}
+
+void ZombieDollsBench::Setup()
+{
+	engineParameters_[EP_APPLICATION_NAME] = "Monster Dolls Bench";
+	engineParameters_[EP_HEADLESS] = true;
+	engineParameters_[EP_SOUND] = false;
+	engineParameters_[EP_LOG_NAME] = "";
+	engineParameters_[EP_RESOURCE_PATHS] = "Data;CoreData;Cache";
+	engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";..;../..";
+	engineParameters_[EP_AUTOLOAD_PATHS] = "Autoload";
+}
+
+void ZombieDollsBench::Start()
+{
+	Ragdolls::RegisterComponents(context_);
+
+	runs_ = Max(ToUInt(GetArgumentValue("--bench-runs", "10")), 1u);
+	numZombies_ = Max(ToInt(GetArgumentValue("--bench-zombies", "100")), 1);
+
+	PrintLine(Format("{} runs, {} zombies, microseconds per operation", runs_, numZombies_));
+	PrintLine("benchmark,operations,min,median,mean,stddev");
+
+	Report("ragdoll_activation", numZombies_, &ZombieDollsBench::BenchRagdollActivation);
+	Report("limb_reaction", numZombies_, &ZombieDollsBench::BenchLimbReaction);
+	Report("crowd_update_per_walker", numZombies_ * CROWD_FRAMES, &ZombieDollsBench::BenchCrowdUpdate);
+	Report("projectile_spawn", NUM_PROJECTILES, &ZombieDollsBench::BenchProjectileSpawn);
+	Report("bone_lookup", numZombies_ * LOOKUPS_PER_ZOMBIE, &ZombieDollsBench::BenchBoneLookup);
+
+	walkAnimation_ = GetSubsystem<ResourceCache>()->GetResource<Animation>("Models/Jack_Walk.ani");
+	compressedWalk_ = MakeShared<CompressedAnimation>(context_);
+	if (walkAnimation_ && compressedWalk_->Compress(walkAnimation_, AnimationCompressionSettings()))
+	{
+		const unsigned numTracks = compressedWalk_->GetNumTracks();
+		Report("walk_sample_source_per_track", NUM_CLIP_SAMPLES * numTracks, &ZombieDollsBench::BenchSourceSampling);
+		Report("walk_sample_compressed_per_track", NUM_CLIP_SAMPLES * numTracks, &ZombieDollsBench::BenchCompressedSampling);
+		PrintLine(Format("walk clip memory: {} bytes source, {} bytes compressed", walkAnimation_->GetMemoryUse(),
+			compressedWalk_->GetMemoryUse()));
+	}
+
+	Report("crowd_skinning_serial_per_model", numZombies_ * SKINNING_FRAMES, &ZombieDollsBench::BenchSkinningSerial);
+	Report("crowd_skinning_parallel_per_model", numZombies_ * SKINNING_FRAMES, &ZombieDollsBench::BenchSkinningParallel);
+	Report("occlusion_rasterize_per_occluder", NUM_OCCLUDERS, &ZombieDollsBench::BenchOcclusionRasterize);
+	Report("occlusion_test_per_box", NUM_OCCLUSION_TESTS, &ZombieDollsBench::BenchOcclusionTest);
+	Report("line_of_sight_per_ray", numZombies_ * SIGHT_BATCHES, &ZombieDollsBench::BenchLineOfSightRow);
+	Report("line_of_sight_spread_per_ray", numZombies_ * SIGHT_BATCHES, &ZombieDollsBench::BenchLineOfSightSpread);
+	Report("ragdoll_frame_nodes_per_ragdoll", numZombies_ * RAGDOLL_FRAMES, &ZombieDollsBench::BenchRagdollNodes);
+	Report("ragdoll_frame_direct_per_ragdoll", numZombies_ * RAGDOLL_FRAMES, &ZombieDollsBench::BenchRagdollDirect);
+
+	if (numFailedChecks_)
+		PrintLine(Format("{} result checks failed", numFailedChecks_));
+	exitCode_ = numFailedChecks_ ? EXIT_FAILURE : EXIT_SUCCESS;
+	engine_->Exit();
+}
+
+void ZombieDollsBench::Report(const char* name, unsigned operations, double (ZombieDollsBench::*benchmark)())
+{
+	ea::vector<double> samples;
+	for (unsigned i = 0; i < runs_; ++i)
+	{
+		// Same zombie placement in every run
+		SetRandomSeed(i + 1);
+		samples.push_back((this->*benchmark)() / operations);
+	}
+
+	const BenchStatistics statistics = BenchStatistics::FromSamples(samples, operations);
+	PrintLine(Format("{},{},{:.3f},{:.3f},{:.3f},{:.3f}", name, statistics.operations_, statistics.min_,
+		statistics.median_, statistics.mean_, statistics.stdDev_));
+}
+
+SharedPtr<Scene> ZombieDollsBench::CreateScene(int numZombies)
+{
+	auto scene = MakeShared<Scene>(context_);
+	scene->CreateComponent<Octree>();
+	scene->CreateComponent<PhysicsWorld>()->SetInterpolation(false);
+	Ragdolls::CreateFloor(scene);
+	scene->CreateComponent<ParallelLogicPhase>();
+
+	auto* steering = scene->CreateComponent<CrowdSteering>();
+	Node* target = scene->CreateChild("Target");
+	target->SetPosition(Vector3(0.0f, 0.0f, -20.0f));
+	steering->SetTarget(target);
+
+	Node* zombiesNode = scene->CreateChild("Zombie");
+	Ragdolls::CreateZombies(zombiesNode, numZombies, nullptr);
+	return scene;
+}
+
+double ZombieDollsBench::BenchRagdollActivation()
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+
+	ea::vector<CreateRagdoll*> triggers;
+	scene->GetComponents<CreateRagdoll>(triggers, true);
+
+	HiresTimer timer;
+	for (CreateRagdoll* trigger : triggers)
+		trigger->Activate();
+	return (double)timer.GetUSec(false);
+}
+
+double ZombieDollsBench::BenchLimbReaction()
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+
+	ea::vector<CreateRagdoll*> triggers;
+	scene->GetComponents<CreateRagdoll>(triggers, true);
+
+	// A first hit on the forearm is not lethal, only the arm chain gets physical
+	ea::vector<Vector3> positions;
+	for (CreateRagdoll* trigger : triggers)
+	{
+		Node* forearm = trigger->GetNode()->GetChild("Bip01_L_Forearm", true);
+		positions.push_back(forearm ? forearm->GetWorldPosition() : trigger->GetNode()->GetWorldPosition());
+	}
+
+	HiresTimer timer;
+	for (unsigned i = 0; i < triggers.size(); ++i)
+		triggers[i]->Hit(positions[i], Vector3::RIGHT);
+	return (double)timer.GetUSec(false);
+}
+
+double ZombieDollsBench::BenchCrowdUpdate()
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+	auto* steering = scene->GetComponent<CrowdSteering>();
+
+	for (unsigned i = 0; i < CROWD_WARMUP_FRAMES; ++i)
+		scene->Update(BENCH_TIME_STEP);
+
+	// The steering times itself, the rest of the scene update is not part of this path
+	long long total = 0;
+	for (unsigned i = 0; i < CROWD_FRAMES; ++i)
+	{
+		scene->Update(BENCH_TIME_STEP);
+		total += steering->GetGridBuildTime() + steering->GetQueryTime();
+	}
+	return (double)total;
+}
+
+double ZombieDollsBench::BenchProjectileSpawn()
+{
+	SharedPtr<Scene> scene = CreateScene(0);
+
+	HiresTimer timer;
+	for (unsigned i = 0; i < NUM_PROJECTILES; ++i)
+		Ragdolls::SpawnProjectile(scene, Vector3(i * 0.5f, 2.0f, 0.0f), Quaternion::IDENTITY);
+	return (double)timer.GetUSec(false);
+}
+
+double ZombieDollsBench::BenchBoneLookup()
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+	const ea::vector<SharedPtr<Node> >& zombies = scene->GetChild("Zombie")->GetChildren();
+
+	// Forearms are deep in the hierarchy, the same search the ragdoll does for every bone
+	unsigned found = 0;
+	HiresTimer timer;
+	for (unsigned i = 0; i < LOOKUPS_PER_ZOMBIE; ++i)
+	{
+		for (Node* zombie : zombies)
+			found += zombie->GetChild(i & 1 ? "Bip01_L_Forearm" : "Bip01_R_Forearm", true) != nullptr;
+	}
+	const long long time = timer.GetUSec(false);
+
+	if (found != zombies.size() * LOOKUPS_PER_ZOMBIE)
+		URHO3D_LOGWARNING("Bone lookup found {} of {} bones", found, zombies.size() * LOOKUPS_PER_ZOMBIE);
+	return (double)time;
+}
+
+double ZombieDollsBench::BenchSourceSampling()
+{
+	const float length = walkAnimation_->GetLength();
+	ea::vector<const AnimationTrack*> tracks;
+	for (const auto& pair : walkAnimation_->GetTracks())
+		tracks.push_back(&pair.second);
+	ea::vector<Vector3> positions(tracks.size());
+	ea::vector<Quaternion> rotations(tracks.size());
+	ea::vector<Vector3> scales(tracks.size());
+
+	HiresTimer timer;
+	for (unsigned i = 0; i < NUM_CLIP_SAMPLES; ++i)
+	{
+		const float time = length * i / NUM_CLIP_SAMPLES;
+		for (unsigned j = 0; j < tracks.size(); ++j)
+		{
+			// The keyframe search and interpolation AnimationState does for every track
+			const AnimationTrack& track = *tracks[j];
+			unsigned frame = 0;
+			track.GetKeyFrameIndex(time, frame);
+			const AnimationKeyFrame& keyFrame = *track.GetKeyFrame(frame);
+			const AnimationKeyFrame& nextKeyFrame = *track.GetKeyFrame(Min(frame + 1, track.GetNumKeyFrames() - 1));
+			const float span = nextKeyFrame.time_ - keyFrame.time_;
+			const float t = span > 0.0f ? (time - keyFrame.time_) / span : 0.0f;
+			positions[j] = keyFrame.position_.Lerp(nextKeyFrame.position_, t);
+			rotations[j] = keyFrame.rotation_.Slerp(nextKeyFrame.rotation_, t);
+			scales[j] = keyFrame.scale_.Lerp(nextKeyFrame.scale_, t);
+		}
+	}
+	return (double)timer.GetUSec(false);
+}
+
+double ZombieDollsBench::BenchCompressedSampling()
+{
+	const float length = compressedWalk_->GetLength();
+	CompressedPose pose;
+
+	HiresTimer timer;
+	for (unsigned i = 0; i < NUM_CLIP_SAMPLES; ++i)
+		compressedWalk_->Sample(length * i / NUM_CLIP_SAMPLES, pose);
+	return (double)timer.GetUSec(false);
+}
+
+double ZombieDollsBench::BenchOcclusionRasterize()
+{
+	// Camera at the origin looking along +Z at a ring of walls, 16:9 at 60 degrees
+	auto cameraNode = MakeShared<Node>(context_);
+	auto* camera = cameraNode->CreateComponent<Camera>();
+	camera->SetAspectRatio(16.0f / 9.0f);
+	camera->SetFov(60.0f);
+
+	occlusionBuffer_.SetSize(256, 128);
+	occlusionBuffer_.Clear(camera->GetProjection() * camera->GetView(), camera->GetNearClip());
+
+	HiresTimer timer;
+	for (unsigned i = 0; i < NUM_OCCLUDERS; ++i)
+	{
+		const float angle = -60.0f + 120.0f * i / NUM_OCCLUDERS;
+		const Matrix3x4 transform(Quaternion(angle, Vector3::UP) * Vector3(0.0f, 0.0f, 15.0f), Quaternion(angle,
+			Vector3::UP), Vector3(3.0f, 4.0f, 0.5f));
+		occlusionBuffer_.AddOccluder(transform, BoundingBox(-0.5f, 0.5f));
+	}
+	return (double)timer.GetUSec(false);
+}
+
+double ZombieDollsBench::BenchOcclusionTest()
+{
+	BenchOcclusionRasterize();
+
+	// Zombie-sized boxes scattered in front of and behind the walls
+	unsigned numVisible = 0;
+	HiresTimer timer;
+	for (unsigned i = 0; i < NUM_OCCLUSION_TESTS; ++i)
+	{
+		const float angle = -60.0f + 120.0f * (i % 97) / 97.0f;
+		const Vector3 center = Quaternion(angle, Vector3::UP) * Vector3(0.0f, 1.0f, 5.0f + (i % 23));
+		numVisible += occlusionBuffer_.IsVisible(BoundingBox(center - Vector3(0.4f, 1.0f, 0.4f),
+			center + Vector3(0.4f, 1.0f, 0.4f)));
+	}
+	const long long time = timer.GetUSec(false);
+
+	URHO3D_LOGDEBUG("{} of {} boxes visible", numVisible, NUM_OCCLUSION_TESTS);
+
+	// The wall straight ahead spans 3 x 4 units at 15 units: a box behind it is hidden, boxes in front of it and
+	// above it are not
+	const Vector3 boxHalfSize(0.4f, 1.0f, 0.4f);
+	const Vector3 hiddenCenter(0.0f, 0.0f, 20.0f);
+	const Vector3 visibleCenters[] = { Vector3(0.0f, 0.0f, 8.0f), Vector3(0.0f, 5.0f, 20.0f) };
+	bool correct = !occlusionBuffer_.IsVisible(BoundingBox(hiddenCenter - boxHalfSize, hiddenCenter + boxHalfSize));
+	for (const Vector3& center : visibleCenters)
+		correct &= occlusionBuffer_.IsVisible(BoundingBox(center - boxHalfSize, center + boxHalfSize));
+	if (!correct)
+	{
+		URHO3D_LOGWARNING("Occlusion test misclassifies boxes in front of, behind or above a wall");
+		++numFailedChecks_;
+	}
+
+	return (double)time;
+}
+
+double ZombieDollsBench::BenchSkinningSerial()
+{
+	return BenchSkinning(false);
+}
+
+double ZombieDollsBench::BenchSkinningParallel()
+{
+	return BenchSkinning(true);
+}
+
+double ZombieDollsBench::BenchSkinning(bool parallel)
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+	Node* zombiesNode = scene->GetChild("Zombie");
+	auto* skinning = scene->CreateComponent<CrowdSkinning>();
+	skinning->SetTargets(zombiesNode);
+	skinning->SetParallel(parallel);
+
+	// Dirty bones as an animation update would, outside the timed part
+	long long total = 0;
+	for (unsigned i = 0; i < SKINNING_FRAMES; ++i)
+	{
+		zombiesNode->MarkDirty();
+		skinning->Update();
+		total += skinning->GetUpdateTime();
+	}
+
+	// Both modes run the same arithmetic, the parallel bone transforms must match the serial ones exactly
+	if (parallel)
+	{
+		auto getBoneTransforms = [skinning]()
+		{
+			ea::vector<Matrix3x4> transforms;
+			for (AnimatedModel* model : skinning->GetModels())
+			{
+				const Skeleton& skeleton = model->GetSkeleton();
+				for (unsigned i = 0; i < skeleton.GetNumBones(); ++i)
+				{
+					Node* boneNode = skeleton.GetBone(i)->node_;
+					transforms.push_back(boneNode ? boneNode->GetWorldTransform() : Matrix3x4::IDENTITY);
+				}
+			}
+			return transforms;
+		};
+
+		const ea::vector<Matrix3x4> transforms = getBoneTransforms();
+		skinning->SetParallel(false);
+		zombiesNode->MarkDirty();
+		skinning->Update();
+		const ea::vector<Matrix3x4> serialTransforms = getBoneTransforms();
+
+		unsigned mismatches = transforms.size() != serialTransforms.size();
+		for (unsigned i = 0; i < transforms.size() && i < serialTransforms.size(); ++i)
+			mismatches += transforms[i] != serialTransforms[i];
+		if (mismatches)
+		{
+			URHO3D_LOGWARNING("Parallel crowd skinning differs from serial in {} bone transforms", mismatches);
+			++numFailedChecks_;
+		}
+	}
+
+	return (double)total;
+}
+
+double ZombieDollsBench::BenchLineOfSightRow()
+{
+	return BenchLineOfSight(false);
+}
+
+double ZombieDollsBench::BenchLineOfSightSpread()
+{
+	return BenchLineOfSight(true);
+}
+
+double ZombieDollsBench::BenchLineOfSight(bool spread)
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+	auto* queries = scene->CreateComponent<SpatialQueries>();
+	Node* zombiesNode = scene->GetChild("Zombie");
+
+	if (spread)
+	{
+		// The crowd scattered over the arena with every other zombie down as a ragdoll, whose bones lie all over
+		// the area the rays cross
+		const BoundingBox& arena = Ragdolls::GetArenaBounds();
+		for (Node* zombie : zombiesNode->GetChildren())
+			zombie->SetPosition(Vector3(Random(arena.min_.x_, arena.max_.x_), 0.0f, Random(-10.0f, arena.max_.z_)));
+
+		ea::vector<CreateRagdoll*> triggers;
+		scene->GetComponents<CreateRagdoll>(triggers, true);
+		for (unsigned i = 0; i < triggers.size(); i += 2)
+			triggers[i]->Activate();
+		for (unsigned i = 0; i < SIGHT_RAGDOLL_FRAMES; ++i)
+			scene->Update(BENCH_TIME_STEP);
+	}
+
+	// A row of static walls between the crowd and the target hides part of it
+	for (unsigned i = 0; i < NUM_SIGHT_WALLS; ++i)
+	{
+		Node* wallNode = scene->CreateChild("Wall");
+		wallNode->SetPosition(Vector3(-30.0f + 60.0f * i / NUM_SIGHT_WALLS, 1.5f, 5.0f));
+		wallNode->SetScale(Vector3(2.0f, 3.0f, 0.5f));
+		wallNode->CreateComponent<RigidBody>();
+		wallNode->CreateComponent<CollisionShape>()->SetBox(Vector3::ONE);
+	}
+
+	const Vector3 target(0.0f, 2.0f, -20.0f);
+	unsigned numBlocked = 0;
+	long long total = 0;
+	for (unsigned batch = 0; batch < SIGHT_BATCHES; ++batch)
+	{
+		ea::vector<QueryRay> rays;
+		for (Node* zombie : zombiesNode->GetChildren())
+			rays.push_back(QueryRay{ zombie->GetWorldPosition() + Vector3(0.0f, 1.6f, 0.0f), target });
+
+		HiresTimer timer;
+		queries->CastRays(ea::move(rays), M_MAX_UNSIGNED & ~ZOMBIE_TRIGGER_LAYER,
+			[&numBlocked](const ea::vector<PhysicsRaycastResult>& results)
+		{
+			for (const PhysicsRaycastResult& result : results)
+				numBlocked += result.body_ != nullptr;
+		});
+		queries->Resolve();
+		total += timer.GetUSec(false);
+	}
+
+	URHO3D_LOGDEBUG("{} of {} rays blocked", numBlocked, numZombies_ * SIGHT_BATCHES);
+	return (double)total;
+}
+
+double ZombieDollsBench::BenchRagdollNodes()
+{
+	return BenchRagdollFrames(false);
+}
+
+double ZombieDollsBench::BenchRagdollDirect()
+{
+	return BenchRagdollFrames(true);
+}
+
+double ZombieDollsBench::BenchRagdollFrames(bool direct)
+{
+	SharedPtr<Scene> scene = CreateScene(numZombies_);
+
+	ea::vector<CreateRagdoll*> triggers;
+	scene->GetComponents<CreateRagdoll>(triggers, true);
+	for (CreateRagdoll* trigger : triggers)
+		trigger->Activate();
+
+	// Without the direct pose every body sets its bone node in the physics step
+	ea::vector<RagdollPose*> poses;
+	scene->GetComponents<RagdollPose>(poses, true);
+	if (!direct)
+	{
+		for (RagdollPose* pose : poses)
+			pose->Remove();
+	}
+
+	ea::vector<AnimatedModel*> models;
+	scene->GetComponents<AnimatedModel>(models, true);
+
+	// Every frame also resolves the bone world transforms, as the skinning update of a rendered ragdoll does
+	HiresTimer timer;
+	for (unsigned frame = 0; frame < RAGDOLL_FRAMES; ++frame)
+	{
+		scene->Update(BENCH_TIME_STEP);
+		for (AnimatedModel* model : models)
+		{
+			const Skeleton& skeleton = model->GetSkeleton();
+			for (unsigned i = 0; i < skeleton.GetNumBones(); ++i)
+			{
+				if (Node* boneNode = skeleton.GetBone(i)->node_)
+					boneNode->GetWorldTransform();
+			}
+		}
+	}
+	return (double)timer.GetUSec(false);
+}
@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "CompressedAnimation.h"
+#include "CrowdSkinning.h"
+#include "OcclusionDepthBuffer.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Cost of one operation over repeated runs, in microseconds.
+	struct BenchStatistics
+	{
+		/// Fastest run.
+		double min_ = 0.0;
+		/// Median run.
+		double median_ = 0.0;
+		/// Mean of the runs.
+		double mean_ = 0.0;
+		/// Standard deviation of the runs.
+		double stdDev_ = 0.0;
+		/// Operations per run.
+		unsigned operations_ = 0;
+
+		/// Compute from per-operation costs of every run.
+		static BenchStatistics FromSamples(ea::vector<double> samples, unsigned operations);
+	};
+
+	/// Microbenchmarks of the gameplay hot paths on a headless engine. Every benchmark builds a fresh scene per
+	/// run, times only the operation itself and reports its cost per operation across the runs. Occlusion and
+	/// parallel skinning results are checked as well, a wrong one makes the process exit with failure.
+	class ZombieDollsBench : public Application
+	{
+		URHO3D_OBJECT(ZombieDollsBench, Application);
+
+	public:
+		/// Construct.
+		explicit ZombieDollsBench(Context* context);
+
+		/// Setup before engine initialization. Runs headless without sound.
+		void Setup() override;
+		/// Run the benchmarks and exit.
+		void Start() override;
+
+	private:
+		/// Create a scene with floor, crowd steering and a row of zombies.
+		SharedPtr<Scene> CreateScene(int numZombies);
+		/// Time turning every zombie into a ragdoll.
+		double BenchRagdollActivation();
+		/// Time a non-lethal hit on every zombie.
+		double BenchLimbReaction();
+		/// Time the crowd steering update per walker.
+		double BenchCrowdUpdate();
+		/// Time spawning projectiles.
+		double BenchProjectileSpawn();
+		/// Time finding a bone node by name.
+		double BenchBoneLookup();
+		/// Time sampling the walk clip from its source keyframes.
+		double BenchSourceSampling();
+		/// Time sampling the cooked walk clip.
+		double BenchCompressedSampling();
+		/// Time rasterizing synthetic occluder boxes.
+		double BenchOcclusionRasterize();
+		/// Time testing boxes against the synthetic occluders.
+		double BenchOcclusionTest();
+		/// Time resolving crowd bone transforms on the main thread.
+		double BenchSkinningSerial();
+		/// Time resolving crowd bone transforms on the work queue.
+		double BenchSkinningParallel();
+		/// Time resolving crowd bone transforms over a few frames, checking parallel results against serial ones.
+		double BenchSkinning(bool parallel);
+		/// Time batched line of sight rays from a row of zombies past a row of walls.
+		double BenchLineOfSightRow();
+		/// Time batched line of sight rays from zombies spread over the arena among ragdolls, past a row of walls.
+		double BenchLineOfSightSpread();
+		/// Time batched line of sight rays from every zombie past a row of walls, optionally from a crowd spread
+		/// over the arena with half of it down as ragdolls.
+		double BenchLineOfSight(bool spread);
+		/// Time frames of falling ragdolls whose bodies set the bone nodes.
+		double BenchRagdollNodes();
+		/// Time frames of falling ragdolls posed directly from their bodies.
+		double BenchRagdollDirect();
+		/// Time physics frames of falling ragdolls and resolving their bone transforms.
+		double BenchRagdollFrames(bool direct);
+		/// Run a benchmark repeatedly and print its statistics.
+		void Report(const char* name, unsigned operations, double (ZombieDollsBench::*benchmark)());
+
+		/// Runs per benchmark.
+		unsigned runs_ = 10;
+		/// Zombies per scene.
+		int numZombies_ = 100;
+		/// Walk clip.
+		SharedPtr<Animation> walkAnimation_;
+		/// Walk clip cooked with the default tolerances.
+		SharedPtr<CompressedAnimation> compressedWalk_;
+		/// Depth buffer of the occlusion benchmarks.
+		OcclusionDepthBuffer occlusionBuffer_;
+		/// Result checks that failed, the process exits with failure if any did.
+		unsigned numFailedChecks_ = 0;
+	};
+}
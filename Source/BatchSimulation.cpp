@@ -0,0 +1,251 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#include "BatchSimulation.h"
+
+#include <Urho3D/DebugNew.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace MonsterDolls;
+
+BatchSimulation::BatchSimulation(Context* context) :
+	Object(context)
+{
+}
+
+bool BatchSimulation::IsRequested(const StringVector& args)
+{
+	for (const ea::string& arg : args)
+	{
+		if (arg == "--batch" || arg == "--batch-worker")
+			return true;
+	}
+	return false;
+}
+
+bool BatchSimulation::ParseArguments(const StringVector& args)
+{
+	bool requested = false;
+
+	for (unsigned i = 0; i + 1 < args.size(); ++i)
+	{
+		const ea::string& arg = args[i];
+		const ea::string& value = args[i + 1];
+
+		if (arg == "--batch")
+		{
+			outputFileName_ = value;
+			requested = true;
+		}
+		else if (arg == "--batch-worker")
+		{
+			workerIndex_ = ToUInt(value);
+			requested = true;
+		}
+		else if (arg == "--batch-output")
+			outputFileName_ = value;
+		else if (arg == "--batch-repeats")
+			repeats_ = Max(ToUInt(value), 1u);
+		else if (arg == "--batch-jobs")
+			jobs_ = ToUInt(value);
+		else if (arg == "--batch-seed")
+			seed_ = ToUInt(value);
+		else if (arg == "--batch-duration")
+			parameters_.duration_ = ToFloat(value);
+		else if (arg == "--batch-zombies")
+		{
+			for (const ea::string& count : value.split(','))
+				zombieCounts_.push_back(ToInt(count));
+		}
+		else if (arg == "--batch-interval")
+		{
+			for (const ea::string& interval : value.split(','))
+				shotIntervals_.push_back(ToFloat(interval));
+		}
+		else
+			continue;
+
+		++i;
+	}
+
+	// Workers get the same command line, so every run fires with the same bot
+	parameters_.bot_ = ShooterBotProfile::FromArguments(parameters_.botProfile_);
+
+	if (zombieCounts_.empty())
+		zombieCounts_.push_back(parameters_.numZombies_);
+	if (shotIntervals_.empty())
+		shotIntervals_.push_back(parameters_.shotInterval_);
+
+	return requested;
+}
+
+int BatchSimulation::Run()
+{
+	CreateRuns();
+	return workerIndex_ == M_MAX_UNSIGNED ? RunSweep() : RunWorker();
+}
+
+void BatchSimulation::CreateRuns()
+{
+	runs_.clear();
+
+	for (int zombies : zombieCounts_)
+	{
+		for (float interval : shotIntervals_)
+		{
+			for (unsigned repeat = 0; repeat < repeats_; ++repeat)
+			{
+				BatchRun run;
+				run.index_ = runs_.size();
+				run.parameters_ = parameters_;
+				run.parameters_.seed_ = seed_ + run.index_;
+				run.parameters_.numZombies_ = zombies;
+				run.parameters_.shotInterval_ = interval;
+				runs_.push_back(run);
+			}
+		}
+	}
+}
+
+int BatchSimulation::RunSweep()
+{
+	if (outputFileName_.empty())
+	{
+		URHO3D_LOGERROR("Batch simulation needs a result file name");
+		return EXIT_FAILURE;
+	}
+
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	const ea::string programFileName = fileSystem->GetProgramFileName();
+	const unsigned numJobs = Clamp(jobs_ ? jobs_ : GetNumLogicalCPUs(), 1u, (unsigned)runs_.size());
+
+	URHO3D_LOGINFO("Batch simulation of {} runs on {} workers", runs_.size(), numJobs);
+
+	HiresTimer timer;
+
+	// Worker threads only wait for their child processes, so the scenes themselves never share a main thread
+	std::atomic<unsigned> nextRun{ 0 };
+	ea::vector<std::thread> workers;
+	for (unsigned i = 0; i < numJobs; ++i)
+	{
+		workers.emplace_back([&]()
+		{
+			for (unsigned index = nextRun++; index < runs_.size(); index = nextRun++)
+			{
+				BatchRun& run = runs_[index];
+				run.exitCode_ = fileSystem->SystemRun(programFileName, GetWorkerArguments(run));
+			}
+		});
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+
+	// Merge the per run lines into a single result file
+	File output(context_, outputFileName_, FILE_WRITE);
+	if (!output.IsOpen())
+	{
+		URHO3D_LOGERROR("Could not open batch result file " + outputFileName_);
+		return EXIT_FAILURE;
+	}
+
+	output.WriteLine("run,seed,zombies,interval,duration,exit_code," + ScenarioMetrics::GetCSVHeader());
+
+	unsigned numFailed = 0;
+	for (const BatchRun& run : runs_)
+	{
+		const ea::string runFileName = GetRunFileName(run.index_);
+
+		ea::string metrics;
+		if (run.exitCode_ == 0 && fileSystem->FileExists(runFileName))
+		{
+			File runFile(context_, runFileName, FILE_READ);
+			metrics = runFile.ReadLine();
+			runFile.Close();
+			fileSystem->Delete(runFileName);
+		}
+		else
+			++numFailed;
+
+		output.WriteLine(Format("{},{},{},{:.3f},{:.1f},{},{}", run.index_, run.parameters_.seed_,
+			run.parameters_.numZombies_, run.parameters_.shotInterval_, run.parameters_.duration_, run.exitCode_,
+			metrics));
+	}
+
+	URHO3D_LOGINFO("Batch simulation finished in {:.1f} s, {} of {} runs failed", timer.GetUSec(false) / 1000000.0f,
+		numFailed, runs_.size());
+
+	return numFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int BatchSimulation::RunWorker()
+{
+	if (workerIndex_ >= runs_.size())
+	{
+		URHO3D_LOGERROR("Batch worker index {} is out of range", workerIndex_);
+		return EXIT_FAILURE;
+	}
+
+	const BatchRun& run = runs_[workerIndex_];
+
+	auto scenario = MakeShared<HeadlessScenario>(context_);
+	scenario->Create(run.parameters_);
+	scenario->Run();
+
+	File runFile(context_, GetRunFileName(run.index_), FILE_WRITE);
+	if (!runFile.IsOpen())
+		return EXIT_FAILURE;
+
+	runFile.WriteLine(scenario->GetMetrics().ToCSV());
+	return EXIT_SUCCESS;
+}
+
+StringVector BatchSimulation::GetWorkerArguments(const BatchRun& run) const
+{
+	// Workers rebuild the same run list, so they only need the sweep definition and their index
+	StringVector args = GetArguments();
+	for (unsigned i = 0; i < args.size(); ++i)
+	{
+		if (args[i] == "--batch")
+		{
+			args[i] = "--batch-output";
+			break;
+		}
+	}
+
+	args.push_back("--batch-worker");
+	args.push_back(ea::to_string(run.index_));
+	return args;
+}
+
+ea::string BatchSimulation::GetRunFileName(unsigned index) const
+{
+	return Format("{}.run{}", outputFileName_, index);
+}
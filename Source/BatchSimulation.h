@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "HeadlessScenario.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Command line driven parameter sweep over headless scenarios.
+	///     --batch <file.csv>          run the sweep and write all metrics into one file
+	///     --batch-repeats <n>         runs per parameter combination, each with its own seed
+	///     --batch-jobs <n>            concurrent runs, defaults to the number of logical CPUs
+	///     --batch-zombies <a,b,...>   zombie counts to sweep
+	///     --batch-interval <a,b,...>  shot intervals to sweep
+	///     --batch-duration <seconds>  simulated length of each run
+	///     --batch-seed <n>            first seed
+	///     --bot <name>                fire with the shooter bot and its options instead of the scripted shots
+	/// Every run is executed by a child process started with --batch-worker, so each scene owns its
+	/// engine, physics world and main thread.
+	class BatchSimulation : public Object
+	{
+		URHO3D_OBJECT(BatchSimulation, Object);
+
+	public:
+		/// Construct.
+		explicit BatchSimulation(Context* context);
+
+		/// Return whether the command line asks for a batch or a worker run.
+		static bool IsRequested(const StringVector& args);
+		/// Parse the command line. Return false if it is not a batch command line.
+		bool ParseArguments(const StringVector& args);
+		/// Run the sweep or the single worker run. Return process exit code.
+		int Run();
+
+	private:
+		/// Single run of the sweep.
+		struct BatchRun
+		{
+			/// Run index.
+			unsigned index_;
+			/// Scenario parameters.
+			ScenarioParameters parameters_;
+			/// Worker exit code.
+			int exitCode_ = -1;
+		};
+
+		/// Expand the parameter lists into runs.
+		void CreateRuns();
+		/// Execute all runs in worker processes and merge the results.
+		int RunSweep();
+		/// Execute a single scenario in this process and write its result line.
+		int RunWorker();
+		/// Return worker process arguments for a run.
+		StringVector GetWorkerArguments(const BatchRun& run) const;
+		/// Return per run result file name.
+		ea::string GetRunFileName(unsigned index) const;
+
+		/// Result file.
+		ea::string outputFileName_;
+		/// Runs per parameter combination.
+		unsigned repeats_ = 1;
+		/// Concurrent worker processes.
+		unsigned jobs_ = 0;
+		/// First seed.
+		unsigned seed_ = 1;
+		/// Zombie counts to sweep.
+		ea::vector<int> zombieCounts_;
+		/// Shot intervals to sweep.
+		ea::vector<float> shotIntervals_;
+		/// Template for the swept parameters.
+		ScenarioParameters parameters_;
+		/// Runs of the sweep.
+		ea::vector<BatchRun> runs_;
+		/// Index of the run executed by this worker process, or M_MAX_UNSIGNED for the coordinator.
+		unsigned workerIndex_ = M_MAX_UNSIGNED;
+	};
+}
@@ -0,0 +1,297 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Terrain.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/Image.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+
+#include "ChunkedTerrain.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Wavelengths of the generated hills in world units.
+const float HILL_WAVELENGTH = 60.0f;
+const float RIDGE_WAVELENGTH = 23.0f;
+
+}
+
+ChunkedTerrain::ChunkedTerrain(Context* context) :
+	Component(context)
+{
+}
+
+void ChunkedTerrain::OnSceneSet(Scene* scene)
+{
+	if (scene)
+	{
+		if (auto* physicsWorld = scene->GetComponent<PhysicsWorld>())
+			SubscribeToEvent(physicsWorld, E_PHYSICSPRESTEP, URHO3D_HANDLER(ChunkedTerrain, HandlePhysicsPreStep));
+	}
+	else
+		UnsubscribeFromEvent(E_PHYSICSPRESTEP);
+}
+
+void ChunkedTerrain::Create(unsigned numChunks, unsigned chunkCells, float cellSize, float maxHeight, Image* heightMap)
+{
+	for (Chunk& chunk : chunks_)
+		chunk.node_->Remove();
+	chunks_.clear();
+	collisionChunks_.clear();
+
+	numChunks_ = Max(numChunks, 1u);
+	chunkCells_ = Clamp(NextPowerOfTwo(chunkCells), 4u, 128u);
+	cellSize_ = Max(cellSize, 0.01f);
+	gridSize_ = numChunks_ * chunkCells_ + 1;
+
+	const float halfSize = 0.5f * numChunks_ * chunkCells_ * cellSize_;
+	bounds_ = BoundingBox(Vector3(-halfSize, 0.0f, -halfSize), Vector3(halfSize, maxHeight, halfSize));
+
+	GenerateHeights(Max(maxHeight, 0.0f), heightMap);
+
+	chunks_.clear();
+	chunks_.resize(numChunks_ * numChunks_);
+	for (unsigned z = 0; z < numChunks_; ++z)
+	{
+		for (unsigned x = 0; x < numChunks_; ++x)
+			CreateChunk(x, z, Max(maxHeight, 0.0f));
+	}
+
+	// Neighbours match their level of detail along the shared edges
+	for (unsigned z = 0; z < numChunks_; ++z)
+	{
+		for (unsigned x = 0; x < numChunks_; ++x)
+		{
+			auto neighbour = [&](int nx, int nz) -> Terrain*
+			{
+				if (nx < 0 || nz < 0 || nx >= (int)numChunks_ || nz >= (int)numChunks_)
+					return nullptr;
+				return chunks_[nz * numChunks_ + nx].terrain_;
+			};
+			chunks_[z * numChunks_ + x].terrain_->SetNeighbors(neighbour(x, z + 1), neighbour(x, z - 1),
+				neighbour(x - 1, z), neighbour(x + 1, z));
+		}
+	}
+}
+
+void ChunkedTerrain::GenerateHeights(float maxHeight, Image* heightMap)
+{
+	// Terrain stores 16-bit heights, the grid keeps the same steps so walkers stand exactly on the rendered ground
+	const float step = maxHeight > 0.0f ? maxHeight / (255.0f * 256.0f) : 1.0f;
+
+	heights_.resize(gridSize_ * gridSize_);
+	for (unsigned z = 0; z < gridSize_; ++z)
+	{
+		for (unsigned x = 0; x < gridSize_; ++x)
+		{
+			const float worldX = bounds_.min_.x_ + x * cellSize_;
+			const float worldZ = bounds_.min_.z_ + z * cellSize_;
+
+			float height;
+			if (heightMap)
+			{
+				// Image rows run from +Z down to -Z like the Terrain height maps
+				const float u = (float)x / (gridSize_ - 1);
+				const float v = 1.0f - (float)z / (gridSize_ - 1);
+				height = heightMap->GetPixelBilinear(u, v).r_ * maxHeight;
+			}
+			else
+			{
+				const float hills = Sin(worldX * 360.0f / HILL_WAVELENGTH) * Cos(worldZ * 360.0f / HILL_WAVELENGTH);
+				const float ridges = Sin((worldX + worldZ) * 360.0f / RIDGE_WAVELENGTH);
+				height = maxHeight * Clamp(0.5f + 0.35f * hills + 0.15f * ridges, 0.0f, 1.0f);
+			}
+
+			heights_[z * gridSize_ + x] = Round(height / step) * step;
+		}
+	}
+}
+
+void ChunkedTerrain::CreateChunk(unsigned x, unsigned z, float maxHeight)
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+	const unsigned size = chunkCells_ + 1;
+	const float spacingY = maxHeight > 0.0f ? maxHeight / 255.0f : 1.0f;
+
+	// Height map of the chunk: red is the whole part of height / spacing, green the fraction in 1/256 steps
+	ea::vector<unsigned char> data(size * size * 3, 0);
+	for (unsigned row = 0; row < size; ++row)
+	{
+		const unsigned gridZ = z * chunkCells_ + (size - 1 - row);
+		for (unsigned column = 0; column < size; ++column)
+		{
+			const float value = GetGridHeight(x * chunkCells_ + column, gridZ) / spacingY;
+			const unsigned fixed = Min((unsigned)RoundToInt(value * 256.0f), 65535u);
+			unsigned char* pixel = &data[(row * size + column) * 3];
+			pixel[0] = (unsigned char)(fixed >> 8);
+			pixel[1] = (unsigned char)(fixed & 255);
+		}
+	}
+
+	auto image = MakeShared<Image>(context_);
+	image->SetSize(size, size, 3);
+	image->SetData(data.data());
+
+	const float chunkSize = chunkCells_ * cellSize_;
+	Chunk& chunk = chunks_[z * numChunks_ + x];
+	chunk.node_ = node_->CreateChild(Format("TerrainChunk_{}_{}", x, z));
+	chunk.node_->SetPosition(Vector3(bounds_.min_.x_ + (x + 0.5f) * chunkSize, 0.0f,
+		bounds_.min_.z_ + (z + 0.5f) * chunkSize));
+
+	chunk.terrain_ = chunk.node_->CreateComponent<Terrain>();
+	chunk.terrain_->SetPatchSize(chunkCells_);
+	chunk.terrain_->SetSpacing(Vector3(cellSize_, spacingY, cellSize_));
+	chunk.terrain_->SetHeightMap(image);
+	chunk.terrain_->SetMaterial(cache->GetResource<Material>("Materials/Terrain.xml"));
+	// Not an occluder: CrowdOcclusion rasterizes occluders as solid bounding boxes, and a patch's box spans from
+	// its lowest to its highest point
+	chunk.terrain_->SetCastShadows(true);
+}
+
+void ChunkedTerrain::SetCollision(unsigned index, bool enable)
+{
+	Chunk& chunk = chunks_[index];
+	if (chunk.collision_ == enable)
+		return;
+
+	chunk.collision_ = enable;
+	if (enable)
+	{
+		// Spheres need rolling friction on the ground to come to rest, like on the floor box
+		auto* body = chunk.node_->CreateComponent<RigidBody>();
+		body->SetRollingFriction(0.15f);
+		body->SetCollisionLayer(TERRAIN_LAYER);
+		chunk.node_->CreateComponent<CollisionShape>()->SetTerrain();
+		collisionChunks_.push_back(index);
+	}
+	else
+	{
+		chunk.node_->RemoveComponent<CollisionShape>();
+		chunk.node_->RemoveComponent<RigidBody>();
+		collisionChunks_.erase(ea::find(collisionChunks_.begin(), collisionChunks_.end(), index));
+	}
+}
+
+float ChunkedTerrain::GetHeight(const Vector3& worldPosition) const
+{
+	if (heights_.empty())
+		return 0.0f;
+
+	// Same triangle split as Terrain::GetHeight
+	const float maxCoordinate = (float)(gridSize_ - 1) - M_EPSILON;
+	const float gridX = Clamp((worldPosition.x_ - bounds_.min_.x_) / cellSize_, 0.0f, maxCoordinate);
+	const float gridZ = Clamp((worldPosition.z_ - bounds_.min_.z_) / cellSize_, 0.0f, maxCoordinate);
+	const int x = FloorToInt(gridX);
+	const int z = FloorToInt(gridZ);
+	float xFrac = gridX - x;
+	float zFrac = gridZ - z;
+
+	float h1, h2, h3;
+	if (xFrac + zFrac >= 1.0f)
+	{
+		h1 = GetGridHeight(x + 1, z + 1);
+		h2 = GetGridHeight(x, z + 1);
+		h3 = GetGridHeight(x + 1, z);
+		xFrac = 1.0f - xFrac;
+		zFrac = 1.0f - zFrac;
+	}
+	else
+	{
+		h1 = GetGridHeight(x, z);
+		h2 = GetGridHeight(x + 1, z);
+		h3 = GetGridHeight(x, z + 1);
+	}
+	return h1 * (1.0f - xFrac - zFrac) + h2 * xFrac + h3 * zFrac;
+}
+
+bool ChunkedTerrain::IsSegmentBlocked(const Vector3& start, const Vector3& end) const
+{
+	if (heights_.empty())
+		return false;
+
+	const Vector3 delta = end - start;
+	const unsigned numSteps = (unsigned)CeilToInt(delta.Length() * 2.0f / cellSize_);
+	for (unsigned i = 1; i < numSteps; ++i)
+	{
+		const Vector3 point = start + delta * ((float)i / numSteps);
+		if (point.y_ < GetHeight(point))
+			return true;
+	}
+	return false;
+}
+
+void ChunkedTerrain::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PhysicsPreStep;
+
+	time_ += eventData[P_TIMESTEP].GetFloat();
+	if (chunks_.empty())
+		return;
+
+	// Collect first, the new static bodies join the object array being walked
+	auto* physicsWorld = static_cast<PhysicsWorld*>(eventData[P_WORLD].GetPtr());
+	const btCollisionObjectArray& objects = physicsWorld->GetWorld()->getCollisionObjectArray();
+	const float chunkSize = chunkCells_ * cellSize_;
+	neededChunks_.clear();
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		const btCollisionObject* object = objects[i];
+		const btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+		if (object->isStaticOrKinematicObject() || !proxy)
+			continue;
+
+		const int minX = FloorToInt((proxy->m_aabbMin.x() - collisionMargin_ - bounds_.min_.x_) / chunkSize);
+		const int maxX = FloorToInt((proxy->m_aabbMax.x() + collisionMargin_ - bounds_.min_.x_) / chunkSize);
+		const int minZ = FloorToInt((proxy->m_aabbMin.z() - collisionMargin_ - bounds_.min_.z_) / chunkSize);
+		const int maxZ = FloorToInt((proxy->m_aabbMax.z() + collisionMargin_ - bounds_.min_.z_) / chunkSize);
+		for (int z = Max(minZ, 0); z <= Min(maxZ, (int)numChunks_ - 1); ++z)
+		{
+			for (int x = Max(minX, 0); x <= Min(maxX, (int)numChunks_ - 1); ++x)
+				neededChunks_.push_back(z * numChunks_ + x);
+		}
+	}
+
+	for (unsigned index : neededChunks_)
+	{
+		chunks_[index].lastNeeded_ = time_;
+		SetCollision(index, true);
+	}
+
+	for (unsigned i = collisionChunks_.size(); i > 0; --i)
+	{
+		const unsigned index = collisionChunks_[i - 1];
+		if (time_ - chunks_[index].lastNeeded_ > keepTime_)
+			SetCollision(index, false);
+	}
+}
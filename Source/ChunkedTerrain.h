@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Image;
+	class Terrain;
+}
+
+namespace MonsterDolls
+{
+	/// Collision layer of the terrain chunks. Line of sight rays leave it out and sample the height grid instead,
+	/// as chunks only have collision near dynamic bodies.
+	static const unsigned TERRAIN_LAYER = 4;
+
+	/// Ground made of a square grid of heightfield chunks centered on its node, which must not be moved, rotated or
+	/// scaled. Every chunk is a Terrain rendering its part of one shared height grid, stitched to its neighbours.
+	/// Collision is created lazily: before every physics step the chunks under dynamic bodies, grown by a margin,
+	/// get a static heightfield body, and chunks nothing dynamic was over for a few seconds lose it again. The
+	/// number of physics shapes follows the bodies, not the size of the map. Walkers read their ground height from
+	/// the grid with GetHeight, which interpolates the same triangles the chunks render and collide with and is safe
+	/// to call from worker threads.
+	class ChunkedTerrain : public Component
+	{
+		URHO3D_OBJECT(ChunkedTerrain, Component);
+
+	public:
+		/// Construct.
+		explicit ChunkedTerrain(Context* context);
+
+		/// Build chunks per side of cells per chunk side, power of two from 4 to 128, with heights from 0 to the
+		/// maximum. Heights are read from the red channel of the height map when given, rolling hills otherwise.
+		void Create(unsigned numChunks, unsigned chunkCells, float cellSize, float maxHeight, Image* heightMap = nullptr);
+		/// Set distance around dynamic bodies within which chunks get collision.
+		void SetCollisionMargin(float margin) { collisionMargin_ = margin; }
+		/// Set seconds a chunk keeps its collision after the last dynamic body left it.
+		void SetKeepTime(float time) { keepTime_ = time; }
+
+		/// Return ground height under a world position, clamped to the terrain edges.
+		float GetHeight(const Vector3& worldPosition) const;
+		/// Return whether the ground rises above a segment anywhere between its ends, sampled every half cell.
+		/// Safe to call from worker threads.
+		bool IsSegmentBlocked(const Vector3& start, const Vector3& end) const;
+		/// Return world space bounds on the ground plane.
+		const BoundingBox& GetBounds() const { return bounds_; }
+		/// Return number of chunks.
+		unsigned GetNumChunks() const { return chunks_.size(); }
+		/// Return number of chunks with collision.
+		unsigned GetNumCollisionChunks() const { return collisionChunks_.size(); }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// One heightfield chunk.
+		struct Chunk
+		{
+			/// Node of the chunk.
+			SharedPtr<Node> node_;
+			/// Rendered heightfield.
+			Terrain* terrain_ = nullptr;
+			/// Has a static body.
+			bool collision_ = false;
+			/// Time a dynamic body was last over the chunk.
+			float lastNeeded_ = 0.0f;
+		};
+
+		/// Fill the height grid.
+		void GenerateHeights(float maxHeight, Image* heightMap);
+		/// Create the Terrain of a chunk from its part of the height grid.
+		void CreateChunk(unsigned x, unsigned z, float maxHeight);
+		/// Add or remove the static body of a chunk.
+		void SetCollision(unsigned index, bool enable);
+		/// Handle physics pre-step.
+		void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
+		/// Return height of a grid vertex.
+		float GetGridHeight(int x, int z) const { return heights_[z * gridSize_ + x]; }
+
+		/// Height of every grid vertex, row by row from -Z to +Z.
+		ea::vector<float> heights_;
+		/// Vertices along each side of the grid.
+		unsigned gridSize_ = 0;
+		/// Chunks along each side.
+		unsigned numChunks_ = 0;
+		/// Cells along each side of a chunk.
+		unsigned chunkCells_ = 0;
+		/// Size of a cell.
+		float cellSize_ = 1.0f;
+		/// Bounds on the ground plane.
+		BoundingBox bounds_;
+		/// Chunks, row by row from -Z to +Z.
+		ea::vector<Chunk> chunks_;
+		/// Indices of the chunks with collision.
+		ea::vector<unsigned> collisionChunks_;
+		/// Chunks needed by the running step.
+		ea::vector<unsigned> neededChunks_;
+		/// Time advanced by the physics steps.
+		float time_ = 0.0f;
+		/// Distance around dynamic bodies within which chunks get collision.
+		float collisionMargin_ = 2.0f;
+		/// Seconds a chunk keeps its collision.
+		float keepTime_ = 2.0f;
+	};
+}
@@ -0,0 +1,542 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/Serializer.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "CompressedAnimation.h"
+#include "Quantization.h"
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Version of the .cani format.
+const unsigned CANI_VERSION = 1;
+/// Smallest range of a quantized axis, avoids dividing by zero for constant channels.
+const float MIN_QUANTIZATION_RANGE = 0.0001f;
+
+/// Source track resampled at the cooking rate.
+struct DenseTrack
+{
+	ea::vector<Vector3> positions_;
+	ea::vector<Quaternion> rotations_;
+	ea::vector<Vector3> scales_;
+};
+
+/// Resample a source track at a fixed rate.
+void ResampleTrack(const AnimationTrack& track, float sampleRate, unsigned numFrames, DenseTrack& dense)
+{
+	dense.positions_.resize(numFrames);
+	dense.rotations_.resize(numFrames);
+	dense.scales_.resize(numFrames);
+
+	const unsigned numKeyFrames = track.GetNumKeyFrames();
+	unsigned index = 0;
+	for (unsigned frame = 0; frame < numFrames; ++frame)
+	{
+		const float time = frame / sampleRate;
+		while (index + 1 < numKeyFrames && track.GetKeyFrame(index + 1)->time_ <= time)
+			++index;
+
+		const AnimationKeyFrame* keyFrame = track.GetKeyFrame(index);
+		const AnimationKeyFrame* nextKeyFrame = track.GetKeyFrame(Min(index + 1, numKeyFrames - 1));
+		const float span = nextKeyFrame->time_ - keyFrame->time_;
+		const float t = span > 0.0f ? Clamp((time - keyFrame->time_) / span, 0.0f, 1.0f) : 0.0f;
+
+		dense.positions_[frame] = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+		dense.rotations_[frame] = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+		dense.scales_[frame] = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+	}
+}
+
+/// Normalized linear interpolation along the shorter arc, the same the runtime sampler does.
+Quaternion Nlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+	const float sign = a.DotProduct(b) < 0.0f ? -1.0f : 1.0f;
+	return (a * (1.0f - t) + b * (t * sign)).Normalized();
+}
+
+/// Return angle between two rotations in degrees.
+float RotationError(const Quaternion& a, const Quaternion& b)
+{
+	return 2.0f * Acos(Min(Abs(a.DotProduct(b)), 1.0f));
+}
+
+/// Choose the frames to keep so that interpolating between them stays within tolerance of every frame. Starts
+/// with the end frames and keeps splitting at the worst frame of a span, like Douglas-Peucker on a curve.
+template <class T, class Interpolate, class Error>
+void ReduceKeys(const ea::vector<T>& quantized, const ea::vector<T>& original, float tolerance,
+	Interpolate interpolate, Error error, ea::vector<unsigned>& kept, float& maxError)
+{
+	const unsigned numFrames = original.size();
+	kept.clear();
+
+	// Constant channels need one key
+	bool constant = true;
+	for (unsigned i = 1; i < numFrames && constant; ++i)
+		constant = error(quantized[0], original[i]) <= tolerance;
+	if (constant || numFrames < 2)
+	{
+		kept.push_back(0);
+		for (unsigned i = 0; i < numFrames; ++i)
+			maxError = Max(maxError, error(quantized[0], original[i]));
+		return;
+	}
+
+	ea::vector<bool> keep(numFrames, false);
+	keep.front() = keep.back() = true;
+
+	ea::vector<ea::pair<unsigned, unsigned> > spans;
+	spans.emplace_back(0, numFrames - 1);
+	while (!spans.empty())
+	{
+		const auto span = spans.back();
+		spans.pop_back();
+
+		float worstError = 0.0f;
+		unsigned worst = span.first;
+		for (unsigned i = span.first + 1; i < span.second; ++i)
+		{
+			const float t = float(i - span.first) / float(span.second - span.first);
+			const float e = error(interpolate(quantized[span.first], quantized[span.second], t), original[i]);
+			if (e > worstError)
+			{
+				worstError = e;
+				worst = i;
+			}
+		}
+
+		if (worstError > tolerance)
+		{
+			keep[worst] = true;
+			spans.emplace_back(span.first, worst);
+			spans.emplace_back(worst, span.second);
+		}
+		else
+			maxError = Max(maxError, worstError);
+	}
+
+	for (unsigned i = 0; i < numFrames; ++i)
+	{
+		if (keep[i])
+			kept.push_back(i);
+	}
+}
+
+/// Return the range of vectors, at least MIN_QUANTIZATION_RANGE wide on every axis.
+BoundingBox GetRange(const ea::vector<Vector3>& values)
+{
+	BoundingBox box(values.data(), values.size());
+	box.max_ = VectorMax(box.max_, box.min_ + Vector3::ONE * MIN_QUANTIZATION_RANGE);
+	return box;
+}
+
+/// Write a channel.
+void WriteChannel(Serializer& dest, const ea::vector<unsigned short>& frames, const ea::vector<unsigned>& rotations,
+	const ea::vector<unsigned short>& values, const BoundingBox& box)
+{
+	dest.WriteUInt(frames.size());
+	dest.Write(frames.data(), frames.size() * sizeof(unsigned short));
+	dest.WriteUInt(rotations.size());
+	dest.Write(rotations.data(), rotations.size() * sizeof(unsigned));
+	dest.WriteUInt(values.size());
+	dest.Write(values.data(), values.size() * sizeof(unsigned short));
+	dest.WriteBoundingBox(box);
+}
+
+/// Read a channel.
+void ReadChannel(Deserializer& source, ea::vector<unsigned short>& frames, ea::vector<unsigned>& rotations,
+	ea::vector<unsigned short>& values, BoundingBox& box)
+{
+	frames.resize(source.ReadUInt());
+	source.Read(frames.data(), frames.size() * sizeof(unsigned short));
+	rotations.resize(source.ReadUInt());
+	source.Read(rotations.data(), rotations.size() * sizeof(unsigned));
+	values.resize(source.ReadUInt());
+	source.Read(values.data(), values.size() * sizeof(unsigned short));
+	box = source.ReadBoundingBox();
+}
+
+/// Return channel flags from their serialized bits.
+AnimationChannelFlags ToChannelFlags(unsigned char bits)
+{
+	AnimationChannelFlags flags;
+	if (bits & 1)
+		flags |= CHANNEL_POSITION;
+	if (bits & 2)
+		flags |= CHANNEL_ROTATION;
+	if (bits & 4)
+		flags |= CHANNEL_SCALE;
+	return flags;
+}
+
+/// Return serialized bits of channel flags.
+unsigned char ToChannelBits(AnimationChannelFlags flags)
+{
+	return (unsigned char)((flags & CHANNEL_POSITION ? 1 : 0) | (flags & CHANNEL_ROTATION ? 2 : 0) |
+		(flags & CHANNEL_SCALE ? 4 : 0));
+}
+
+}
+
+float AnimationCompressionSettings::GetToleranceScale(const ea::string& boneName) const
+{
+	auto it = boneToleranceScales_.find(boneName);
+	return it != boneToleranceScales_.end() ? it->second : 1.0f;
+}
+
+CompressedAnimation::CompressedAnimation(Context* context) :
+	Resource(context)
+{
+}
+
+void CompressedAnimation::RegisterObject(Context* context)
+{
+	context->AddFactoryReflection<CompressedAnimation>();
+}
+
+bool CompressedAnimation::BeginLoad(Deserializer& source)
+{
+	if (source.ReadFileID() != "CANI" || source.ReadUInt() != CANI_VERSION)
+	{
+		URHO3D_LOGERROR("{} is not a compressed animation file", source.GetName());
+		return false;
+	}
+
+	animationName_ = source.ReadString();
+	length_ = source.ReadFloat();
+	sampleRate_ = source.ReadFloat();
+
+	tracks_.resize(source.ReadUInt());
+	for (Track& track : tracks_)
+	{
+		track.name_ = source.ReadString();
+		track.channelMask_ = source.ReadUByte();
+		ReadChannel(source, track.position_.frames_, track.position_.rotations_, track.position_.values_, track.position_.box_);
+		ReadChannel(source, track.rotation_.frames_, track.rotation_.rotations_, track.rotation_.values_, track.rotation_.box_);
+		ReadChannel(source, track.scale_.frames_, track.scale_.rotations_, track.scale_.values_, track.scale_.box_);
+	}
+
+	animation_.Reset();
+	UpdateMemoryUse();
+	return true;
+}
+
+bool CompressedAnimation::Save(Serializer& dest) const
+{
+	dest.WriteFileID("CANI");
+	dest.WriteUInt(CANI_VERSION);
+	dest.WriteString(animationName_);
+	dest.WriteFloat(length_);
+	dest.WriteFloat(sampleRate_);
+
+	dest.WriteUInt(tracks_.size());
+	for (const Track& track : tracks_)
+	{
+		dest.WriteString(track.name_);
+		dest.WriteUByte(track.channelMask_);
+		WriteChannel(dest, track.position_.frames_, track.position_.rotations_, track.position_.values_, track.position_.box_);
+		WriteChannel(dest, track.rotation_.frames_, track.rotation_.rotations_, track.rotation_.values_, track.rotation_.box_);
+		WriteChannel(dest, track.scale_.frames_, track.scale_.rotations_, track.scale_.values_, track.scale_.box_);
+	}
+	return true;
+}
+
+bool CompressedAnimation::Compress(const Animation* source, const AnimationCompressionSettings& settings)
+{
+	if (!source)
+		return false;
+
+	animationName_ = source->GetAnimationName();
+	length_ = source->GetLength();
+	sampleRate_ = settings.sampleRate_;
+	tracks_.clear();
+	animation_.Reset();
+	maxRotationError_ = 0.0f;
+	maxTranslationError_ = 0.0f;
+
+	const unsigned numFrames = Max(CeilToInt(length_ * sampleRate_), 0) + 1;
+	// Frame numbers are stored in 16 bits
+	if (numFrames > 65535)
+	{
+		URHO3D_LOGERROR("Animation {} is too long to compress at {} frames per second", source->GetName(), sampleRate_);
+		return false;
+	}
+
+	DenseTrack dense;
+	DenseTrack quantized;
+	ea::vector<unsigned> kept;
+	float maxScaleError = 0.0f;
+
+	const auto lerp = [](const Vector3& a, const Vector3& b, float t) { return a.Lerp(b, t); };
+	const auto distance = [](const Vector3& a, const Vector3& b) { return (a - b).Length(); };
+
+	for (const auto& pair : source->GetTracks())
+	{
+		const AnimationTrack& sourceTrack = pair.second;
+		if (!sourceTrack.GetNumKeyFrames())
+			continue;
+
+		tracks_.emplace_back();
+		Track& track = tracks_.back();
+		track.name_ = sourceTrack.name_;
+		track.channelMask_ = ToChannelBits(sourceTrack.channelMask_);
+
+		const float toleranceScale = settings.GetToleranceScale(track.name_);
+		ResampleTrack(sourceTrack, sampleRate_, numFrames, dense);
+
+		// Reduce against the quantized values so the tolerance covers the quantization error too
+		if (sourceTrack.channelMask_ & CHANNEL_ROTATION)
+		{
+			quantized.rotations_.resize(numFrames);
+			for (unsigned i = 0; i < numFrames; ++i)
+				quantized.rotations_[i] = DequantizeRotation(QuantizeRotation(dense.rotations_[i]));
+
+			ReduceKeys(quantized.rotations_, dense.rotations_, settings.rotationTolerance_ * toleranceScale, Nlerp,
+				RotationError, kept, maxRotationError_);
+			for (unsigned frame : kept)
+			{
+				track.rotation_.frames_.push_back((unsigned short)frame);
+				track.rotation_.rotations_.push_back(QuantizeRotation(dense.rotations_[frame]));
+			}
+		}
+
+		Channel* channels[2] = { &track.position_, &track.scale_ };
+		const ea::vector<Vector3>* values[2] = { &dense.positions_, &dense.scales_ };
+		ea::vector<Vector3>* quantizedValues[2] = { &quantized.positions_, &quantized.scales_ };
+		const float tolerances[2] = { settings.translationTolerance_ * toleranceScale, settings.scaleTolerance_ * toleranceScale };
+		const AnimationChannel channelFlags[2] = { CHANNEL_POSITION, CHANNEL_SCALE };
+		float* maxErrors[2] = { &maxTranslationError_, &maxScaleError };
+
+		for (unsigned c = 0; c < 2; ++c)
+		{
+			if (!(sourceTrack.channelMask_ & channelFlags[c]))
+				continue;
+
+			Channel& channel = *channels[c];
+			channel.box_ = GetRange(*values[c]);
+
+			quantizedValues[c]->resize(numFrames);
+			for (unsigned i = 0; i < numFrames; ++i)
+			{
+				unsigned short packed[3];
+				QuantizePosition((*values[c])[i], channel.box_, packed);
+				(*quantizedValues[c])[i] = DequantizePosition(packed, channel.box_);
+			}
+
+			ReduceKeys(*quantizedValues[c], *values[c], tolerances[c], lerp, distance, kept, *maxErrors[c]);
+			for (unsigned frame : kept)
+			{
+				unsigned short packed[3];
+				QuantizePosition((*values[c])[frame], channel.box_, packed);
+				channel.frames_.push_back((unsigned short)frame);
+				channel.values_.insert(channel.values_.end(), packed, packed + 3);
+			}
+		}
+	}
+
+	UpdateMemoryUse();
+	return true;
+}
+
+float CompressedAnimation::FindKeys(const Channel& channel, float frame, unsigned& first, unsigned& second)
+{
+	const ea::vector<unsigned short>& frames = channel.frames_;
+
+	// First key after the frame, binary search over 16 bit frame numbers
+	const auto it = ea::upper_bound(frames.begin(), frames.end(), frame,
+		[](float value, unsigned short key) { return value < key; });
+	second = Min((unsigned)(it - frames.begin()), (unsigned)frames.size() - 1);
+	first = second ? second - 1 : 0;
+	if (it == frames.end())
+		first = second;
+
+	const float span = float(frames[second]) - float(frames[first]);
+	return span > 0.0f ? Clamp((frame - frames[first]) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+Vector3 CompressedAnimation::SampleVector(const Channel& channel, float frame)
+{
+	unsigned first, second;
+	const float t = FindKeys(channel, frame, first, second);
+	const Vector3 a = DequantizePosition(&channel.values_[first * 3], channel.box_);
+	const Vector3 b = DequantizePosition(&channel.values_[second * 3], channel.box_);
+	return a.Lerp(b, t);
+}
+
+Quaternion CompressedAnimation::SampleRotation(const Channel& channel, float frame)
+{
+	unsigned first, second;
+	const float t = FindKeys(channel, frame, first, second);
+	return Nlerp(DequantizeRotation(channel.rotations_[first]), DequantizeRotation(channel.rotations_[second]), t);
+}
+
+void CompressedAnimation::Sample(float time, CompressedPose& pose) const
+{
+	const unsigned numTracks = tracks_.size();
+	const float frame = Clamp(time, 0.0f, length_) * sampleRate_;
+
+	pose.positions_.resize(numTracks);
+	pose.rotations_.resize(numTracks);
+	pose.scales_.resize(numTracks);
+	pose.weights_.resize(numTracks);
+	for (unsigned c = 0; c < 4; ++c)
+	{
+		pose.a_[c].resize(numTracks);
+		pose.b_[c].resize(numTracks);
+	}
+
+	// Gather the rotation key pairs into structure of arrays, tracks without rotation blend identity with itself
+	for (unsigned i = 0; i < numTracks; ++i)
+	{
+		const Track& track = tracks_[i];
+		Quaternion a = Quaternion::IDENTITY;
+		Quaternion b = Quaternion::IDENTITY;
+		float t = 0.0f;
+		if (!track.rotation_.frames_.empty())
+		{
+			unsigned first, second;
+			t = FindKeys(track.rotation_, frame, first, second);
+			a = DequantizeRotation(track.rotation_.rotations_[first]);
+			b = DequantizeRotation(track.rotation_.rotations_[second]);
+		}
+
+		pose.weights_[i] = t;
+		pose.a_[0][i] = a.w_; pose.a_[1][i] = a.x_; pose.a_[2][i] = a.y_; pose.a_[3][i] = a.z_;
+		pose.b_[0][i] = b.w_; pose.b_[1][i] = b.x_; pose.b_[2][i] = b.y_; pose.b_[3][i] = b.z_;
+	}
+
+	// Branchless normalized lerp over all tracks at once, the loops vectorize
+	float* aw = pose.a_[0].data(); float* ax = pose.a_[1].data(); float* ay = pose.a_[2].data(); float* az = pose.a_[3].data();
+	const float* bw = pose.b_[0].data(); const float* bx = pose.b_[1].data();
+	const float* by = pose.b_[2].data(); const float* bz = pose.b_[3].data();
+	const float* weights = pose.weights_.data();
+	for (unsigned i = 0; i < numTracks; ++i)
+	{
+		const float dot = aw[i] * bw[i] + ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+		const float t = weights[i];
+		const float s = 1.0f - t;
+		const float u = dot < 0.0f ? -t : t;
+		const float w = aw[i] * s + bw[i] * u;
+		const float x = ax[i] * s + bx[i] * u;
+		const float y = ay[i] * s + by[i] * u;
+		const float z = az[i] * s + bz[i] * u;
+		const float invLength = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+		aw[i] = w * invLength;
+		ax[i] = x * invLength;
+		ay[i] = y * invLength;
+		az[i] = z * invLength;
+	}
+
+	for (unsigned i = 0; i < numTracks; ++i)
+	{
+		const Track& track = tracks_[i];
+		pose.rotations_[i] = Quaternion(aw[i], ax[i], ay[i], az[i]);
+		pose.positions_[i] = track.position_.frames_.empty() ? Vector3::ZERO : SampleVector(track.position_, frame);
+		pose.scales_[i] = track.scale_.frames_.empty() ? Vector3::ONE : SampleVector(track.scale_, frame);
+	}
+}
+
+Animation* CompressedAnimation::GetAnimation()
+{
+	if (animation_)
+		return animation_;
+
+	animation_ = MakeShared<Animation>(context_);
+	animation_->SetName(GetName() + ".ani");
+	animation_->SetAnimationName(animationName_);
+	animation_->SetLength(length_);
+
+	ea::vector<unsigned short> frames;
+	for (const Track& track : tracks_)
+	{
+		AnimationTrack* animationTrack = animation_->CreateTrack(track.name_);
+		animationTrack->channelMask_ = ToChannelFlags(track.channelMask_);
+
+		// AnimationTrack keeps all channels in one key list, key the union of the channel frames
+		frames.clear();
+		frames.insert(frames.end(), track.position_.frames_.begin(), track.position_.frames_.end());
+		frames.insert(frames.end(), track.rotation_.frames_.begin(), track.rotation_.frames_.end());
+		frames.insert(frames.end(), track.scale_.frames_.begin(), track.scale_.frames_.end());
+		ea::sort(frames.begin(), frames.end());
+		frames.erase(ea::unique(frames.begin(), frames.end()), frames.end());
+
+		for (unsigned short frame : frames)
+		{
+			AnimationKeyFrame keyFrame;
+			keyFrame.time_ = frame / sampleRate_;
+			if (!track.position_.frames_.empty())
+				keyFrame.position_ = SampleVector(track.position_, frame);
+			if (!track.rotation_.frames_.empty())
+				keyFrame.rotation_ = SampleRotation(track.rotation_, frame);
+			keyFrame.scale_ = track.scale_.frames_.empty() ? Vector3::ONE : SampleVector(track.scale_, frame);
+			animationTrack->AddKeyFrame(keyFrame);
+		}
+	}
+
+	GetSubsystem<ResourceCache>()->AddManualResource(animation_);
+	return animation_;
+}
+
+unsigned CompressedAnimation::GetNumKeys() const
+{
+	unsigned numKeys = 0;
+	for (const Track& track : tracks_)
+		numKeys += track.position_.frames_.size() + track.rotation_.frames_.size() + track.scale_.frames_.size();
+	return numKeys;
+}
+
+void CompressedAnimation::UpdateMemoryUse()
+{
+	unsigned memoryUse = sizeof(CompressedAnimation);
+	for (const Track& track : tracks_)
+	{
+		memoryUse += sizeof(Track) + track.name_.length();
+		for (const Channel* channel : { &track.position_, &track.rotation_, &track.scale_ })
+		{
+			memoryUse += channel->frames_.size() * sizeof(unsigned short) + channel->rotations_.size() * sizeof(unsigned) +
+				channel->values_.size() * sizeof(unsigned short);
+		}
+	}
+	SetMemoryUse(memoryUse);
+}
+
+Animation* CompressedAnimation::LoadClip(ResourceCache* cache, const ea::string& animationName)
+{
+	const ea::string cookedName = ReplaceExtension(animationName, ".cani");
+	if (cache->Exists(cookedName))
+	{
+		if (auto* compressed = cache->GetResource<CompressedAnimation>(cookedName))
+			return compressed->GetAnimation();
+	}
+	return cache->GetResource<Animation>(animationName);
+}
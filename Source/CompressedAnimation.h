@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Resource/Resource.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class ResourceCache;
+}
+
+namespace MonsterDolls
+{
+	/// Error tolerances of the animation cooker.
+	struct AnimationCompressionSettings
+	{
+		/// Rate the source clip is resampled at before reducing keys.
+		float sampleRate_ = 30.0f;
+		/// Maximum rotation error in degrees.
+		float rotationTolerance_ = 0.5f;
+		/// Maximum translation error in world units.
+		float translationTolerance_ = 0.002f;
+		/// Maximum scale error.
+		float scaleTolerance_ = 0.001f;
+		/// Tolerance multiplier per bone name, lower for bones whose error shows down the chain.
+		ea::unordered_map<ea::string, float> boneToleranceScales_;
+
+		/// Return tolerance multiplier of a bone.
+		float GetToleranceScale(const ea::string& boneName) const;
+	};
+
+	/// Output of CompressedAnimation::Sample, one entry per track. Also holds the structure of arrays scratch
+	/// buffers of the sampler, keep one per thread and reuse it.
+	struct CompressedPose
+	{
+		/// Track positions.
+		ea::vector<Vector3> positions_;
+		/// Track rotations.
+		ea::vector<Quaternion> rotations_;
+		/// Track scales.
+		ea::vector<Vector3> scales_;
+
+		/// Rotation key pair weights.
+		ea::vector<float> weights_;
+		/// Components of the first rotation of every pair.
+		ea::vector<float> a_[4];
+		/// Components of the second rotation of every pair.
+		ea::vector<float> b_[4];
+	};
+
+	/// Keyframe reduced, quantized skeletal animation. Every channel of a track keeps only the keys needed to stay
+	/// within the cooking tolerance of the source. Rotations are packed to 32 bits, positions and scales to
+	/// 16 bits per axis within the channel's range. Plays through AnimationController via GetAnimation, or is
+	/// sampled directly for crowds.
+	class CompressedAnimation : public Resource
+	{
+		URHO3D_OBJECT(CompressedAnimation, Resource);
+
+	public:
+		/// Construct.
+		explicit CompressedAnimation(Context* context);
+		/// Register object factory.
+		static void RegisterObject(Context* context);
+
+		/// Load resource from stream.
+		bool BeginLoad(Deserializer& source) override;
+		/// Save resource.
+		bool Save(Serializer& dest) const override;
+
+		/// Cook from a source animation.
+		bool Compress(const Animation* source, const AnimationCompressionSettings& settings);
+		/// Sample every track at a time in seconds.
+		void Sample(float time, CompressedPose& pose) const;
+		/// Return the clip as an Animation with the reduced keys for AnimationController. Created on first use.
+		Animation* GetAnimation();
+
+		/// Return clip length in seconds.
+		float GetLength() const { return length_; }
+		/// Return number of tracks.
+		unsigned GetNumTracks() const { return tracks_.size(); }
+		/// Return name of a track.
+		const ea::string& GetTrackName(unsigned index) const { return tracks_[index].name_; }
+		/// Return channel mask of a track.
+		AnimationChannelFlags GetTrackChannels(unsigned index) const { return AnimationChannelFlags(tracks_[index].channelMask_); }
+		/// Return total number of keys over all channels.
+		unsigned GetNumKeys() const;
+		/// Return largest rotation error of the last Compress in degrees.
+		float GetMaxRotationError() const { return maxRotationError_; }
+		/// Return largest translation error of the last Compress.
+		float GetMaxTranslationError() const { return maxTranslationError_; }
+
+		/// Return a clip for AnimationController, the cooked .cani next to the .ani if there is one.
+		static Animation* LoadClip(ResourceCache* cache, const ea::string& animationName);
+
+	private:
+		/// Keys of one channel.
+		struct Channel
+		{
+			/// Frame of every key at the sample rate.
+			ea::vector<unsigned short> frames_;
+			/// Packed rotations.
+			ea::vector<unsigned> rotations_;
+			/// Quantized positions or scales, three per key.
+			ea::vector<unsigned short> values_;
+			/// Range of the positions or scales.
+			BoundingBox box_;
+		};
+
+		/// Channels of one bone.
+		struct Track
+		{
+			ea::string name_;
+			unsigned char channelMask_ = 0;
+			Channel position_;
+			Channel rotation_;
+			Channel scale_;
+		};
+
+		/// Find the key pair around a frame, return weight of the second key.
+		static float FindKeys(const Channel& channel, float frame, unsigned& first, unsigned& second);
+		/// Sample a position or scale channel.
+		static Vector3 SampleVector(const Channel& channel, float frame);
+		/// Sample a rotation channel.
+		static Quaternion SampleRotation(const Channel& channel, float frame);
+		/// Update the memory use from the key arrays.
+		void UpdateMemoryUse();
+
+		/// Source animation name.
+		ea::string animationName_;
+		/// Clip length.
+		float length_ = 0.0f;
+		/// Key frames per second.
+		float sampleRate_ = 30.0f;
+		/// Tracks.
+		ea::vector<Track> tracks_;
+		/// Decompressed clip for AnimationController.
+		SharedPtr<Animation> animation_;
+		/// Largest rotation error of the last Compress.
+		float maxRotationError_ = 0.0f;
+		/// Largest translation error of the last Compress.
+		float maxTranslationError_ = 0.0f;
+	};
+}
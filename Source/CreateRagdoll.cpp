@@ -22,6 +22,7 @@
 
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Physics/PhysicsEvents.h>
 #include <Urho3D/Physics/RigidBody.h>
@@ -30,17 +31,146 @@
 #include <Urho3D/Graphics/Animation.h>
 #include <Urho3D/Graphics/AnimationController.h>
 #include <Urho3D/Graphics/GraphicsEvents.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
 
 
 #include "CreateRagdoll.h"
 #include "Ragdolls.h"
 #include "Mover.h"
 #include "MDRemoveCom.h"
+#include "PerformanceProfiles.h"
+#include "QualityGovernor.h"
+#include "RagdollPose.h"
+
+#include <cstring>
 
 #include <Urho3D/DebugNew.h>
 
 using namespace MonsterDolls;
 
+namespace
+{
+
+/// Physical bone of the ragdoll.
+struct RagdollBoneDesc
+{
+	/// Bone name.
+	const char* name_;
+	/// Box or capsule shape.
+	ShapeType type_;
+	/// Shape size.
+	Vector3 size_;
+	/// Shape offset from the bone.
+	Vector3 position_;
+	/// Shape rotation.
+	Quaternion rotation_;
+	/// Lowest detail tier the bone is simulated at, lower tiers leave it to follow its parent stiffly.
+	RagdollTier tier_;
+	/// Chain reacting to hits near the bone, LIMB_NONE for lethal ones.
+	LimbChain chain_;
+};
+
+/// Joint between two physical bones.
+struct RagdollJointDesc
+{
+	/// Bone name.
+	const char* bone_;
+	/// Parent bone name.
+	const char* parent_;
+	/// Constraint type.
+	ConstraintType type_;
+	/// Axis in the bone.
+	Vector3 axis_;
+	/// Axis in the parent bone.
+	Vector3 parentAxis_;
+	/// High limit.
+	Vector2 highLimit_;
+	/// Low limit.
+	Vector2 lowLimit_;
+	/// Disable collision between the two bones.
+	bool disableCollision_;
+	/// Lowest detail tier the joint is simulated at.
+	RagdollTier tier_;
+};
+
+/// Bones simulated by a hit reaction, attached to an animated anchor bone.
+struct LimbChainDesc
+{
+	/// Kinematic bone the chain hangs from.
+	const char* anchor_;
+	/// Simulated bones from the anchor outwards, null when the chain is shorter.
+	const char* bones_[2];
+};
+
+const Quaternion CAPSULE_ROTATION(0.0f, 0.0f, 90.0f);
+
+const RagdollBoneDesc RAGDOLL_BONES[] =
+{
+	{ "Bip01_Pelvis", SHAPE_BOX, Vector3(0.3f, 0.2f, 0.25f), Vector3::ZERO, Quaternion::IDENTITY, RAGDOLL_TORSO, LIMB_TORSO },
+	{ "Bip01_Spine1", SHAPE_BOX, Vector3(0.35f, 0.2f, 0.3f), Vector3(0.15f, 0.0f, 0.0f), Quaternion::IDENTITY, RAGDOLL_TORSO, LIMB_TORSO },
+	{ "Bip01_L_Thigh", SHAPE_CAPSULE, Vector3(0.175f, 0.45f, 0.175f), Vector3(0.25f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_TORSO, LIMB_LEFT_LEG },
+	{ "Bip01_R_Thigh", SHAPE_CAPSULE, Vector3(0.175f, 0.45f, 0.175f), Vector3(0.25f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_TORSO, LIMB_RIGHT_LEG },
+	{ "Bip01_L_Calf", SHAPE_CAPSULE, Vector3(0.15f, 0.55f, 0.15f), Vector3(0.25f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_NO_FOREARMS, LIMB_LEFT_LEG },
+	{ "Bip01_R_Calf", SHAPE_CAPSULE, Vector3(0.15f, 0.55f, 0.15f), Vector3(0.25f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_NO_FOREARMS, LIMB_RIGHT_LEG },
+	{ "Bip01_Head", SHAPE_BOX, Vector3(0.2f, 0.2f, 0.2f), Vector3(0.1f, 0.0f, 0.0f), Quaternion::IDENTITY, RAGDOLL_TORSO, LIMB_NONE },
+	{ "Bip01_L_UpperArm", SHAPE_CAPSULE, Vector3(0.15f, 0.35f, 0.15f), Vector3(0.1f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_NO_FOREARMS, LIMB_LEFT_ARM },
+	{ "Bip01_R_UpperArm", SHAPE_CAPSULE, Vector3(0.15f, 0.35f, 0.15f), Vector3(0.1f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_NO_FOREARMS, LIMB_RIGHT_ARM },
+	{ "Bip01_L_Forearm", SHAPE_CAPSULE, Vector3(0.125f, 0.4f, 0.125f), Vector3(0.2f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_FULL, LIMB_LEFT_ARM },
+	{ "Bip01_R_Forearm", SHAPE_CAPSULE, Vector3(0.125f, 0.4f, 0.125f), Vector3(0.2f, 0.0f, 0.0f), CAPSULE_ROTATION, RAGDOLL_FULL, LIMB_RIGHT_ARM }
+};
+
+const RagdollJointDesc RAGDOLL_JOINTS[] =
+{
+	{ "Bip01_L_Thigh", "Bip01_Pelvis", CONSTRAINT_CONETWIST, Vector3::BACK, Vector3::FORWARD, Vector2(45.0f, 45.0f), Vector2::ZERO, true, RAGDOLL_TORSO },
+	{ "Bip01_R_Thigh", "Bip01_Pelvis", CONSTRAINT_CONETWIST, Vector3::BACK, Vector3::FORWARD, Vector2(45.0f, 45.0f), Vector2::ZERO, true, RAGDOLL_TORSO },
+	{ "Bip01_L_Calf", "Bip01_L_Thigh", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK, Vector2(90.0f, 0.0f), Vector2::ZERO, true, RAGDOLL_NO_FOREARMS },
+	{ "Bip01_R_Calf", "Bip01_R_Thigh", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK, Vector2(90.0f, 0.0f), Vector2::ZERO, true, RAGDOLL_NO_FOREARMS },
+	{ "Bip01_Spine1", "Bip01_Pelvis", CONSTRAINT_HINGE, Vector3::FORWARD, Vector3::FORWARD, Vector2(45.0f, 0.0f), Vector2(-10.0f, 0.0f), true, RAGDOLL_TORSO },
+	{ "Bip01_Head", "Bip01_Spine1", CONSTRAINT_CONETWIST, Vector3::LEFT, Vector3::LEFT, Vector2(0.0f, 30.0f), Vector2::ZERO, true, RAGDOLL_TORSO },
+	{ "Bip01_L_UpperArm", "Bip01_Spine1", CONSTRAINT_CONETWIST, Vector3::DOWN, Vector3::UP, Vector2(45.0f, 45.0f), Vector2::ZERO, false, RAGDOLL_NO_FOREARMS },
+	{ "Bip01_R_UpperArm", "Bip01_Spine1", CONSTRAINT_CONETWIST, Vector3::DOWN, Vector3::UP, Vector2(45.0f, 45.0f), Vector2::ZERO, false, RAGDOLL_NO_FOREARMS },
+	{ "Bip01_L_Forearm", "Bip01_L_UpperArm", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK, Vector2(90.0f, 0.0f), Vector2::ZERO, true, RAGDOLL_FULL },
+	{ "Bip01_R_Forearm", "Bip01_R_UpperArm", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK, Vector2(90.0f, 0.0f), Vector2::ZERO, true, RAGDOLL_FULL }
+};
+
+/// Chains by LimbChain.
+const LimbChainDesc LIMB_CHAINS[] =
+{
+	{ "Bip01_Spine1", { "Bip01_L_UpperArm", "Bip01_L_Forearm" } },
+	{ "Bip01_Spine1", { "Bip01_R_UpperArm", "Bip01_R_Forearm" } },
+	{ "Bip01_Pelvis", { "Bip01_L_Thigh", "Bip01_L_Calf" } },
+	{ "Bip01_Pelvis", { "Bip01_R_Thigh", "Bip01_R_Calf" } },
+	{ "Bip01_Pelvis", { "Bip01_Spine1", nullptr } }
+};
+
+/// Time a hit limb is simulated before blending back, in seconds.
+const float REACTION_TIME = 0.6f;
+/// Time to blend a limb back to the animation, in seconds.
+const float BLEND_TIME = 0.3f;
+/// Largest impulse given to a hit limb, the full projectile momentum would throw it out of its joints.
+const float MAX_REACTION_IMPULSE = 4.0f;
+
+/// Return the ragdoll detail tier of the scene.
+RagdollTier GetRagdollTier(Scene* scene)
+{
+	const auto* governor = scene->GetComponent<QualityGovernor>();
+	return governor ? governor->GetQuality().ragdollTier_ : RAGDOLL_FULL;
+}
+
+/// Return the bone description with a name, null if it is not physical.
+const RagdollBoneDesc* FindBoneDesc(const char* name)
+{
+	for (const RagdollBoneDesc& bone : RAGDOLL_BONES)
+	{
+		if (!strcmp(bone.name_, name))
+			return &bone;
+	}
+	return nullptr;
+}
+
+}
+
 CreateRagdoll::CreateRagdoll(Context* context) :
 	Component(context)
 {
@@ -58,159 +188,285 @@ void CreateRagdoll::HandleNodeCollision(StringHash eventType, VariantMap& eventD
 {
 	using namespace NodeCollision;
 
-	// Get the other colliding body, make sure it is moving (has nonzero mass)
+	// Get the other colliding body, make sure it is moving (has nonzero mass) and is not one of our own limbs
 	auto* otherBody = static_cast<RigidBody*>(eventData[P_OTHERBODY].GetPtr());
 
-	if (otherBody->GetMass() > 0.0f)
-	{
-		// We do not need the physics components in the AnimatedModel's root scene node anymore
-		node_->RemoveComponent<RigidBody>();
-		node_->RemoveComponent<CollisionShape>();
-
-		// Create RigidBody & CollisionShape components to bones
-		CreateRagdollBone("Bip01_Pelvis", SHAPE_BOX, Vector3(0.3f, 0.2f, 0.25f), Vector3(0.0f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 0.0f));     
-		//CreateRagdollBone("Hips", SHAPE_BOX, Vector3(0.3f, 0.2f, 0.25f), Vector3(0.0f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 0.0f));
-
-		CreateRagdollBone("Bip01_Spine1", SHAPE_BOX, Vector3(0.35f, 0.2f, 0.3f), Vector3(0.15f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 0.0f));
-		//CreateRagdollBone("Spine1", SHAPE_BOX, Vector3(0.35f, 0.2f, 0.3f), Vector3(0.15f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 0.0f));
-	
-		CreateRagdollBone("Bip01_L_Thigh", SHAPE_CAPSULE, Vector3(0.175f, 0.45f, 0.175f), Vector3(0.25f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("LeftUpLeg", SHAPE_CAPSULE, Vector3(0.175f, 0.45f, 0.175f), Vector3(0.25f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_R_Thigh", SHAPE_CAPSULE, Vector3(0.175f, 0.45f, 0.175f), Vector3(0.25f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("RightUpLeg", SHAPE_CAPSULE, Vector3(0.175f, 0.45f, 0.175f), Vector3(0.25f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_L_Calf", SHAPE_CAPSULE, Vector3(0.15f, 0.55f, 0.15f), Vector3(0.25f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("LeftLeg", SHAPE_CAPSULE, Vector3(0.15f, 0.55f, 0.15f), Vector3(0.25f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_R_Calf", SHAPE_CAPSULE, Vector3(0.15f, 0.55f, 0.15f), Vector3(0.25f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("RightLeg", SHAPE_CAPSULE, Vector3(0.15f, 0.55f, 0.15f), Vector3(0.25f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_Head", SHAPE_BOX, Vector3(0.2f, 0.2f, 0.2f), Vector3(0.1f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 0.0f));
-		//CreateRagdollBone("Head", SHAPE_BOX, Vector3(0.2f, 0.2f, 0.2f), Vector3(0.1f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 0.0f));
-
-		CreateRagdollBone("Bip01_L_UpperArm", SHAPE_CAPSULE, Vector3(0.15f, 0.35f, 0.15f), Vector3(0.1f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("LeftShoulder", SHAPE_CAPSULE, Vector3(0.15f, 0.35f, 0.15f), Vector3(0.1f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_R_UpperArm", SHAPE_CAPSULE, Vector3(0.15f, 0.35f, 0.15f), Vector3(0.1f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("RightShoulder", SHAPE_CAPSULE, Vector3(0.15f, 0.35f, 0.15f), Vector3(0.1f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_L_Forearm", SHAPE_CAPSULE, Vector3(0.125f, 0.4f, 0.125f), Vector3(0.2f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("LeftArm", SHAPE_CAPSULE, Vector3(0.125f, 0.4f, 0.125f), Vector3(0.2f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		CreateRagdollBone("Bip01_R_Forearm", SHAPE_CAPSULE, Vector3(0.125f, 0.4f, 0.125f), Vector3(0.2f, 0.0f, 0.0f),
-			Quaternion(0.0f, 0.0f, 90.0f));
-		//CreateRagdollBone("RightArm", SHAPE_CAPSULE, Vector3(0.125f, 0.4f, 0.125f), Vector3(0.2f, 0.0f, 0.0f),
-			//Quaternion(0.0f, 0.0f, 90.0f));
-
-		// Create Constraints between bones
-
-		CreateRagdollConstraint("Bip01_L_Thigh", "Bip01_Pelvis", CONSTRAINT_CONETWIST, Vector3::BACK, Vector3::FORWARD,
-			Vector2(45.0f, 45.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("LeftUpLeg", "Hips", CONSTRAINT_CONETWIST, Vector3::BACK, Vector3::FORWARD,
-			//Vector2(45.0f, 45.0f), Vector2::ZERO);
-
-		CreateRagdollConstraint("Bip01_R_Thigh", "Bip01_Pelvis", CONSTRAINT_CONETWIST, Vector3::BACK, Vector3::FORWARD,
-			Vector2(45.0f, 45.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("RightUpLeg", "Hips", CONSTRAINT_CONETWIST, Vector3::BACK, Vector3::FORWARD,
-			//Vector2(45.0f, 45.0f), Vector2::ZERO);
-
-		CreateRagdollConstraint("Bip01_L_Calf", "Bip01_L_Thigh", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			Vector2(90.0f, 0.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("LeftLeg", "LeftUpLeg", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			//Vector2(90.0f, 0.0f), Vector2::ZERO);
-
-		CreateRagdollConstraint("Bip01_R_Calf", "Bip01_R_Thigh", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			Vector2(90.0f, 0.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("RightLeg", "RightUpLeg", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			//Vector2(90.0f, 0.0f), Vector2::ZERO);
-
-		CreateRagdollConstraint("Bip01_Spine1", "Bip01_Pelvis", CONSTRAINT_HINGE, Vector3::FORWARD, Vector3::FORWARD,
-			Vector2(45.0f, 0.0f), Vector2(-10.0f, 0.0f));
-		//CreateRagdollConstraint("Spine1", "Hips", CONSTRAINT_HINGE, Vector3::FORWARD, Vector3::FORWARD,
-			//Vector2(45.0f, 0.0f), Vector2(-10.0f, 0.0f));
-
-		CreateRagdollConstraint("Bip01_Head", "Bip01_Spine1", CONSTRAINT_CONETWIST, Vector3::LEFT, Vector3::LEFT,
-			Vector2(0.0f, 30.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("Head", "Spine1", CONSTRAINT_CONETWIST, Vector3::LEFT, Vector3::LEFT,
-			//Vector2(0.0f, 30.0f), Vector2::ZERO);
-
-		CreateRagdollConstraint("Bip01_L_UpperArm", "Bip01_Spine1", CONSTRAINT_CONETWIST, Vector3::DOWN, Vector3::UP,
-			Vector2(45.0f, 45.0f), Vector2::ZERO, false);
-		//CreateRagdollConstraint("LeftShoulder", "Spine1", CONSTRAINT_CONETWIST, Vector3::DOWN, Vector3::UP,
-			//Vector2(45.0f, 45.0f), Vector2::ZERO, false);
-
-		CreateRagdollConstraint("Bip01_R_UpperArm", "Bip01_Spine1", CONSTRAINT_CONETWIST, Vector3::DOWN, Vector3::UP,
-			Vector2(45.0f, 45.0f), Vector2::ZERO, false);
-		//CreateRagdollConstraint("RightShoulder", "Spine1", CONSTRAINT_CONETWIST, Vector3::DOWN, Vector3::UP,
-			//Vector2(45.0f, 45.0f), Vector2::ZERO, false);
-
-		CreateRagdollConstraint("Bip01_L_Forearm", "Bip01_L_UpperArm", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			Vector2(90.0f, 0.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("LeftArm", "LeftShoulder", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			//Vector2(90.0f, 0.0f), Vector2::ZERO);
-
-		CreateRagdollConstraint("Bip01_R_Forearm", "Bip01_R_UpperArm", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			Vector2(90.0f, 0.0f), Vector2::ZERO);
-		//CreateRagdollConstraint("RightArm", "RightShoulder", CONSTRAINT_HINGE, Vector3::BACK, Vector3::BACK,
-			//Vector2(90.0f, 0.0f), Vector2::ZERO);
-
-		// Disable keyframe animation from all bones so that they will not interfere with the ragdoll
-		auto* model = GetComponent<AnimatedModel>();
-		Skeleton& skeleton = model->GetSkeleton();
-		for (unsigned i = 0; i < skeleton.GetNumBones(); ++i)
-			skeleton.GetBone(i)->animated_ = false;
-
-		node_->RemoveComponent<Mover3D>();
-
-		auto* mdRemoveCom = node_->CreateComponent<MDRemoveCom>();
-		mdRemoveCom->SetCountNum(100);
-
-		// Finally remove self from the scene node. Note that this must be the last operation performed in the functio
-		Remove();
+	if (otherBody->GetMass() > 0.0f && !otherBody->GetNode()->IsChildOf(node_))
+	{
+		// The first contact point tells which limb was hit
+		Vector3 position = otherBody->GetPosition();
+		MemoryBuffer contacts(eventData[P_CONTACTS].GetBuffer());
+		if (!contacts.IsEof())
+			position = contacts.ReadVector3();
+
+		Hit(position, otherBody->GetLinearVelocity() * otherBody->GetMass(), otherBody);
+	}
+}
+
+bool CreateRagdoll::Hit(const Vector3& position, const Vector3& impulse, RigidBody* source)
+{
+	// A projectile touches the trigger for several steps and may be swept through it as well
+	if (source)
+	{
+		if (lastSource_.Get() == source)
+			return false;
+		lastSource_ = source;
+	}
+
+	// Find the physical bone whose shape center is nearest to the hit
+	const RagdollTier tier = GetRagdollTier(GetScene());
+	const RagdollBoneDesc* nearest = nullptr;
+	float nearestDistance = M_INFINITY;
+	for (const RagdollBoneDesc& bone : RAGDOLL_BONES)
+	{
+		Node* boneNode = node_->GetChild(bone.name_, true);
+		if (!boneNode)
+			continue;
+
+		const float distance = (boneNode->GetWorldTransform() * bone.position_ - position).LengthSquared();
+		if (distance < nearestDistance)
+		{
+			nearest = &bone;
+			nearestDistance = distance;
+		}
+	}
+
+	const int hitsToKill = PerformanceProfiles::GetCurrent(context_).hitsToKill_;
+	if (!nearest || nearest->chain_ == LIMB_NONE || ++numHits_ >= hitsToKill)
+	{
+		Activate();
+		return true;
 	}
+
+	// Limbs left stiff at the current tier move the torso instead
+	LimbChain chain = nearest->chain_;
+	if (nearest->tier_ < tier)
+		chain = LIMB_TORSO;
+
+	StartReaction(chain, position, impulse);
+	return false;
 }
 
-void CreateRagdoll::CreateRagdollBone(const ea::string& boneName, ShapeType type, const Vector3& size, const Vector3& position,
-	const Quaternion& rotation)
+void CreateRagdoll::StartReaction(LimbChain chain, const Vector3& position, const Vector3& impulse)
+{
+	if (chain != activeChain_)
+	{
+		EndReaction();
+
+		const LimbChainDesc& desc = LIMB_CHAINS[chain];
+		const RagdollTier tier = GetRagdollTier(GetScene());
+		Skeleton& skeleton = GetComponent<AnimatedModel>()->GetSkeleton();
+
+		// The anchor follows the animation and carries the chain along, it collides with nothing
+		Node* anchorNode = node_->GetChild(desc.anchor_, true);
+		if (!anchorNode)
+			return;
+		auto* anchorBody = anchorNode->CreateComponent<RigidBody>();
+		anchorBody->SetKinematic(true);
+		anchorBody->SetCollisionLayerAndMask(0, 0);
+		chainNodes_.push_back(WeakPtr<Node>(anchorNode));
+
+		for (const char* boneName : desc.bones_)
+		{
+			const RagdollBoneDesc* bone = boneName ? FindBoneDesc(boneName) : nullptr;
+			if (!bone || bone->tier_ < tier)
+				continue;
+
+			RigidBody* body = CreateRagdollBone(bone->name_, bone->type_, bone->size_, bone->position_, bone->rotation_);
+			if (!body)
+				continue;
+			// Swinging limbs must not set off the triggers of the zombies around
+			body->SetCollisionMask(M_MAX_UNSIGNED & ~ZOMBIE_TRIGGER_LAYER);
+			chainNodes_.push_back(WeakPtr<Node>(body->GetNode()));
+
+			for (const RagdollJointDesc& joint : RAGDOLL_JOINTS)
+			{
+				if (!strcmp(joint.bone_, bone->name_))
+					CreateRagdollConstraint(joint.bone_, joint.parent_, joint.type_, joint.axis_, joint.parentAxis_,
+						joint.highLimit_, joint.lowLimit_, joint.disableCollision_);
+			}
+
+			if (Bone* skeletonBone = skeleton.GetBone(bone->name_))
+				skeletonBone->animated_ = false;
+
+			// A bone hit again while it blends back continues from where the physics takes it
+			blends_.erase(ea::remove_if(blends_.begin(), blends_.end(),
+				[&](const BoneBlend& blend) { return blend.node_.Get() == body->GetNode(); }), blends_.end());
+		}
+
+		activeChain_ = chain;
+		SubscribeToEvent(GetScene(), E_SCENEDRAWABLEUPDATEFINISHED,
+			URHO3D_HANDLER(CreateRagdoll, HandleSceneDrawableUpdateFinished));
+	}
+
+	// Push the chain bone nearest to the hit
+	RigidBody* hitBody = nullptr;
+	float nearestDistance = M_INFINITY;
+	for (unsigned i = 1; i < chainNodes_.size(); ++i)
+	{
+		Node* boneNode = chainNodes_[i];
+		const float distance = boneNode ? (boneNode->GetWorldPosition() - position).LengthSquared() : M_INFINITY;
+		if (distance < nearestDistance)
+		{
+			hitBody = boneNode->GetComponent<RigidBody>();
+			nearestDistance = distance;
+		}
+	}
+
+	if (hitBody)
+	{
+		const float length = impulse.Length();
+		hitBody->ApplyImpulse(length > MAX_REACTION_IMPULSE ? impulse * (MAX_REACTION_IMPULSE / length) : impulse,
+			position - hitBody->GetPosition());
+	}
+
+	reactionTimeLeft_ = REACTION_TIME;
+}
+
+void CreateRagdoll::EndReaction()
+{
+	if (activeChain_ == LIMB_NONE)
+		return;
+
+	Skeleton& skeleton = GetComponent<AnimatedModel>()->GetSkeleton();
+	for (unsigned i = 0; i < chainNodes_.size(); ++i)
+	{
+		Node* boneNode = chainNodes_[i];
+		if (!boneNode)
+			continue;
+
+		boneNode->RemoveComponent<Constraint>();
+		boneNode->RemoveComponent<RigidBody>();
+		boneNode->RemoveComponent<CollisionShape>();
+
+		// The anchor never left the animation
+		if (i == 0)
+			continue;
+
+		if (Bone* bone = skeleton.GetBone(boneNode->GetName()))
+			bone->animated_ = true;
+		const Quaternion rotation = boneNode->GetRotation();
+		blends_.push_back({ WeakPtr<Node>(boneNode), boneNode->GetPosition(), rotation, rotation, 0.0f });
+	}
+
+	chainNodes_.clear();
+	activeChain_ = LIMB_NONE;
+}
+
+void CreateRagdoll::HandleSceneDrawableUpdateFinished(StringHash eventType, VariantMap& eventData)
+{
+	using namespace SceneDrawableUpdateFinished;
+
+	const float timeStep = eventData[P_TIMESTEP].GetFloat();
+
+	if (activeChain_ != LIMB_NONE)
+	{
+		reactionTimeLeft_ -= timeStep;
+		if (reactionTimeLeft_ <= 0.0f)
+			EndReaction();
+	}
+
+	// The animation has just written the bones, move them from their last physical pose towards it
+	for (unsigned i = 0; i < blends_.size();)
+	{
+		BoneBlend& blend = blends_[i];
+		blend.time_ += timeStep;
+		Node* boneNode = blend.node_;
+		if (!boneNode || blend.time_ >= BLEND_TIME)
+		{
+			blends_.erase(blends_.begin() + i);
+			continue;
+		}
+
+		// Frozen or skipped animation leaves the bone where the blend put it
+		if (boneNode->GetRotation() != blend.lastRotation_)
+		{
+			const float weight = blend.time_ / BLEND_TIME;
+			blend.lastRotation_ = blend.rotation_.Slerp(boneNode->GetRotation(), weight);
+			boneNode->SetTransform(blend.position_.Lerp(boneNode->GetPosition(), weight), blend.lastRotation_);
+		}
+		++i;
+	}
+
+	if (activeChain_ == LIMB_NONE && blends_.empty())
+		UnsubscribeFromEvent(E_SCENEDRAWABLEUPDATEFINISHED);
+}
+
+void CreateRagdoll::Activate()
+{
+	// A simulated chain becomes part of the full ragdoll
+	EndReaction();
+
+	// We do not need the physics components in the AnimatedModel's root scene node anymore
+	node_->RemoveComponent<RigidBody>();
+	node_->RemoveComponent<CollisionShape>();
+
+	// Lower tiers leave the limb ends to follow their parent bone stiffly
+	const RagdollTier tier = GetRagdollTier(GetScene());
+
+	// Create RigidBody & CollisionShape components to bones
+	for (const RagdollBoneDesc& bone : RAGDOLL_BONES)
+	{
+		if (bone.tier_ >= tier)
+			CreateRagdollBone(bone.name_, bone.type_, bone.size_, bone.position_, bone.rotation_);
+	}
+
+	// Create Constraints between bones
+	for (const RagdollJointDesc& joint : RAGDOLL_JOINTS)
+	{
+		if (joint.tier_ >= tier)
+			CreateRagdollConstraint(joint.bone_, joint.parent_, joint.type_, joint.axis_, joint.parentAxis_,
+				joint.highLimit_, joint.lowLimit_, joint.disableCollision_);
+	}
+
+	// Disable keyframe animation from all bones so that they will not interfere with the ragdoll
+	auto* model = GetComponent<AnimatedModel>();
+	Skeleton& skeleton = model->GetSkeleton();
+	for (unsigned i = 0; i < skeleton.GetNumBones(); ++i)
+		skeleton.GetBone(i)->animated_ = false;
+	blends_.clear();
+
+	node_->RemoveComponent<Mover3D>();
+
+	// The bodies pose the bones once per frame instead of setting every bone node each physics step
+	const PerformanceProfile& profile = PerformanceProfiles::GetCurrent(context_);
+	if (profile.ragdollPose_)
+		node_->CreateComponent<RagdollPose>()->Attach();
+
+	auto* mdRemoveCom = node_->CreateComponent<MDRemoveCom>();
+	mdRemoveCom->ScheduleRemoval(profile.ragdollFrames_);
+
+	using namespace RagdollActivated;
+
+	VariantMap& activatedData = GetEventDataMap();
+	activatedData[P_NODE] = node_;
+	node_->SendEvent(E_RAGDOLLACTIVATED, activatedData);
+
+	// Finally remove self from the scene node. Note that this must be the last operation performed in the functio
+	Remove();
+}
+
+RigidBody* CreateRagdoll::CreateRagdollBone(const ea::string& boneName, ShapeType type, const Vector3& size,
+	const Vector3& position, const Quaternion& rotation)
 {
 	// Find the correct child scene node recursively
 	Node* boneNode = node_->GetChild(boneName, true);
 	if (!boneNode)
 	{
 		URHO3D_LOGWARNING("Could not find bone " + boneName + " for creating ragdoll physics components");
-		return;
+		return nullptr;
 	}
 
+	const PerformanceProfile& profile = PerformanceProfiles::GetCurrent(context_);
 	auto* body = boneNode->CreateComponent<RigidBody>();
 	// Set mass to make movable
 	body->SetMass(1.0f);
 	// Set damping parameters to smooth out the motion
-	body->SetLinearDamping(0.05f);
-	body->SetAngularDamping(0.85f);
+	body->SetLinearDamping(profile.ragdollLinearDamping_);
+	body->SetAngularDamping(profile.ragdollAngularDamping_);
 	// Set rest thresholds to ensure the ragdoll rigid bodies come to rest to not consume CPU endlessly
-	body->SetLinearRestThreshold(1.5f);
-	body->SetAngularRestThreshold(2.5f);
+	body->SetLinearRestThreshold(profile.ragdollLinearRest_);
+	body->SetAngularRestThreshold(profile.ragdollAngularRest_);
 
 	auto* shape = boneNode->CreateComponent<CollisionShape>();
 	// We use either a box or a capsule shape for all of the bones
@@ -218,6 +474,8 @@ void CreateRagdoll::CreateRagdollBone(const ea::string& boneName, ShapeType type
 		shape->SetBox(size, position, rotation);
 	else
 		shape->SetCapsule(size.x_, size.y_, position, rotation);
+
+	return body;
 }
 
 void CreateRagdoll::CreateRagdollConstraint(const ea::string& boneName, const ea::string& parentName, ConstraintType type,
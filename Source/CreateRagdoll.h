@@ -27,11 +27,31 @@
 
 using namespace Urho3D;
 
+/// Zombie was turned into a ragdoll.
+URHO3D_EVENT(E_RAGDOLLACTIVATED, RagdollActivated)
+{
+	URHO3D_PARAM(P_NODE, Node);                    // Node pointer
+}
+
 namespace MonsterDolls
 {
+	/// Collision layer of the zombie trigger bodies, used by projectile sweeps.
+	static const unsigned ZOMBIE_TRIGGER_LAYER = 2;
+
 	class Ragdolls;
 
-	/// Custom component that creates a ragdoll upon collision.
+	/// Limb chain simulated by a non-lethal hit.
+	enum LimbChain
+	{
+		LIMB_LEFT_ARM = 0,
+		LIMB_RIGHT_ARM,
+		LIMB_LEFT_LEG,
+		LIMB_RIGHT_LEG,
+		LIMB_TORSO,
+		LIMB_NONE
+	};
+
+	/// Custom component that makes the hit limb react upon collision and creates a ragdoll on a lethal one.
 	class CreateRagdoll : public Component
 	{
 		URHO3D_OBJECT(CreateRagdoll, Component);
@@ -41,6 +61,18 @@ namespace MonsterDolls
 		explicit CreateRagdoll(Context* context);
 
 		void SetRagdolls(Ragdolls* ragdolls) { ragdolls_ = ragdolls; }
+		/// Handle a hit at a world position by a source body, if any. A hit to the head or the last one the zombie
+		/// takes is lethal and activates the ragdoll, others simulate only the limb chain nearest to the hit for a
+		/// moment while the rest of the skeleton keeps animating. Repeated hits by the same body count once. Return
+		/// true if the hit was lethal, then this component was removed.
+		bool Hit(const Vector3& position, const Vector3& impulse, RigidBody* source = nullptr);
+		/// Turn the zombie into a ragdoll. Removes this component, so it must be the last call made on it.
+		void Activate();
+
+		/// Return number of non-lethal hits taken.
+		int GetNumHits() const { return numHits_; }
+		/// Return the limb chain being simulated, LIMB_NONE if none.
+		LimbChain GetActiveChain() const { return activeChain_; }
 	protected:
 		/// Handle node being assigned.
 		void OnNodeSet(Node* previousNode, Node* currentNode) override;
@@ -48,11 +80,44 @@ namespace MonsterDolls
 	private:
 		/// Handle scene node's physics collision.
 		void HandleNodeCollision(StringHash eventType, VariantMap& eventData);
+		/// Handle the end of the scene's drawable update, after the animation was applied.
+		void HandleSceneDrawableUpdateFinished(StringHash eventType, VariantMap& eventData);
+		/// Simulate a limb chain, pushing the bone nearest to the hit.
+		void StartReaction(LimbChain chain, const Vector3& position, const Vector3& impulse);
+		/// Remove the physics of the simulated chain and blend its bones back to the animation.
+		void EndReaction();
 		/// Make a bone physical by adding RigidBody and CollisionShape components.
-		void CreateRagdollBone(const ea::string& boneName, ShapeType type, const Vector3& size, const Vector3& position, const Quaternion& rotation);
+		RigidBody* CreateRagdollBone(const ea::string& boneName, ShapeType type, const Vector3& size, const Vector3& position, const Quaternion& rotation);
 		/// Join two bones with a Constraint component.
 		void CreateRagdollConstraint(const ea::string& boneName, const ea::string& parentName, ConstraintType type, const Vector3& axis, const Vector3& parentAxis, const Vector2& highLimit, const Vector2& lowLimit, bool disableCollision = true);
 
+		/// Bone returning from physics to the animation.
+		struct BoneBlend
+		{
+			/// Bone node.
+			WeakPtr<Node> node_;
+			/// Local position when the physics was removed.
+			Vector3 position_;
+			/// Local rotation when the physics was removed.
+			Quaternion rotation_;
+			/// Local rotation written last, the animation did not run since when it is unchanged.
+			Quaternion lastRotation_;
+			/// Time since the physics was removed.
+			float time_;
+		};
+
 		Ragdolls* ragdolls_ = 0;
+		/// Non-lethal hits taken.
+		int numHits_ = 0;
+		/// Body of the last hit.
+		WeakPtr<RigidBody> lastSource_;
+		/// Simulated limb chain.
+		LimbChain activeChain_ = LIMB_NONE;
+		/// Bones of the simulated chain, the kinematic anchor first.
+		ea::vector<WeakPtr<Node>> chainNodes_;
+		/// Time left to simulate the chain.
+		float reactionTimeLeft_ = 0.0f;
+		/// Bones blending back to the animation.
+		ea::vector<BoneBlend> blends_;
 	};
 }
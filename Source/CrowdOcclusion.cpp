@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include <EASTL/sort.h>
+
+#include "CrowdOcclusion.h"
+#include "Mover.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Default depth buffer resolution.
+const unsigned DEFAULT_WIDTH = 256;
+const unsigned DEFAULT_HEIGHT = 128;
+/// Consecutive hidden frames before a walker's animation freezes, so a walker flickering along an occluder edge
+/// keeps animating.
+const unsigned FREEZE_FRAMES = 3;
+
+}
+
+CrowdOcclusion::CrowdOcclusion(Context* context) :
+	Component(context)
+{
+	buffer_.SetSize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+}
+
+void CrowdOcclusion::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(CrowdOcclusion, HandleSceneUpdate));
+	else
+		UnsubscribeFromEvent(E_SCENEUPDATE);
+}
+
+void CrowdOcclusion::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+	numTested_ = 0;
+	numOccluded_ = 0;
+	if (!camera_ || !zombiesNode_)
+		return;
+
+	RasterizeOccluders();
+
+	nextHiddenFrames_.clear();
+	for (Node* zombie : zombiesNode_->GetChildren())
+	{
+		// Ragdolls are posed by physics, only walkers are animated
+		if (!zombie->HasComponent<Mover3D>())
+			continue;
+
+		auto* model = zombie->GetComponent<AnimatedModel>();
+		auto* animationController = zombie->GetComponent<AnimationController>();
+		if (!model || !animationController)
+			continue;
+
+		++numTested_;
+		unsigned hiddenFrames = 0;
+		if (!buffer_.IsVisible(model->GetWorldBoundingBox()))
+		{
+			auto it = hiddenFrames_.find(zombie->GetID());
+			hiddenFrames = (it != hiddenFrames_.end() ? it->second : 0) + 1;
+			nextHiddenFrames_[zombie->GetID()] = hiddenFrames;
+		}
+
+		const bool animate = hiddenFrames < FREEZE_FRAMES;
+		if (!animate)
+			++numOccluded_;
+		if (animationController->IsEnabled() != animate)
+			animationController->SetEnabled(animate);
+	}
+	hiddenFrames_.swap(nextHiddenFrames_);
+}
+
+void CrowdOcclusion::RasterizeOccluders()
+{
+	const Frustum& frustum = camera_->GetFrustum();
+	const Vector3 cameraPosition = camera_->GetNode()->GetWorldPosition();
+
+	occluders_.clear();
+	if (auto* octree = GetScene()->GetComponent<Octree>())
+	{
+		OccluderOctreeQuery query(occluders_, frustum, DRAWABLE_GEOMETRY, camera_->GetViewMask());
+		octree->GetDrawables(query);
+	}
+
+	// The nearest occluders cover most of the view
+	if (occluders_.size() > maxOccluders_)
+	{
+		ea::partial_sort(occluders_.begin(), occluders_.begin() + maxOccluders_, occluders_.end(),
+			[&](Drawable* lhs, Drawable* rhs)
+		{
+			return (lhs->GetWorldBoundingBox().Center() - cameraPosition).LengthSquared() <
+				(rhs->GetWorldBoundingBox().Center() - cameraPosition).LengthSquared();
+		});
+		occluders_.resize(maxOccluders_);
+	}
+
+	buffer_.Clear(camera_->GetProjection() * camera_->GetView(), camera_->GetNearClip());
+	for (Drawable* occluder : occluders_)
+		buffer_.AddOccluder(occluder->GetNode()->GetWorldTransform(), occluder->GetBoundingBox());
+}
@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+#include "OcclusionDepthBuffer.h"
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Camera;
+	class Drawable;
+}
+
+namespace MonsterDolls
+{
+	/// Freezes the animation of walkers hidden from the camera. Every scene update the nearest occluder drawables in
+	/// view are rasterized as boxes into a small depth buffer and every walker's bounding box is tested against it.
+	/// Walkers hidden for a few frames in a row get their AnimationController disabled, so no keyframes are sampled
+	/// and no skinning is redone for them, and are re-enabled as soon as they show again. Draw submission of hidden
+	/// models is left to the renderer's own occlusion buffer, which uses the same occluder flag. Occluders are taken
+	/// as their bounding boxes, so only drawables that fill their box, such as walls and crates, should be flagged.
+	class CrowdOcclusion : public Component
+	{
+		URHO3D_OBJECT(CrowdOcclusion, Component);
+
+	public:
+		/// Construct.
+		explicit CrowdOcclusion(Context* context);
+
+		/// Set camera the visibility is tested for.
+		void SetCamera(Camera* camera) { camera_ = camera; }
+		/// Set parent node of the zombies.
+		void SetTargets(Node* zombiesNode) { zombiesNode_ = zombiesNode; }
+		/// Set depth buffer resolution.
+		void SetResolution(unsigned width, unsigned height) { buffer_.SetSize(width, height); }
+		/// Set maximum number of occluders rasterized per frame.
+		void SetMaxOccluders(unsigned count) { maxOccluders_ = count; }
+
+		/// Return number of walkers tested in the last update.
+		unsigned GetNumTested() const { return numTested_; }
+		/// Return number of walkers with frozen animation after the last update.
+		unsigned GetNumOccluded() const { return numOccluded_; }
+		/// Return the depth buffer of the last update.
+		const OcclusionDepthBuffer& GetBuffer() const { return buffer_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle the scene update, before the animation controllers advance in the post-update.
+		void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+		/// Rasterize the nearest occluders in view.
+		void RasterizeOccluders();
+
+		/// Depth buffer.
+		OcclusionDepthBuffer buffer_;
+		/// Camera the visibility is tested for.
+		WeakPtr<Camera> camera_;
+		/// Parent node of the zombies.
+		WeakPtr<Node> zombiesNode_;
+		/// Occluder drawables scratch list.
+		ea::vector<Drawable*> occluders_;
+		/// Consecutive hidden frames by walker node ID.
+		ea::unordered_map<unsigned, unsigned> hiddenFrames_;
+		/// Hidden frames of the walkers still present, swapped with the above every update.
+		ea::unordered_map<unsigned, unsigned> nextHiddenFrames_;
+		/// Maximum number of occluders rasterized per frame.
+		unsigned maxOccluders_ = 32;
+		/// Walkers tested in the last update.
+		unsigned numTested_ = 0;
+		/// Walkers frozen after the last update.
+		unsigned numOccluded_ = 0;
+	};
+}
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "CrowdSkinning.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+CrowdSkinning::CrowdSkinning(Context* context) :
+	Component(context)
+{
+}
+
+void CrowdSkinning::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_SCENEDRAWABLEUPDATEFINISHED, URHO3D_HANDLER(CrowdSkinning, HandleDrawableUpdateFinished));
+	else
+		UnsubscribeFromEvent(E_SCENEDRAWABLEUPDATEFINISHED);
+}
+
+void CrowdSkinning::HandleDrawableUpdateFinished(StringHash eventType, VariantMap& eventData)
+{
+	Update();
+}
+
+void CrowdSkinning::Update()
+{
+	HiresTimer timer;
+	numModels_ = 0;
+	numBones_ = 0;
+	models_.clear();
+	if (!zombiesNode_)
+		return;
+
+	// Model nodes are refreshed here, their parents are shared by every chunk
+	for (Node* zombie : zombiesNode_->GetChildren())
+	{
+		auto* model = zombie->GetComponent<AnimatedModel>();
+		if (!model || !model->IsEnabledEffective() || !model->GetSkeleton().GetNumBones())
+			continue;
+		if (camera_ && camera_->GetFrustum().IsInsideFast(model->GetWorldBoundingBox()) == OUTSIDE)
+			continue;
+
+		zombie->GetWorldTransform();
+		models_.push_back(model);
+		numBones_ += model->GetSkeleton().GetNumBones();
+	}
+	numModels_ = models_.size();
+	if (models_.empty())
+		return;
+
+	auto* workQueue = GetSubsystem<WorkQueue>();
+	const unsigned numThreads = workQueue->GetNumThreads() + 1;
+	const unsigned chunkSize = Max(minChunkSize_, (models_.size() + numThreads - 1) / numThreads);
+	const unsigned numChunks = (models_.size() + chunkSize - 1) / chunkSize;
+
+	if (!parallel_ || numChunks == 1)
+	{
+		for (AnimatedModel* model : models_)
+			UpdateModel(model);
+	}
+	else
+	{
+		for (unsigned i = 0; i < numChunks; ++i)
+		{
+			SharedPtr<WorkItem> item = workQueue->GetFreeItem();
+			item->priority_ = M_MAX_UNSIGNED;
+			item->workFunction_ = UpdateChunk;
+			item->start_ = models_.data() + i * chunkSize;
+			item->end_ = models_.data() + Min((i + 1) * chunkSize, models_.size());
+			item->sendEvent_ = false;
+			workQueue->AddWorkItem(item);
+		}
+		workQueue->Complete(M_MAX_UNSIGNED);
+	}
+
+	updateTime_ = timer.GetUSec(false);
+}
+
+void CrowdSkinning::UpdateChunk(const WorkItem* item, unsigned threadIndex)
+{
+	auto* start = static_cast<AnimatedModel**>(item->start_);
+	auto* end = static_cast<AnimatedModel**>(item->end_);
+
+	for (AnimatedModel** model = start; model != end; ++model)
+		UpdateModel(*model);
+}
+
+void CrowdSkinning::UpdateModel(AnimatedModel* model)
+{
+	// Parents come before their children in the bone list, so every parent transform is already cached
+	const Skeleton& skeleton = model->GetSkeleton();
+	for (unsigned i = 0; i < skeleton.GetNumBones(); ++i)
+	{
+		if (Node* boneNode = skeleton.GetBone(i)->node_)
+			boneNode->GetWorldTransform();
+	}
+}
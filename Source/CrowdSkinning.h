@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class AnimatedModel;
+	class Camera;
+	struct WorkItem;
+}
+
+namespace MonsterDolls
+{
+	/// Resolves the bone world transforms of all animated zombies in view in parallel chunks on the work queue, after
+	/// the octree has applied this frame's animation and before the views are rendered. Every chunk walks its
+	/// models' bones parent first, so the lazily cached node world transforms are computed once, on the workers, and
+	/// the renderer's skinning update, which AnimatedModel keeps to itself, only reads them and multiplies by the
+	/// offset matrices. The serial mode runs the same chunks on the main thread.
+	class CrowdSkinning : public Component
+	{
+		URHO3D_OBJECT(CrowdSkinning, Component);
+
+	public:
+		/// Construct.
+		explicit CrowdSkinning(Context* context);
+
+		/// Set camera whose frustum selects the models, null takes every model.
+		void SetCamera(Camera* camera) { camera_ = camera; }
+		/// Set parent node of the zombies.
+		void SetTargets(Node* zombiesNode) { zombiesNode_ = zombiesNode; }
+		/// Set whether chunks run on the work queue or one after another on the main thread.
+		void SetParallel(bool enable) { parallel_ = enable; }
+		/// Set minimum number of models per work item.
+		void SetMinChunkSize(unsigned size) { minChunkSize_ = Max(size, 1u); }
+		/// Resolve bone world transforms now.
+		void Update();
+
+		/// Return whether chunks run on the work queue.
+		bool IsParallel() const { return parallel_; }
+		/// Return models of the last update.
+		const ea::vector<AnimatedModel*>& GetModels() const { return models_; }
+		/// Return number of models in the last update.
+		unsigned GetNumModels() const { return numModels_; }
+		/// Return number of bones in the last update.
+		unsigned GetNumBones() const { return numBones_; }
+		/// Return duration of the last update in microseconds.
+		long long GetUpdateTime() const { return updateTime_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle the octree having applied animations.
+		void HandleDrawableUpdateFinished(StringHash eventType, VariantMap& eventData);
+		/// Resolve the bones of a range of models.
+		static void UpdateChunk(const WorkItem* item, unsigned threadIndex);
+		/// Resolve the bones of one model.
+		static void UpdateModel(AnimatedModel* model);
+
+		/// Camera whose frustum selects the models.
+		WeakPtr<Camera> camera_;
+		/// Parent node of the zombies.
+		WeakPtr<Node> zombiesNode_;
+		/// Models of the last update, valid until the next scene update.
+		ea::vector<AnimatedModel*> models_;
+		/// Run chunks on the work queue.
+		bool parallel_ = true;
+		/// Minimum number of models per work item.
+		unsigned minChunkSize_ = 16;
+		/// Models in the last update.
+		unsigned numModels_ = 0;
+		/// Bones in the last update.
+		unsigned numBones_ = 0;
+		/// Duration of the last update.
+		long long updateTime_ = 0;
+	};
+}
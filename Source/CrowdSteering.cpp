@@ -0,0 +1,285 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "CrowdSteering.h"
+#include "ChunkedTerrain.h"
+#include "CreateRagdoll.h"
+#include "Mover.h"
+#include "SpatialQueries.h"
+
+#include <EASTL/algorithm.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Eye height of a walker above its feet.
+const Vector3 EYE_OFFSET(0.0f, 1.6f, 0.0f);
+/// Bodies blocking the sight: everything but the zombie triggers and the terrain chunks, whose collision is only
+/// streamed in under moving bodies. The terrain is tested against its height grid instead.
+const unsigned LINE_OF_SIGHT_MASK = M_MAX_UNSIGNED & ~(ZOMBIE_TRIGGER_LAYER | TERRAIN_LAYER);
+
+}
+
+CrowdSteering::CrowdSteering(Context* context) :
+	Component(context)
+{
+}
+
+void CrowdSteering::AddAgent(Mover3D* agent)
+{
+	if (ea::find(agents_.begin(), agents_.end(), agent) == agents_.end())
+		agents_.push_back(agent);
+}
+
+void CrowdSteering::RemoveAgent(Mover3D* agent)
+{
+	auto it = ea::find(agents_.begin(), agents_.end(), agent);
+	if (it != agents_.end())
+	{
+		*it = agents_.back();
+		agents_.pop_back();
+	}
+}
+
+void CrowdSteering::SetWeights(float separation, float alignment, float seek)
+{
+	separationWeight_ = separation;
+	alignmentWeight_ = alignment;
+	seekWeight_ = seek;
+}
+
+void CrowdSteering::OnSceneSet(Scene* scene)
+{
+	// Walkers moved by a logic phase are steered after each of its ticks, when they are not blended for rendering
+	if (scene && scene->HasComponent<ParallelLogicPhase>())
+		SubscribeToEvent(scene, E_LOGICPOSTTICK, URHO3D_HANDLER(CrowdSteering, HandleScenePostUpdate));
+	else if (scene)
+		SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(CrowdSteering, HandleScenePostUpdate));
+	else
+	{
+		UnsubscribeFromEvent(E_LOGICPOSTTICK);
+		UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+	}
+}
+
+void CrowdSteering::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace ScenePostUpdate;
+
+	if (agents_.empty())
+		return;
+
+	const unsigned numAgents = agents_.size();
+	positions_.resize(numAgents);
+	velocities_.resize(numAgents);
+	speeds_.resize(numAgents);
+	for (unsigned i = 0; i < numAgents; ++i)
+	{
+		const Vector3 position = agents_[i]->GetNode()->GetWorldPosition();
+		const Vector3 velocity = agents_[i]->GetVelocity();
+		positions_[i] = Vector2(position.x_, position.z_);
+		velocities_[i] = Vector2(velocity.x_, velocity.z_);
+		speeds_[i] = agents_[i]->GetMoveSpeed().Length();
+	}
+
+	HiresTimer timer;
+	BuildGrid();
+	gridBuildTime_ = timer.GetUSec(true);
+
+	ComputeVelocities(eventData[P_TIMESTEP].GetFloat());
+	queryTime_ = timer.GetUSec(false);
+
+	UpdateLineOfSight(eventData[P_TIMESTEP].GetFloat());
+}
+
+void CrowdSteering::UpdateLineOfSight(float timeStep)
+{
+	lineOfSightTimer_ += timeStep;
+	if (lineOfSightPending_ || lineOfSightTimer_ < lineOfSightInterval_ || !target_)
+		return;
+
+	auto* queries = GetScene()->GetComponent<SpatialQueries>();
+	if (!queries)
+		return;
+	lineOfSightTimer_ = 0.0f;
+
+	// One batch for the whole crowd, answered after the scene update. Walkers may be gone by then. The terrain
+	// has collision only near dynamic bodies, its height grid is sampled along the rays instead
+	const Vector3 targetPosition = target_->GetWorldPosition();
+	const auto* terrain = GetScene()->GetComponent<ChunkedTerrain>(true);
+	ea::vector<QueryRay> rays(agents_.size());
+	ea::vector<WeakPtr<Mover3D> > agents(agents_.size());
+	ea::vector<bool> groundBlocked(agents_.size());
+	for (unsigned i = 0; i < agents_.size(); ++i)
+	{
+		rays[i] = QueryRay{ agents_[i]->GetNode()->GetWorldPosition() + EYE_OFFSET, targetPosition };
+		agents[i] = agents_[i];
+		groundBlocked[i] = terrain && terrain->IsSegmentBlocked(rays[i].start_, rays[i].end_);
+	}
+
+	lineOfSightPending_ = true;
+	WeakPtr<CrowdSteering> self(this);
+	queries->CastRays(ea::move(rays), LINE_OF_SIGHT_MASK,
+		[self, agents = ea::move(agents), groundBlocked = ea::move(groundBlocked)]
+		(const ea::vector<PhysicsRaycastResult>& results)
+	{
+		for (unsigned i = 0; i < agents.size(); ++i)
+		{
+			if (agents[i])
+				agents[i]->SetTargetVisible(!results[i].body_ && !groundBlocked[i]);
+		}
+		if (self)
+			self->lineOfSightPending_ = false;
+	});
+}
+
+void CrowdSteering::BuildGrid()
+{
+	const unsigned numAgents = agents_.size();
+
+	// Twice as many slots as walkers keeps hash collisions between occupied cells rare
+	numSlots_ = NextPowerOfTwo(Max(numAgents * 2, 64u));
+	agentSlots_.resize(numAgents);
+	slotStarts_.resize(numSlots_ + 1);
+	sortedAgents_.resize(numAgents);
+
+	// Counting sort of the walkers by slot: count, prefix sum, scatter
+	ea::fill(slotStarts_.begin(), slotStarts_.end(), 0u);
+	const float invCellSize = 1.0f / neighbourRadius_;
+	for (unsigned i = 0; i < numAgents; ++i)
+	{
+		const int x = FloorToInt(positions_[i].x_ * invCellSize);
+		const int z = FloorToInt(positions_[i].y_ * invCellSize);
+		agentSlots_[i] = GetCellSlot(x, z);
+		++slotStarts_[agentSlots_[i] + 1];
+	}
+
+	for (unsigned i = 1; i <= numSlots_; ++i)
+		slotStarts_[i] += slotStarts_[i - 1];
+
+	for (unsigned i = 0; i < numAgents; ++i)
+		sortedAgents_[slotStarts_[agentSlots_[i]]++] = i;
+
+	// Scattering advanced every start to the end of its slot, shift them back
+	for (unsigned i = numSlots_; i > 0; --i)
+		slotStarts_[i] = slotStarts_[i - 1];
+	slotStarts_[0] = 0;
+}
+
+void CrowdSteering::ComputeVelocities(float timeStep)
+{
+	const unsigned numAgents = agents_.size();
+	const float invCellSize = 1.0f / neighbourRadius_;
+	const float neighbourRadiusSquared = neighbourRadius_ * neighbourRadius_;
+	const float separationRadiusSquared = separationRadius_ * separationRadius_;
+	const float maxDelta = maxAcceleration_ * timeStep;
+
+	Vector2 target;
+	if (target_)
+	{
+		const Vector3 targetPosition = target_->GetWorldPosition();
+		target = Vector2(targetPosition.x_, targetPosition.z_);
+	}
+
+	unsigned numTests = 0;
+	for (unsigned i = 0; i < numAgents; ++i)
+	{
+		const Vector2 position = positions_[i];
+		const int cellX = FloorToInt(position.x_ * invCellSize);
+		const int cellZ = FloorToInt(position.y_ * invCellSize);
+
+		Vector2 separation = Vector2::ZERO;
+		Vector2 alignment = Vector2::ZERO;
+		unsigned numNeighbours = 0;
+
+		// Neighbouring cells may hash to the same slot, which must be scanned only once
+		unsigned slots[9];
+		unsigned numSlots = 0;
+		for (int z = cellZ - 1; z <= cellZ + 1; ++z)
+		{
+			for (int x = cellX - 1; x <= cellX + 1; ++x)
+			{
+				const unsigned slot = GetCellSlot(x, z);
+				if (ea::find(slots, slots + numSlots, slot) == slots + numSlots)
+					slots[numSlots++] = slot;
+			}
+		}
+
+		for (unsigned s = 0; s < numSlots; ++s)
+		{
+			for (unsigned k = slotStarts_[slots[s]]; k < slotStarts_[slots[s] + 1]; ++k)
+			{
+				const unsigned j = sortedAgents_[k];
+				if (j == i)
+					continue;
+
+				// Slots may hold walkers of other cells, the distance test filters them out
+				++numTests;
+				const Vector2 offset = position - positions_[j];
+				const float distanceSquared = offset.LengthSquared();
+				if (distanceSquared >= neighbourRadiusSquared)
+					continue;
+
+				alignment += velocities_[j];
+				++numNeighbours;
+				if (distanceSquared < separationRadiusSquared && distanceSquared > M_EPSILON)
+					separation += offset / distanceSquared;
+			}
+		}
+
+		const float speed = speeds_[i];
+		Vector2 desired = velocities_[i];
+		if (target_ && agents_[i]->IsTargetVisible())
+		{
+			const Vector2 toTarget = target - position;
+			const float distance = toTarget.Length();
+			if (distance > M_EPSILON)
+				desired += toTarget / distance * speed * seekWeight_;
+		}
+		if (numNeighbours)
+			desired += (alignment / (float)numNeighbours - velocities_[i]) * alignmentWeight_;
+		desired += separation * separationWeight_;
+
+		// Walkers keep their own pace, steering only turns and spreads them
+		const float desiredLength = desired.Length();
+		if (desiredLength > M_EPSILON)
+			desired *= speed / desiredLength;
+
+		Vector2 delta = desired - velocities_[i];
+		const float deltaLength = delta.Length();
+		if (deltaLength > maxDelta)
+			delta *= maxDelta / deltaLength;
+
+		const Vector2 velocity = velocities_[i] + delta;
+		agents_[i]->SetVelocity(Vector3(velocity.x_, 0.0f, velocity.y_));
+	}
+
+	numNeighbourTests_ = numTests;
+}
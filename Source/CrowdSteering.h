@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	class Mover3D;
+
+	/// Steering of the walking zombies. Every frame the walkers are binned into a uniform spatial hash grid with
+	/// cells as large as the neighbour radius, so the separation and alignment forces only look at the 3 x 3 cells
+	/// around each walker. A seek force pulls the walkers that see the target node towards it. The new velocities are
+	/// used by Mover3D on the next frame. With SpatialQueries in the scene the line of sight of the whole crowd is
+	/// checked as one batch of rays every interval, walkers without it keep their heading.
+	class CrowdSteering : public Component
+	{
+		URHO3D_OBJECT(CrowdSteering, Component);
+
+	public:
+		/// Construct.
+		explicit CrowdSteering(Context* context);
+
+		/// Add a walker.
+		void AddAgent(Mover3D* agent);
+		/// Remove a walker.
+		void RemoveAgent(Mover3D* agent);
+
+		/// Set the node walkers seek, usually the camera.
+		void SetTarget(Node* target) { target_ = target; }
+		/// Set neighbour radius and grid cell size.
+		void SetNeighbourRadius(float radius) { neighbourRadius_ = Max(radius, 0.1f); }
+		/// Set distance walkers try to keep from each other.
+		void SetSeparationRadius(float radius) { separationRadius_ = radius; }
+		/// Set force weights.
+		void SetWeights(float separation, float alignment, float seek);
+		/// Set maximum change of velocity per second.
+		void SetMaxAcceleration(float acceleration) { maxAcceleration_ = acceleration; }
+		/// Set seconds between line of sight checks.
+		void SetLineOfSightInterval(float interval) { lineOfSightInterval_ = interval; }
+
+		/// Return number of walkers.
+		unsigned GetNumAgents() const { return agents_.size(); }
+		/// Return grid build time of the last frame in microseconds.
+		long long GetGridBuildTime() const { return gridBuildTime_; }
+		/// Return neighbour query and force time of the last frame in microseconds.
+		long long GetQueryTime() const { return queryTime_; }
+		/// Return neighbours visited in the last frame.
+		unsigned GetNumNeighbourTests() const { return numNeighbourTests_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle scene post-update, or the logic tick end when a logic phase moves the walkers.
+		void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+		/// Bin walker positions into the hash grid.
+		void BuildGrid();
+		/// Compute new walker velocities from their neighbours.
+		void ComputeVelocities(float timeStep);
+		/// Request the line of sight of every walker to the target once the interval passed.
+		void UpdateLineOfSight(float timeStep);
+		/// Return hash table slot of a cell.
+		unsigned GetCellSlot(int x, int z) const { return ((unsigned)x * 73856093u ^ (unsigned)z * 19349663u) & (numSlots_ - 1); }
+
+		/// Walkers.
+		ea::vector<Mover3D*> agents_;
+		/// Walker positions on the ground plane, gathered every frame.
+		ea::vector<Vector2> positions_;
+		/// Walker velocities on the ground plane, gathered every frame.
+		ea::vector<Vector2> velocities_;
+		/// Walker preferred speeds.
+		ea::vector<float> speeds_;
+		/// Hash table slot of every walker.
+		ea::vector<unsigned> agentSlots_;
+		/// Start of every slot in the sorted walker list, plus one end marker.
+		ea::vector<unsigned> slotStarts_;
+		/// Walker indices sorted by slot.
+		ea::vector<unsigned> sortedAgents_;
+		/// Number of hash table slots, power of two.
+		unsigned numSlots_ = 0;
+		/// Seek target.
+		WeakPtr<Node> target_;
+		/// Neighbour radius and cell size.
+		float neighbourRadius_ = 2.0f;
+		/// Personal space radius.
+		float separationRadius_ = 1.0f;
+		/// Separation force weight.
+		float separationWeight_ = 2.0f;
+		/// Alignment force weight.
+		float alignmentWeight_ = 0.3f;
+		/// Seek force weight.
+		float seekWeight_ = 1.0f;
+		/// Maximum change of velocity per second.
+		float maxAcceleration_ = 6.0f;
+		/// Seconds between line of sight checks.
+		float lineOfSightInterval_ = 0.25f;
+		/// Seconds since the last line of sight check.
+		float lineOfSightTimer_ = 0.0f;
+		/// Line of sight check requested and not answered yet.
+		bool lineOfSightPending_ = false;
+		/// Grid build time of the last frame.
+		long long gridBuildTime_ = 0;
+		/// Query time of the last frame.
+		long long queryTime_ = 0;
+		/// Neighbours visited in the last frame.
+		unsigned numNeighbourTests_ = 0;
+	};
+}
@@ -0,0 +1,305 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "GameplayTasks.h"
+#include "CreateRagdoll.h"
+
+#include <EASTL/heap.h>
+
+#include <exception>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Heap order of the delays, the earliest on top.
+struct TimerLater
+{
+	template <class T> bool operator ()(const T& lhs, const T& rhs) const
+	{
+		return lhs.time_ != rhs.time_ ? lhs.time_ > rhs.time_ : lhs.sequence_ > rhs.sequence_;
+	}
+};
+
+/// Return the scene of a node or component sending an event, null for other senders.
+Scene* GetSenderScene(Object* sender)
+{
+	if (sender && sender->IsInstanceOf<Node>())
+		return static_cast<Node*>(sender)->GetScene();
+	if (sender && sender->IsInstanceOf<Component>())
+		return static_cast<Component*>(sender)->GetScene();
+	return nullptr;
+}
+
+}
+
+void GameplayTask::FinalAwaiter::await_suspend(Handle handle) noexcept
+{
+	handle.promise().scheduler_->Finish(handle);
+}
+
+void GameplayTask::promise_type::unhandled_exception()
+{
+	std::terminate();
+}
+
+GameplayTask::~GameplayTask()
+{
+	if (handle_)
+		handle_.destroy();
+}
+
+GameplayScheduler::GameplayScheduler(Context* context) :
+	Component(context)
+{
+}
+
+GameplayScheduler::~GameplayScheduler()
+{
+	StopAll();
+}
+
+GameplayScheduler* GameplayScheduler::Get(Scene* scene)
+{
+	return scene->GetOrCreateComponent<GameplayScheduler>();
+}
+
+unsigned GameplayScheduler::CountLiveZombies(Node* zombiesNode)
+{
+	if (!zombiesNode)
+		return 0;
+
+	// Ragdolls lose the trigger component, zombies that walked out of the arena keep it until removed
+	unsigned count = 0;
+	for (Node* zombie : zombiesNode->GetChildren())
+		count += zombie->HasComponent<CreateRagdoll>();
+	return count;
+}
+
+void GameplayScheduler::OnSceneSet(Scene* scene)
+{
+	// Scripts end with the scene they play in
+	if (!scene)
+		StopAll();
+}
+
+void GameplayScheduler::Start(GameplayTask task)
+{
+	GameplayTask::Handle handle = task.Release();
+	if (!handle)
+		return;
+
+	handle.promise().scheduler_ = this;
+	tasks_.insert(handle.address());
+	handle.resume();
+}
+
+void GameplayScheduler::StopAll()
+{
+	for (const auto& pair : eventWaits_)
+		UnsubscribeFromEvent(pair.first);
+	eventWaits_.clear();
+	timers_.clear();
+	nextFrame_.clear();
+	zombiesWaits_.clear();
+	zombiesChanged_ = false;
+	UnsubscribeZombieRemovals();
+	UpdateSubscription();
+
+	// Destroying a script may release objects whose destructors start or stop other scripts
+	ea::unordered_set<void*> tasks;
+	tasks.swap(tasks_);
+	for (void* address : tasks)
+		std::coroutine_handle<>::from_address(address).destroy();
+}
+
+void GameplayScheduler::AddTimer(float seconds, std::coroutine_handle<> handle)
+{
+	timers_.push_back(Timer{ time_ + seconds, timerSequence_++, handle });
+	ea::push_heap(timers_.begin(), timers_.end(), TimerLater());
+	UpdateSubscription();
+}
+
+void GameplayScheduler::AddNextFrame(std::coroutine_handle<> handle)
+{
+	nextFrame_.push_back(handle);
+	UpdateSubscription();
+}
+
+void GameplayScheduler::AddEventWait(EventAwaiter* awaiter, std::coroutine_handle<> handle)
+{
+	if (!HasSubscribedToEvent(awaiter->eventType_))
+		SubscribeToEvent(awaiter->eventType_, URHO3D_HANDLER(GameplayScheduler, HandleEvent));
+	eventWaits_[awaiter->eventType_].push_back(EventWait{ awaiter, handle });
+}
+
+void GameplayScheduler::AddZombiesWait(Node* zombiesNode, std::coroutine_handle<> handle)
+{
+	Scene* scene = GetScene();
+	if (zombiesWaits_.empty() && scene)
+	{
+		SubscribeToEvent(scene, E_COMPONENTREMOVED, URHO3D_HANDLER(GameplayScheduler, HandleZombieRemoved));
+		SubscribeToEvent(scene, E_NODEREMOVED, URHO3D_HANDLER(GameplayScheduler, HandleZombieRemoved));
+	}
+	zombiesWaits_.push_back(ZombiesWait{ WeakPtr<Node>(zombiesNode), handle });
+}
+
+void GameplayScheduler::UnsubscribeZombieRemovals()
+{
+	UnsubscribeFromEvent(E_COMPONENTREMOVED);
+	UnsubscribeFromEvent(E_NODEREMOVED);
+}
+
+void GameplayScheduler::Finish(GameplayTask::Handle handle)
+{
+	tasks_.erase(handle.address());
+	handle.destroy();
+}
+
+void GameplayScheduler::Resume(std::coroutine_handle<> handle)
+{
+	if (tasks_.find(handle.address()) != tasks_.end())
+		handle.resume();
+}
+
+void GameplayScheduler::UpdateSubscription()
+{
+	Scene* scene = GetScene();
+	const bool needed = scene && (!timers_.empty() || !nextFrame_.empty() || zombiesChanged_);
+	if (needed == updateSubscribed_)
+		return;
+
+	if (needed)
+		SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(GameplayScheduler, HandleSceneUpdate));
+	else
+		UnsubscribeFromEvent(E_SCENEUPDATE);
+	updateSubscribed_ = needed;
+}
+
+void GameplayScheduler::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace SceneUpdate;
+
+	time_ += eventData[P_TIMESTEP].GetFloat();
+
+	// Collect everything due first, resumed scripts schedule their next wait for a later update
+	ea::vector<std::coroutine_handle<> > ready;
+	while (!timers_.empty() && timers_.front().time_ <= time_)
+	{
+		ea::pop_heap(timers_.begin(), timers_.end(), TimerLater());
+		ready.push_back(timers_.back().handle_);
+		timers_.pop_back();
+	}
+
+	ready.insert(ready.end(), nextFrame_.begin(), nextFrame_.end());
+	nextFrame_.clear();
+
+	if (zombiesChanged_)
+	{
+		zombiesChanged_ = false;
+		for (unsigned i = 0; i < zombiesWaits_.size();)
+		{
+			Node* zombiesNode = zombiesWaits_[i].zombiesNode_;
+			if (!zombiesNode || !zombiesNode->GetScene() || !CountLiveZombies(zombiesNode))
+			{
+				ready.push_back(zombiesWaits_[i].handle_);
+				zombiesWaits_.erase(zombiesWaits_.begin() + i);
+			}
+			else
+				++i;
+		}
+		if (zombiesWaits_.empty())
+			UnsubscribeZombieRemovals();
+	}
+
+	for (std::coroutine_handle<> handle : ready)
+		Resume(handle);
+	UpdateSubscription();
+}
+
+void GameplayScheduler::HandleEvent(StringHash eventType, VariantMap& eventData)
+{
+	auto it = eventWaits_.find(eventType);
+	if (it == eventWaits_.end())
+		return;
+
+	Object* sender = GetEventSender();
+	Scene* senderScene = GetSenderScene(sender);
+
+	ea::vector<std::coroutine_handle<> > ready;
+	ea::vector<EventWait>& waits = it->second;
+	for (unsigned i = 0; i < waits.size();)
+	{
+		EventAwaiter* awaiter = waits[i].awaiter_;
+		const bool accepted = awaiter->anySender_ ? !sender || !senderScene || senderScene == GetScene() :
+			sender && awaiter->sender_.Get() == sender;
+		if (accepted)
+		{
+			awaiter->eventData_ = eventData;
+			ready.push_back(waits[i].handle_);
+			waits.erase(waits.begin() + i);
+		}
+		else
+			++i;
+	}
+
+	for (std::coroutine_handle<> handle : ready)
+		Resume(handle);
+
+	// Unsubscribe only now: a script waiting for the same event again must not receive this one a second time
+	it = eventWaits_.find(eventType);
+	if (it != eventWaits_.end() && it->second.empty())
+	{
+		eventWaits_.erase(it);
+		UnsubscribeFromEvent(eventType);
+	}
+}
+
+void GameplayScheduler::HandleZombieRemoved(StringHash eventType, VariantMap& eventData)
+{
+	// Only trigger removals, and zombies or whole crowds leaving the scene, can end a wait
+	if (eventType == E_COMPONENTREMOVED)
+	{
+		auto* component = static_cast<Component*>(eventData[ComponentRemoved::P_COMPONENT].GetPtr());
+		if (!component || component->GetType() != CreateRagdoll::GetTypeStatic())
+			return;
+	}
+	else
+	{
+		auto* parent = static_cast<Node*>(eventData[NodeRemoved::P_PARENT].GetPtr());
+		auto* node = static_cast<Node*>(eventData[NodeRemoved::P_NODE].GetPtr());
+		bool watched = false;
+		for (const ZombiesWait& wait : zombiesWaits_)
+			watched |= wait.zombiesNode_.Get() == parent || wait.zombiesNode_.Get() == node;
+		if (!watched)
+			return;
+	}
+
+	zombiesChanged_ = true;
+	UpdateSubscription();
+}
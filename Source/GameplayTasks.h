@@ -0,0 +1,266 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+#include <EASTL/unordered_map.h>
+#include <EASTL/unordered_set.h>
+
+#include <coroutine>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	class GameplayScheduler;
+
+	/// Coroutine of a gameplay script, e.g. a wave sequence. Created suspended, it runs once handed to
+	/// GameplayScheduler::Start, which owns it from then on until it returns or the scheduler goes away. Scripts
+	/// suspend with co_await on the awaitables of the scheduler and must hold scene objects weakly across them.
+	class GameplayTask
+	{
+	public:
+		struct promise_type;
+		using Handle = std::coroutine_handle<promise_type>;
+
+		/// Hands the finished coroutine back to its scheduler.
+		struct FinalAwaiter
+		{
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(Handle handle) noexcept;
+			void await_resume() const noexcept {}
+		};
+
+		/// Coroutine promise.
+		struct promise_type
+		{
+			GameplayTask get_return_object() { return GameplayTask(Handle::from_promise(*this)); }
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			FinalAwaiter final_suspend() const noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception();
+
+			/// Scheduler owning the coroutine.
+			GameplayScheduler* scheduler_ = nullptr;
+		};
+
+		/// Construct empty.
+		GameplayTask() = default;
+		/// Construct from a coroutine handle.
+		explicit GameplayTask(Handle handle) : handle_(handle) {}
+		/// Move-construct.
+		GameplayTask(GameplayTask&& other) noexcept : handle_(other.Release()) {}
+		/// Destruct. Destroys the coroutine if it was never started.
+		~GameplayTask();
+
+		GameplayTask(const GameplayTask&) = delete;
+		GameplayTask& operator =(const GameplayTask&) = delete;
+
+		/// Give up ownership of the coroutine.
+		Handle Release() { Handle handle = handle_; handle_ = nullptr; return handle; }
+
+	private:
+		/// Coroutine, null once released.
+		Handle handle_;
+	};
+
+	/// Runs the gameplay scripts of a scene on the main thread. Suspended scripts cost nothing per frame: delays sit
+	/// in a min-heap by due time, so a scene update only looks at its top, and event waits subscribe to their event
+	/// only while someone waits for it. The scene update is only subscribed while delays or next frame waits exist.
+	class GameplayScheduler : public Component
+	{
+		URHO3D_OBJECT(GameplayScheduler, Component);
+
+	public:
+		/// Awaitable resuming once the given seconds of scene time passed.
+		struct DelayAwaiter
+		{
+			bool await_ready() const { return seconds_ <= 0.0f; }
+			void await_suspend(std::coroutine_handle<> handle) { scheduler_->AddTimer(seconds_, handle); }
+			void await_resume() const {}
+
+			/// Scheduler.
+			GameplayScheduler* scheduler_;
+			/// Delay in seconds.
+			float seconds_;
+		};
+
+		/// Awaitable resuming in the next scene update.
+		struct NextFrameAwaiter
+		{
+			bool await_ready() const { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { scheduler_->AddNextFrame(handle); }
+			void await_resume() const {}
+
+			/// Scheduler.
+			GameplayScheduler* scheduler_;
+		};
+
+		/// Awaitable resuming when an event is sent, giving its event data.
+		struct EventAwaiter
+		{
+			bool await_ready() const { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { scheduler_->AddEventWait(this, handle); }
+			VariantMap await_resume() { return ea::move(eventData_); }
+
+			/// Scheduler.
+			GameplayScheduler* scheduler_;
+			/// Event type.
+			StringHash eventType_;
+			/// Sender to wait for.
+			WeakPtr<Object> sender_;
+			/// Accept any sender of the scene instead.
+			bool anySender_;
+			/// Data of the received event.
+			VariantMap eventData_;
+		};
+
+		/// Awaitable resuming when no zombie under a node is left alive.
+		struct ZombiesDeadAwaiter
+		{
+			bool await_ready() const { return !GameplayScheduler::CountLiveZombies(zombiesNode_); }
+			void await_suspend(std::coroutine_handle<> handle) { scheduler_->AddZombiesWait(zombiesNode_, handle); }
+			void await_resume() const {}
+
+			/// Scheduler.
+			GameplayScheduler* scheduler_;
+			/// Parent node of the zombies.
+			Node* zombiesNode_;
+		};
+
+		/// Construct.
+		explicit GameplayScheduler(Context* context);
+		/// Destruct. Destroys the scripts still running.
+		~GameplayScheduler() override;
+
+		/// Run a script until it first suspends and keep it until it returns.
+		void Start(GameplayTask task);
+		/// Destroy every running script.
+		void StopAll();
+
+		/// Suspend for seconds of scene time.
+		DelayAwaiter Delay(float seconds) { return { this, seconds }; }
+		/// Suspend until the next scene update.
+		NextFrameAwaiter NextFrame() { return { this }; }
+		/// Suspend until the event is sent by the sender, or by any node or component of the scene when null.
+		EventAwaiter WaitEvent(StringHash eventType, Object* sender = nullptr)
+		{
+			return { this, eventType, WeakPtr<Object>(sender), !sender };
+		}
+		/// Suspend until every zombie under the node is a ragdoll or gone.
+		ZombiesDeadAwaiter AllZombiesDead(Node* zombiesNode) { return { this, zombiesNode }; }
+
+		/// Return number of running scripts.
+		unsigned GetNumTasks() const { return tasks_.size(); }
+		/// Return number of scripts waiting for a delay or the next frame, the ones the scene update looks at.
+		unsigned GetNumScheduled() const { return timers_.size() + nextFrame_.size(); }
+		/// Return the scheduler clock. It only advances with the scene updates while delays or next frame waits are
+		/// pending, and stands still while the scripts only wait for events.
+		double GetTime() const { return time_; }
+
+		/// Return the scheduler of a scene, created on first use.
+		static GameplayScheduler* Get(Scene* scene);
+		/// Return number of zombies under a node that still carry their hit trigger.
+		static unsigned CountLiveZombies(Node* zombiesNode);
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		friend struct GameplayTask::FinalAwaiter;
+
+		/// Pending delay.
+		struct Timer
+		{
+			/// Scheduler clock to resume at.
+			double time_;
+			/// Order of scheduling, resumes timers due at the same time first come first served.
+			unsigned sequence_;
+			/// Suspended script.
+			std::coroutine_handle<> handle_;
+		};
+
+		/// Pending event wait.
+		struct EventWait
+		{
+			/// Awaiter living in the suspended script.
+			EventAwaiter* awaiter_;
+			/// Suspended script.
+			std::coroutine_handle<> handle_;
+		};
+
+		/// Pending wait for a dead crowd.
+		struct ZombiesWait
+		{
+			/// Parent node of the zombies.
+			WeakPtr<Node> zombiesNode_;
+			/// Suspended script.
+			std::coroutine_handle<> handle_;
+		};
+
+		/// Schedule a delay.
+		void AddTimer(float seconds, std::coroutine_handle<> handle);
+		/// Schedule a resume in the next scene update.
+		void AddNextFrame(std::coroutine_handle<> handle);
+		/// Wait for an event, subscribing to it for the first waiter.
+		void AddEventWait(EventAwaiter* awaiter, std::coroutine_handle<> handle);
+		/// Wait for a dead crowd, watching zombie removals for the first waiter.
+		void AddZombiesWait(Node* zombiesNode, std::coroutine_handle<> handle);
+		/// Destroy a script that returned.
+		void Finish(GameplayTask::Handle handle);
+		/// Resume a script unless it was stopped meanwhile.
+		void Resume(std::coroutine_handle<> handle);
+		/// Stop watching zombie removals.
+		void UnsubscribeZombieRemovals();
+		/// Subscribe to the scene update while anything is due there, unsubscribe otherwise.
+		void UpdateSubscription();
+
+		/// Handle scene update: advance the time, resume due delays, next frame waits and dead crowds.
+		void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+		/// Handle an event someone waits for.
+		void HandleEvent(StringHash eventType, VariantMap& eventData);
+		/// Handle a zombie trigger or node going away.
+		void HandleZombieRemoved(StringHash eventType, VariantMap& eventData);
+
+		/// Running scripts by coroutine address.
+		ea::unordered_set<void*> tasks_;
+		/// Delays as a min-heap by due time.
+		ea::vector<Timer> timers_;
+		/// Scripts resumed in the next scene update.
+		ea::vector<std::coroutine_handle<> > nextFrame_;
+		/// Event waits by event type.
+		ea::unordered_map<StringHash, ea::vector<EventWait> > eventWaits_;
+		/// Waits for dead crowds.
+		ea::vector<ZombiesWait> zombiesWaits_;
+		/// Scheduler clock, advanced by the scene updates received while delays or next frame waits are pending.
+		double time_ = 0.0;
+		/// Timers scheduled so far.
+		unsigned timerSequence_ = 0;
+		/// A zombie went away since the waits were last checked.
+		bool zombiesChanged_ = false;
+		/// Subscribed to the scene update.
+		bool updateSubscribed_ = false;
+	};
+}
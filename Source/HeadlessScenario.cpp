@@ -0,0 +1,185 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+
+#include "HeadlessScenario.h"
+#include "ParallelLogic.h"
+#include "CreateRagdoll.h"
+#include "CrowdSteering.h"
+#include "Mover.h"
+#include "Ragdolls.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+ea::string ScenarioMetrics::GetCSVHeader()
+{
+	return "steps,shots,ragdolls,arrived,bodies,wall_ms,avg_step_ms,max_step_ms";
+}
+
+ea::string ScenarioMetrics::ToCSV() const
+{
+	return Format("{},{},{},{},{},{:.3f},{:.4f},{:.4f}", steps_, shotsFired_, ragdollsActivated_, zombiesArrived_,
+		rigidBodies_, wallTime_, averageStep_, maxStep_);
+}
+
+HeadlessScenario::HeadlessScenario(Context* context) :
+	Object(context)
+{
+	Ragdolls::RegisterComponents(context);
+}
+
+void HeadlessScenario::Create(const ScenarioParameters& parameters)
+{
+	parameters_ = parameters;
+	metrics_ = ScenarioMetrics();
+	SetRandomSeed(parameters_.seed_);
+
+	scene_ = new Scene(context_);
+	scene_->CreateComponent<Octree>();
+	auto* physicsWorld = scene_->CreateComponent<PhysicsWorld>();
+	physicsWorld->SetFps(parameters_.physicsFps_);
+	// Steps are driven by Run(), there is no render frame to interpolate for
+	physicsWorld->SetInterpolation(false);
+
+	Ragdolls::CreateFloor(scene_);
+	scene_->CreateComponent<ParallelLogicPhase>();
+
+	auto* steering = scene_->CreateComponent<CrowdSteering>();
+	gunNode_ = scene_->CreateChild("Gun");
+	gunNode_->SetPosition(gunPosition_);
+	steering->SetTarget(gunNode_);
+
+	zombiesNode_ = scene_->CreateChild("Zombie");
+	Ragdolls::CreateZombies(zombiesNode_, parameters_.numZombies_, nullptr);
+
+	bot_ = nullptr;
+	if (parameters_.bot_)
+	{
+		bot_ = gunNode_->CreateComponent<ShooterBot>();
+		bot_->SetProfile(parameters_.botProfile_);
+		bot_->SetTargets(zombiesNode_);
+	}
+
+	SubscribeToEvent(E_RAGDOLLACTIVATED, URHO3D_HANDLER(HeadlessScenario, HandleRagdollActivated));
+	SubscribeToEvent(E_ZOMBIEARRIVED, URHO3D_HANDLER(HeadlessScenario, HandleZombieArrived));
+}
+
+void HeadlessScenario::Run()
+{
+	if (!scene_)
+		return;
+
+	HiresTimer wallTimer;
+	HiresTimer stepTimer;
+	long long totalStep = 0;
+	long long maxStep = 0;
+	float shotTimer = 0.0f;
+
+	for (float time = 0.0f; time < parameters_.duration_; time += parameters_.timeStep_)
+	{
+		if (bot_)
+		{
+			while (bot_->TakeShot())
+				Fire(gunNode_->GetWorldRotation());
+		}
+		else
+		{
+			shotTimer += parameters_.timeStep_;
+			if (shotTimer >= parameters_.shotInterval_)
+			{
+				shotTimer -= parameters_.shotInterval_;
+				Shoot();
+			}
+		}
+
+		stepTimer.Reset();
+		scene_->Update(parameters_.timeStep_);
+		const long long step = stepTimer.GetUSec(false);
+
+		totalStep += step;
+		maxStep = Max(maxStep, step);
+		++metrics_.steps_;
+	}
+
+	ea::vector<RigidBody*> bodies;
+	scene_->GetComponents<RigidBody>(bodies, true);
+
+	metrics_.rigidBodies_ = bodies.size();
+	metrics_.wallTime_ = wallTimer.GetUSec(false) / 1000.0f;
+	metrics_.averageStep_ = metrics_.steps_ ? totalStep / 1000.0f / metrics_.steps_ : 0.0f;
+	metrics_.maxStep_ = maxStep / 1000.0f;
+}
+
+void HeadlessScenario::Shoot()
+{
+	const ea::vector<SharedPtr<Node> >& zombies = zombiesNode_->GetChildren();
+
+	// Only zombies still carrying the trigger can be turned into ragdolls
+	ea::vector<Node*> targets;
+	for (Node* zombie : zombies)
+	{
+		if (zombie->HasComponent<CreateRagdoll>())
+			targets.push_back(zombie);
+	}
+	if (targets.empty())
+		return;
+
+	Node* target = targets[Rand() % targets.size()];
+	const Vector3 aimPoint = target->GetWorldPosition() + Vector3(0.0f, 1.0f, 0.0f);
+
+	Quaternion rotation(Vector3::FORWARD, aimPoint - gunPosition_);
+	rotation = Quaternion(Random(-1.0f, 1.0f) * parameters_.aimSpread_, Random(-1.0f, 1.0f) * parameters_.aimSpread_,
+		0.0f) * rotation;
+
+	Fire(rotation);
+}
+
+void HeadlessScenario::Fire(const Quaternion& rotation)
+{
+	Ragdolls::SpawnProjectile(scene_, gunPosition_, rotation);
+	++metrics_.shotsFired_;
+}
+
+void HeadlessScenario::HandleRagdollActivated(StringHash eventType, VariantMap& eventData)
+{
+	using namespace RagdollActivated;
+
+	auto* node = static_cast<Node*>(eventData[P_NODE].GetPtr());
+	if (node && node->GetScene() == scene_)
+		++metrics_.ragdollsActivated_;
+}
+
+void HeadlessScenario::HandleZombieArrived(StringHash eventType, VariantMap& eventData)
+{
+	using namespace ZombieArrived;
+
+	auto* node = static_cast<Node*>(eventData[P_NODE].GetPtr());
+	if (node && node->GetScene() == scene_)
+		++metrics_.zombiesArrived_;
+}
@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "ShooterBot.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Input parameters of a single headless run.
+	struct ScenarioParameters
+	{
+		/// Random seed for zombie placement and shot aiming.
+		unsigned seed_ = 1;
+		/// Number of walking zombies.
+		int numZombies_ = 11;
+		/// Simulated length of the run in seconds.
+		float duration_ = 30.0f;
+		/// Seconds between two scripted shots.
+		float shotInterval_ = 0.5f;
+		/// Maximum aim deviation in degrees.
+		float aimSpread_ = 2.0f;
+		/// Fixed simulation step.
+		float timeStep_ = 1.0f / 60.0f;
+		/// Physics world update rate.
+		int physicsFps_ = 60;
+		/// Fire with the shooter bot instead of the scripted shots.
+		bool bot_ = false;
+		/// Shooter bot behaviour.
+		ShooterBotProfile botProfile_;
+	};
+
+	/// Metrics collected from a single headless run.
+	struct ScenarioMetrics
+	{
+		/// Simulated steps.
+		unsigned steps_ = 0;
+		/// Scripted shots fired.
+		unsigned shotsFired_ = 0;
+		/// Zombies turned into ragdolls.
+		unsigned ragdollsActivated_ = 0;
+		/// Zombies that walked out of the arena.
+		unsigned zombiesArrived_ = 0;
+		/// Rigid bodies alive at the end of the run.
+		unsigned rigidBodies_ = 0;
+		/// Wall clock time of the whole run in milliseconds.
+		float wallTime_ = 0.0f;
+		/// Average scene step in milliseconds.
+		float averageStep_ = 0.0f;
+		/// Slowest scene step in milliseconds.
+		float maxStep_ = 0.0f;
+
+		/// Return CSV header matching ToCSV.
+		static ea::string GetCSVHeader();
+		/// Return metrics as a CSV fragment.
+		ea::string ToCSV() const;
+	};
+
+	/// Ragdolls scene without window, viewport or sample state, stepped with a fixed time step
+	/// and fired at by a scripted gun or the shooter bot.
+	class HeadlessScenario : public Object
+	{
+		URHO3D_OBJECT(HeadlessScenario, Object);
+
+	public:
+		/// Construct.
+		explicit HeadlessScenario(Context* context);
+
+		/// Build the scene from parameters.
+		void Create(const ScenarioParameters& parameters);
+		/// Step the scene until the simulated duration is over.
+		void Run();
+
+		/// Return the scene.
+		Scene* GetScene() const { return scene_; }
+		/// Return collected metrics.
+		const ScenarioMetrics& GetMetrics() const { return metrics_; }
+
+	private:
+		/// Fire at a random living zombie.
+		void Shoot();
+		/// Spawn a projectile from the gun position.
+		void Fire(const Quaternion& rotation);
+		/// Handle a zombie turning into a ragdoll.
+		void HandleRagdollActivated(StringHash eventType, VariantMap& eventData);
+		/// Handle a zombie leaving the arena.
+		void HandleZombieArrived(StringHash eventType, VariantMap& eventData);
+
+		/// Scene.
+		SharedPtr<Scene> scene_;
+		/// Parent node of all zombies.
+		Node* zombiesNode_ = 0;
+		/// Node at the gun position, seeked by the crowd.
+		Node* gunNode_ = 0;
+		/// Shooter bot on the gun node, null for the scripted shots.
+		ShooterBot* bot_ = 0;
+		/// Scripted gun position.
+		Vector3 gunPosition_{ 0.0f, 2.0f, -20.0f };
+		/// Run parameters.
+		ScenarioParameters parameters_;
+		/// Collected metrics.
+		ScenarioMetrics metrics_;
+	};
+}
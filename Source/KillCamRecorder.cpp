@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "KillCamRecorder.h"
+#include "Ragdolls.h"
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Most bodies of one ragdoll, which the gather adds before dropping a ragdoll that does not fit.
+const unsigned MAX_RAGDOLL_BODIES = 64;
+
+}
+
+KillCamRecorder::KillCamRecorder(Context* context) :
+	Component(context)
+{
+	// Ragdolls fly out of the walking area, give them room above and around it
+	box_ = Ragdolls::GetArenaBounds();
+	box_.Merge(BoundingBox(box_.min_ - Vector3(10.0f, 1.0f, 10.0f), box_.max_ + Vector3(10.0f, 20.0f, 10.0f)));
+
+	SetCapacity(5.0f, 60, 512);
+}
+
+void KillCamRecorder::SetCapacity(float duration, unsigned stepsPerSecond, unsigned maxEntities)
+{
+	StopPlayback();
+
+	const unsigned numFrames = Max(CeilToInt(duration * stepsPerSecond), 2);
+	maxEntities_ = Max(maxEntities, 1u);
+
+	transforms_.clear();
+	transforms_.shrink_to_fit();
+	transforms_.resize(numFrames * maxEntities_);
+	frames_.clear();
+	frames_.shrink_to_fit();
+	frames_.resize(numFrames);
+
+	nodes_.reserve(maxEntities_ + MAX_RAGDOLL_BODIES);
+	bodies_.reserve(MAX_RAGDOLL_BODIES);
+
+	first_ = 0;
+	count_ = 0;
+}
+
+float KillCamRecorder::GetRecordedDuration() const
+{
+	if (count_ < 2)
+		return 0.0f;
+	return frames_[GetFrameIndex(count_ - 1)].time_ - frames_[first_].time_;
+}
+
+void KillCamRecorder::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_PHYSICSPOSTSTEP, URHO3D_HANDLER(KillCamRecorder, HandlePhysicsPostStep));
+	else
+	{
+		StopPlayback();
+		UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
+	}
+}
+
+void KillCamRecorder::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PhysicsPostStep;
+
+	if (playing_)
+		return;
+
+	time_ += eventData[P_TIMESTEP].GetFloat();
+	RecordFrame();
+}
+
+void KillCamRecorder::RecordFrame()
+{
+	// Reuse the oldest frame once the ring is full
+	unsigned frameIndex;
+	if (count_ < frames_.size())
+		frameIndex = GetFrameIndex(count_++);
+	else
+	{
+		frameIndex = first_;
+		first_ = (first_ + 1) % frames_.size();
+	}
+
+	GatherReplicatedNodes(GetScene(), nodes_, bodies_, maxEntities_);
+
+	RecordedFrame& frame = frames_[frameIndex];
+	RecordedTransform* transforms = GetTransforms(frameIndex);
+	frame.time_ = time_;
+	frame.count_ = nodes_.size();
+
+	for (unsigned i = 0; i < frame.count_; ++i)
+	{
+		const ReplicatedNode& node = nodes_[i];
+		RecordedTransform& transform = transforms[i];
+		transform.id_ = node.node_->GetID();
+		QuantizePosition(node.GetWorldPosition(), box_, transform.position_);
+		transform.rotation_ = QuantizeRotation(node.GetWorldRotation());
+	}
+
+	// Sorted frames let playback pair up the entities of two frames in one pass
+	ea::sort(transforms, transforms + frame.count_,
+		[](const RecordedTransform& lhs, const RecordedTransform& rhs) { return lhs.id_ < rhs.id_; });
+}
+
+bool KillCamRecorder::StartPlayback(float duration)
+{
+	if (playing_ || count_ < 2 || !GetScene())
+		return false;
+
+	playing_ = true;
+	playbackTime_ = frames_[GetFrameIndex(count_ - 1)].time_ - Min(duration, GetRecordedDuration());
+
+	GetScene()->SetUpdateEnabled(false);
+	SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(KillCamRecorder, HandleUpdate));
+
+	Pose(playbackTime_);
+	return true;
+}
+
+void KillCamRecorder::StopPlayback()
+{
+	if (!playing_)
+		return;
+
+	playing_ = false;
+	UnsubscribeFromEvent(E_UPDATE);
+
+	if (Scene* scene = GetScene())
+	{
+		Pose(frames_[GetFrameIndex(count_ - 1)].time_);
+		scene->SetUpdateEnabled(true);
+	}
+}
+
+void KillCamRecorder::HandleUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace Update;
+
+	playbackTime_ += eventData[P_TIMESTEP].GetFloat();
+	if (playbackTime_ >= frames_[GetFrameIndex(count_ - 1)].time_)
+		StopPlayback();
+	else
+		Pose(playbackTime_);
+}
+
+void KillCamRecorder::Pose(float time)
+{
+	// Find the pair of frames around the time
+	unsigned n = 0;
+	while (n + 2 < count_ && frames_[GetFrameIndex(n + 1)].time_ <= time)
+		++n;
+
+	const unsigned index0 = GetFrameIndex(n);
+	const unsigned index1 = GetFrameIndex(n + 1);
+	const RecordedFrame& frame0 = frames_[index0];
+	const RecordedFrame& frame1 = frames_[index1];
+	const RecordedTransform* transforms0 = GetTransforms(index0);
+	const RecordedTransform* transforms1 = GetTransforms(index1);
+
+	const float span = frame1.time_ - frame0.time_;
+	const float t = span > 0.0f ? Clamp((time - frame0.time_) / span, 0.0f, 1.0f) : 0.0f;
+
+	Scene* scene = GetScene();
+	unsigned j = 0;
+	for (unsigned i = 0; i < frame0.count_; ++i)
+	{
+		const RecordedTransform& transform0 = transforms0[i];
+		Node* node = scene->GetNode(transform0.id_);
+		// Corpses may have been removed since they were recorded
+		if (!node)
+			continue;
+
+		Vector3 position = DequantizePosition(transform0.position_, box_);
+		Quaternion rotation = DequantizeRotation(transform0.rotation_);
+
+		while (j < frame1.count_ && transforms1[j].id_ < transform0.id_)
+			++j;
+		if (j < frame1.count_ && transforms1[j].id_ == transform0.id_)
+		{
+			position = position.Lerp(DequantizePosition(transforms1[j].position_, box_), t);
+			rotation = rotation.Slerp(DequantizeRotation(transforms1[j].rotation_), t);
+		}
+
+		node->SetWorldPosition(position);
+		node->SetWorldRotation(rotation);
+	}
+}
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+#include "ReplicationProtocol.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Records quantized transforms of zombie roots, ragdoll bones and projectiles into a fixed size ring buffer
+	/// every physics step, and plays them back by posing the nodes with interpolation between steps. Positions are
+	/// stored relative to the arena bounds with 16 bits per axis, rotations as smallest-three quaternions in
+	/// 32 bits, 16 bytes per entity. Past the entity cap of a step, zombie roots are left out first, then whole
+	/// ragdolls, then projectiles. All memory is allocated by SetCapacity.
+	class KillCamRecorder : public Component
+	{
+		URHO3D_OBJECT(KillCamRecorder, Component);
+
+	public:
+		/// Construct.
+		explicit KillCamRecorder(Context* context);
+
+		/// Allocate the ring buffer for the recorded duration at the physics step rate, with a fixed entity cap
+		/// per step. Clears the recording.
+		void SetCapacity(float duration, unsigned stepsPerSecond, unsigned maxEntities);
+		/// Start replaying the last seconds of the recording. Scene updates are paused until playback ends.
+		bool StartPlayback(float duration);
+		/// Stop replaying and pose the nodes at the newest recorded step.
+		void StopPlayback();
+
+		/// Return whether replaying.
+		bool IsPlaying() const { return playing_; }
+		/// Return recorded duration available for playback.
+		float GetRecordedDuration() const;
+		/// Return ring buffer size in bytes.
+		unsigned GetMemoryUse() const { return transforms_.capacity() * sizeof(RecordedTransform) + frames_.capacity() * sizeof(RecordedFrame); }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Quantized transform of an entity.
+		struct RecordedTransform
+		{
+			/// Scene node ID.
+			unsigned id_;
+			/// Position relative to the recording box.
+			unsigned short position_[3];
+			/// Smallest-three rotation.
+			unsigned rotation_;
+		};
+
+		/// Recorded physics step.
+		struct RecordedFrame
+		{
+			/// Recording time.
+			float time_;
+			/// Number of recorded transforms, sorted by ID.
+			unsigned count_;
+		};
+
+		/// Handle physics post-step.
+		void HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData);
+		/// Handle application update during playback.
+		void HandleUpdate(StringHash eventType, VariantMap& eventData);
+		/// Record the current transforms as the newest frame.
+		void RecordFrame();
+		/// Pose the nodes at a recording time.
+		void Pose(float time);
+		/// Return transforms of a ring buffer frame.
+		RecordedTransform* GetTransforms(unsigned frame) { return &transforms_[frame * maxEntities_]; }
+		/// Return ring buffer index of the n-th oldest frame.
+		unsigned GetFrameIndex(unsigned n) const { return (first_ + n) % frames_.size(); }
+
+		/// Transform storage, maxEntities_ slots per frame.
+		ea::vector<RecordedTransform> transforms_;
+		/// Frame ring buffer.
+		ea::vector<RecordedFrame> frames_;
+		/// Scratch lists for gathering entities, reserved by SetCapacity.
+		ea::vector<ReplicatedNode> nodes_;
+		ea::vector<RigidBody*> bodies_;
+		/// Quantization region: the arena with room for flying ragdolls.
+		BoundingBox box_;
+		/// Entity cap per frame.
+		unsigned maxEntities_ = 0;
+		/// Ring buffer index of the oldest frame.
+		unsigned first_ = 0;
+		/// Number of recorded frames.
+		unsigned count_ = 0;
+		/// Recording clock.
+		float time_ = 0.0f;
+		/// Whether replaying.
+		bool playing_ = false;
+		/// Current playback time.
+		float playbackTime_ = 0.0f;
+	};
+}
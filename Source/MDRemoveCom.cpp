@@ -3,18 +3,60 @@
 #include <Urho3D/Scene/Serializable.h>
 
 #include "MDRemoveCom.h"
+#include "GameplayTasks.h"
+#include "ParallelLogic.h"
 
 using namespace MonsterDolls;
 
-void MDRemoveCom::Update(float timeStep)
+namespace
 {
-	if (mdCount_++ > mdCountNum_)
-		GetNode()->Remove();
+
+/// Ticks per second when logic runs once per frame.
+const unsigned DEFAULT_TICK_RATE = 60;
+
+GameplayTask RemoveAfter(GameplayScheduler* scheduler, WeakPtr<Node> node, float seconds)
+{
+	co_await scheduler->Delay(seconds);
+	if (node)
+		node->Remove();
+}
+
+}
+
+void MDRemoveCom::ScheduleRemoval(int ticks)
+{
+	removalTicks_ = ticks;
+	started_ = false;
+	StartRemoval();
+}
+
+void MDRemoveCom::ApplyAttributes()
+{
+	StartRemoval();
+}
+
+void MDRemoveCom::OnSceneSet(Scene* scene)
+{
+	started_ = false;
+	if (scene)
+		StartRemoval();
+}
+
+void MDRemoveCom::StartRemoval()
+{
+	Scene* scene = GetScene();
+	if (!scene || started_ || removalTicks_ <= 0)
+		return;
+
+	auto* phase = scene->GetComponent<ParallelLogicPhase>();
+	const unsigned tickRate = phase && phase->GetTickRate() ? phase->GetTickRate() : DEFAULT_TICK_RATE;
+	auto* scheduler = GameplayScheduler::Get(scene);
+	scheduler->Start(RemoveAfter(scheduler, WeakPtr<Node>(node_), (float)removalTicks_ / tickRate));
+	started_ = true;
 }
 
 void MDRemoveCom::RegisterObject(Context* context)
 {
 	context->AddFactoryReflection<MDRemoveCom>();
-	//URHO3D_ATTRIBUTE("MD Count", int, mdCount_, 0, AM_DEFAULT);
-	//URHO3D_ATTRIBUTE("MD Count Num", int, mdCountNum_, 100, AM_DEFAULT);
+	URHO3D_ATTRIBUTE("Removal Ticks", int, removalTicks_, 0, AM_DEFAULT);
 }
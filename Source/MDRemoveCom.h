@@ -1,28 +1,46 @@
 #include <Urho3D/Math/StringHash.h>
 #include <Urho3D/Core/Object.h>
+#include <Urho3D/Scene/Component.h>
 #include <Urho3D/Scene/Node.h>
 #include <Urho3D/Scene/Scene.h>
-#include <Urho3D/Scene/LogicComponent.h>
 
 using namespace Urho3D;
 
 namespace MonsterDolls {
-	class MDRemoveCom : public LogicComponent
+	/// Marks a ragdoll or arrived zombie whose node is removed after a while. The wait is a gameplay script
+	/// suspended on a delay, nothing updates per frame meanwhile. The delay is an attribute, so components of a
+	/// loaded scene schedule their removal again once they are in the scene.
+	class MDRemoveCom : public Component
 	{
-		URHO3D_OBJECT(MDRemoveCom, LogicComponent);
+		URHO3D_OBJECT(MDRemoveCom, Component);
 	public:
 		MDRemoveCom(Context* context)
-			: LogicComponent(context)
+			: Component(context)
 		{
-			SetUpdateEventMask(USE_UPDATE);
 		}
-		void Update(float timeStep) override;
 		/// Register object factory and attributes.
 		static void RegisterObject(Context* context);
 
-		void SetCountNum(int i) { mdCountNum_ = i; }
+		/// Apply attribute changes after loading, scheduling the removal.
+		void ApplyAttributes() override;
+
+		/// Remove the node after the given logic ticks, timed at the logic rate of the scene. Starts once the
+		/// component is in a scene.
+		void ScheduleRemoval(int ticks);
+		/// Return logic ticks before removal.
+		int GetRemovalTicks() const { return removalTicks_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
 	private:
-		int mdCount_ = 0;
-		int mdCountNum_ = 100;
+		/// Start the removal script if it is due and not running.
+		void StartRemoval();
+
+		/// Logic ticks before removal, 0 for none.
+		int removalTicks_ = 0;
+		/// Removal script started in the current scene.
+		bool started_ = false;
 	};
 }
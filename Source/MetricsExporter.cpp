@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Audio/SoundSource.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "MetricsExporter.h"
+#include "ChunkedTerrain.h"
+#include "CreateRagdoll.h"
+#include "MDRemoveCom.h"
+#include "ParallelIslandSolver.h"
+#include "ProjectileSweep.h"
+#include "ShooterBot.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+MetricsExporter::MetricsExporter(Context* context) :
+	Object(context),
+	registry_(MakeShared<MetricsRegistry>(context))
+{
+	frames_ = registry_->AddCounter("zombiedolls_frames_total", "Rendered frames.");
+	physicsSteps_ = registry_->AddCounter("zombiedolls_physics_steps_total", "Physics world steps.");
+	ragdollsActivated_ = registry_->AddCounter("zombiedolls_ragdolls_activated_total", "Zombies turned into ragdolls.");
+	frameTime_ = registry_->AddGauge("zombiedolls_frame_time_seconds", "Length of the last frame.");
+	activeRigidBodies_ = registry_->AddGauge("zombiedolls_active_rigid_bodies", "Rigid bodies not sleeping.");
+	activeRagdolls_ = registry_->AddGauge("zombiedolls_active_ragdolls", "Activated ragdolls waiting for removal.");
+	liveZombies_ = registry_->AddGauge("zombiedolls_live_zombies", "Zombies still walking.");
+	liveProjectiles_ = registry_->AddGauge("zombiedolls_live_projectiles", "Projectiles in the scene.");
+	soundSources_ = registry_->AddGauge("zombiedolls_live_sound_sources", "Sound sources playing.");
+	resourceMemory_ = registry_->AddGauge("zombiedolls_resource_cache_bytes", "Memory used by cached resources.");
+	for (unsigned i = 0; i < MAX_RESOURCE_CATEGORIES; ++i)
+	{
+		const char* category = ResourceBudgets::GetCategoryName((ResourceCategory)i);
+		categoryMemory_[i] = registry_->AddGauge(Format("zombiedolls_resource_{}_bytes", category),
+			Format("Memory used by cached {}.", category));
+	}
+	botFireRate_ = registry_->AddGauge("zombiedolls_bot_fire_rate", "Shots per second scheduled by the shooter bot.");
+	botShots_ = registry_->AddCounter("zombiedolls_bot_shots_total", "Shots taken by the shooter bot.");
+	resourcesEvicted_ = registry_->AddCounter("zombiedolls_resources_evicted_total",
+		"Resources evicted over their budget.");
+	terrainCollisionChunks_ = registry_->AddGauge("zombiedolls_terrain_collision_chunks",
+		"Terrain chunks with collision shapes.");
+	frameTimes_ = registry_->AddHistogram("zombiedolls_frame_seconds", "Frame time.",
+		{ 0.008, 0.0167, 0.025, 0.0333, 0.05, 0.1, 0.25 });
+	physicsStepTimes_ = registry_->AddHistogram("zombiedolls_physics_step_seconds", "Wall time of a physics step.",
+		{ 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.032 });
+	islandSolveTimes_ = registry_->AddHistogram("zombiedolls_island_solve_seconds",
+		"Solver time of a physics island with the parallel island solver.", { 0.00005, 0.0001, 0.0002, 0.0005, 0.001, 0.002 });
+
+	SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(MetricsExporter, HandleUpdate));
+	// Without a sender the steps of every physics world arrive here
+	SubscribeToEvent(E_PHYSICSPRESTEP, URHO3D_HANDLER(MetricsExporter, HandlePhysicsPreStep));
+	SubscribeToEvent(E_PHYSICSPOSTSTEP, URHO3D_HANDLER(MetricsExporter, HandlePhysicsPostStep));
+	SubscribeToEvent(E_RAGDOLLACTIVATED, URHO3D_HANDLER(MetricsExporter, HandleRagdollActivated));
+}
+
+void MetricsExporter::SetOutput(const ea::string& fileName, float interval)
+{
+	fileName_ = fileName;
+	interval_ = Max(interval, 0.1f);
+	writeTimer_ = interval_;
+}
+
+void MetricsExporter::HandleUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace Update;
+
+	const float timeStep = eventData[P_TIMESTEP].GetFloat();
+	frames_->Increment();
+	frameTime_->Set(timeStep);
+	frameTimes_->Observe(timeStep);
+
+	writeTimer_ -= timeStep;
+	if (writeTimer_ > 0.0f || fileName_.empty())
+		return;
+
+	writeTimer_ = interval_;
+	SampleGauges();
+	registry_->WriteToFile(fileName_);
+}
+
+void MetricsExporter::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
+{
+	stepTimer_.Reset();
+}
+
+void MetricsExporter::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PhysicsPostStep;
+
+	physicsSteps_->Increment();
+	physicsStepTimes_->Observe(stepTimer_.GetUSec(false) / 1000000.0);
+
+	auto* physicsWorld = static_cast<PhysicsWorld*>(eventData[P_WORLD].GetPtr());
+	scene_ = physicsWorld->GetScene();
+
+	if (auto* islandSolver = scene_->GetComponent<ParallelIslandSolver>())
+	{
+		for (const IslandSolveTime& island : islandSolver->GetIslandTimes())
+			islandSolveTimes_->Observe(island.time_ / 1000000.0);
+	}
+}
+
+void MetricsExporter::HandleRagdollActivated(StringHash eventType, VariantMap& eventData)
+{
+	ragdollsActivated_->Increment();
+}
+
+void MetricsExporter::SampleGauges()
+{
+	resourceMemory_->Set((double)GetSubsystem<ResourceCache>()->GetTotalMemoryUse());
+	if (auto* budgets = GetSubsystem<ResourceBudgets>())
+	{
+		for (unsigned i = 0; i < MAX_RESOURCE_CATEGORIES; ++i)
+			categoryMemory_[i]->Set((double)budgets->GetMemoryUse((ResourceCategory)i));
+		resourcesEvicted_->Set(budgets->GetNumEvicted());
+	}
+
+	if (!scene_)
+		return;
+
+	if (auto* terrain = scene_->GetComponent<ChunkedTerrain>(true))
+		terrainCollisionChunks_->Set(terrain->GetNumCollisionChunks());
+
+	if (auto* bot = scene_->GetComponent<ShooterBot>(true))
+	{
+		botFireRate_->Set(bot->GetFireRate());
+		botShots_->Set(bot->GetNumShots());
+	}
+
+	ea::vector<RigidBody*> bodies;
+	scene_->GetComponents<RigidBody>(bodies, true);
+	unsigned activeBodies = 0;
+	for (RigidBody* body : bodies)
+		activeBodies += body->IsActive();
+	activeRigidBodies_->Set(activeBodies);
+
+	ea::vector<SoundSource*> sources;
+	scene_->GetComponents<SoundSource>(sources, true);
+	unsigned playing = 0;
+	for (SoundSource* source : sources)
+		playing += source->IsPlaying();
+	soundSources_->Set(playing);
+
+	// Zombies carry CreateRagdoll until hit, then MDRemoveCom until removed. Zombies that arrived wait for removal
+	// too, but keep their CreateRagdoll
+	ea::vector<Node*> nodes;
+	scene_->GetChildrenWithComponent<CreateRagdoll>(nodes, true);
+	liveZombies_->Set(nodes.size());
+	scene_->GetChildrenWithComponent<MDRemoveCom>(nodes, true);
+	unsigned ragdolls = 0;
+	for (Node* node : nodes)
+		ragdolls += !node->HasComponent<CreateRagdoll>();
+	activeRagdolls_->Set(ragdolls);
+	scene_->GetChildrenWithComponent<ProjectileSweep>(nodes, true);
+	liveProjectiles_->Set(nodes.size());
+}
+
+void MetricsExporter::WriteSummary()
+{
+	SampleGauges();
+	if (!fileName_.empty())
+		registry_->WriteToFile(fileName_);
+
+	const double averageFrame = frameTimes_->count_ ? frameTimes_->sum_ / frameTimes_->count_ : 0.0;
+	const double averageStep = physicsStepTimes_->count_ ? physicsStepTimes_->sum_ / physicsStepTimes_->count_ : 0.0;
+	URHO3D_LOGINFO("Metrics: {} frames, average frame {:.2f} ms, {} physics steps, average step {:.3f} ms, "
+		"{} ragdolls, resource cache {} KB", frameTimes_->count_, averageFrame * 1000.0, physicsSteps_->value_,
+		averageStep * 1000.0, ragdollsActivated_->value_, (unsigned long long)resourceMemory_->value_ / 1024);
+}
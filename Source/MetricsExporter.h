@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "MetricsRegistry.h"
+#include "ResourceBudgets.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Collects the game's performance metrics and writes them to a Prometheus text file every few seconds. Frame
+	/// and physics step times are observed as they happen, the scene gauges are sampled only when writing.
+	class MetricsExporter : public Object
+	{
+		URHO3D_OBJECT(MetricsExporter, Object);
+
+	public:
+		/// Construct and start collecting.
+		explicit MetricsExporter(Context* context);
+
+		/// Set output file and seconds between writes.
+		void SetOutput(const ea::string& fileName, float interval);
+		/// Sample, write the file a last time and log a summary.
+		void WriteSummary();
+
+		/// Return the registry.
+		MetricsRegistry* GetRegistry() const { return registry_; }
+
+	private:
+		/// Handle the frame update.
+		void HandleUpdate(StringHash eventType, VariantMap& eventData);
+		/// Handle a physics pre-step of any world.
+		void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
+		/// Handle a physics post-step of any world.
+		void HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData);
+		/// Handle a zombie turning into a ragdoll.
+		void HandleRagdollActivated(StringHash eventType, VariantMap& eventData);
+		/// Update the gauges from the scene and the resource cache.
+		void SampleGauges();
+
+		/// Metrics.
+		SharedPtr<MetricsRegistry> registry_;
+		/// Scene of the last physics step.
+		WeakPtr<Scene> scene_;
+		/// Output file name.
+		ea::string fileName_;
+		/// Seconds between writes.
+		float interval_ = 5.0f;
+		/// Seconds until the next write.
+		float writeTimer_ = 0.0f;
+		/// Physics step timer.
+		HiresTimer stepTimer_;
+
+		MetricCounter* frames_ = nullptr;
+		MetricCounter* physicsSteps_ = nullptr;
+		MetricCounter* ragdollsActivated_ = nullptr;
+		MetricGauge* frameTime_ = nullptr;
+		MetricGauge* activeRigidBodies_ = nullptr;
+		MetricGauge* activeRagdolls_ = nullptr;
+		MetricGauge* liveZombies_ = nullptr;
+		MetricGauge* liveProjectiles_ = nullptr;
+		MetricGauge* soundSources_ = nullptr;
+		MetricGauge* resourceMemory_ = nullptr;
+		MetricGauge* categoryMemory_[MAX_RESOURCE_CATEGORIES]{};
+		MetricCounter* resourcesEvicted_ = nullptr;
+		MetricGauge* botFireRate_ = nullptr;
+		MetricCounter* botShots_ = nullptr;
+		MetricGauge* terrainCollisionChunks_ = nullptr;
+		MetricHistogram* frameTimes_ = nullptr;
+		MetricHistogram* physicsStepTimes_ = nullptr;
+		MetricHistogram* islandSolveTimes_ = nullptr;
+	};
+}
@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#include "MetricsRegistry.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+void MetricHistogram::Observe(double value)
+{
+	unsigned bucket = 0;
+	while (bucket < bounds_.size() && value > bounds_[bucket])
+		++bucket;
+
+	++counts_[bucket];
+	sum_ += value;
+	++count_;
+}
+
+MetricsRegistry::MetricsRegistry(Context* context) :
+	Object(context)
+{
+}
+
+MetricCounter* MetricsRegistry::AddCounter(const ea::string& name, const ea::string& help)
+{
+	counters_.push_back(ea::make_unique<MetricCounter>());
+	counters_.back()->name_ = name;
+	counters_.back()->help_ = help;
+	return counters_.back().get();
+}
+
+MetricGauge* MetricsRegistry::AddGauge(const ea::string& name, const ea::string& help)
+{
+	gauges_.push_back(ea::make_unique<MetricGauge>());
+	gauges_.back()->name_ = name;
+	gauges_.back()->help_ = help;
+	return gauges_.back().get();
+}
+
+MetricHistogram* MetricsRegistry::AddHistogram(const ea::string& name, const ea::string& help,
+	const ea::vector<double>& bounds)
+{
+	histograms_.push_back(ea::make_unique<MetricHistogram>());
+	MetricHistogram* histogram = histograms_.back().get();
+	histogram->name_ = name;
+	histogram->help_ = help;
+	histogram->bounds_ = bounds;
+	histogram->counts_.resize(bounds.size() + 1, 0);
+	return histogram;
+}
+
+ea::string MetricsRegistry::ToPrometheusText() const
+{
+	ea::string text;
+
+	for (const auto& counter : counters_)
+	{
+		text += Format("# HELP {} {}\n# TYPE {} counter\n", counter->name_, counter->help_, counter->name_);
+		text += Format("{} {}\n", counter->name_, counter->value_);
+	}
+
+	for (const auto& gauge : gauges_)
+	{
+		text += Format("# HELP {} {}\n# TYPE {} gauge\n", gauge->name_, gauge->help_, gauge->name_);
+		text += Format("{} {}\n", gauge->name_, gauge->value_);
+	}
+
+	for (const auto& histogram : histograms_)
+	{
+		text += Format("# HELP {} {}\n# TYPE {} histogram\n", histogram->name_, histogram->help_, histogram->name_);
+
+		// Exposed buckets are cumulative
+		unsigned long long cumulative = 0;
+		for (unsigned i = 0; i < histogram->bounds_.size(); ++i)
+		{
+			cumulative += histogram->counts_[i];
+			text += Format("{}_bucket{{le=\"{}\"}} {}\n", histogram->name_, histogram->bounds_[i], cumulative);
+		}
+		text += Format("{}_bucket{{le=\"+Inf\"}} {}\n", histogram->name_, histogram->count_);
+		text += Format("{}_sum {}\n{}_count {}\n", histogram->name_, histogram->sum_, histogram->name_,
+			histogram->count_);
+	}
+
+	return text;
+}
+
+bool MetricsRegistry::WriteToFile(const ea::string& fileName) const
+{
+	// Write aside and swap in, a scraper must not see a half written file
+	const ea::string tempFileName = fileName + ".tmp";
+	{
+		File file(context_);
+		if (!file.Open(tempFileName, FILE_WRITE))
+		{
+			URHO3D_LOGERROR("Could not open metrics file {}", tempFileName);
+			return false;
+		}
+		const ea::string text = ToPrometheusText();
+		file.Write(text.data(), text.length());
+	}
+
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	if (fileSystem->FileExists(fileName))
+		fileSystem->Delete(fileName);
+	return fileSystem->Rename(tempFileName, fileName);
+}
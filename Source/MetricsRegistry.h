@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+#include <EASTL/unique_ptr.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Monotonically increasing metric.
+	struct MetricCounter
+	{
+		/// Metric name, conventionally ending in _total.
+		ea::string name_;
+		/// Help text.
+		ea::string help_;
+		/// Current value.
+		double value_ = 0.0;
+
+		/// Add to the value.
+		void Increment(double amount = 1.0) { value_ += amount; }
+		/// Set the value from a count kept elsewhere.
+		void Set(double value) { value_ = value; }
+	};
+
+	/// Metric that may go up and down.
+	struct MetricGauge
+	{
+		/// Metric name.
+		ea::string name_;
+		/// Help text.
+		ea::string help_;
+		/// Current value.
+		double value_ = 0.0;
+
+		/// Set the value.
+		void Set(double value) { value_ = value; }
+	};
+
+	/// Distribution of observed values over fixed buckets.
+	struct MetricHistogram
+	{
+		/// Metric name.
+		ea::string name_;
+		/// Help text.
+		ea::string help_;
+		/// Ascending upper bounds of the buckets, the implicit last bucket is unbounded.
+		ea::vector<double> bounds_;
+		/// Observations per bucket, not cumulative, one more than bounds.
+		ea::vector<unsigned long long> counts_;
+		/// Sum of the observations.
+		double sum_ = 0.0;
+		/// Number of observations.
+		unsigned long long count_ = 0;
+
+		/// Record a value.
+		void Observe(double value);
+	};
+
+	/// Counters, gauges and histograms written in the Prometheus text exposition format.
+	class MetricsRegistry : public Object
+	{
+		URHO3D_OBJECT(MetricsRegistry, Object);
+
+	public:
+		/// Construct.
+		explicit MetricsRegistry(Context* context);
+
+		/// Add a counter. The pointer stays valid for the life of the registry.
+		MetricCounter* AddCounter(const ea::string& name, const ea::string& help);
+		/// Add a gauge. The pointer stays valid for the life of the registry.
+		MetricGauge* AddGauge(const ea::string& name, const ea::string& help);
+		/// Add a histogram with ascending bucket bounds. The pointer stays valid for the life of the registry.
+		MetricHistogram* AddHistogram(const ea::string& name, const ea::string& help, const ea::vector<double>& bounds);
+
+		/// Return all metrics in the Prometheus text format.
+		ea::string ToPrometheusText() const;
+		/// Write all metrics to a file. The file is replaced as a whole, so a scraper never reads a partial file.
+		bool WriteToFile(const ea::string& fileName) const;
+
+	private:
+		/// Counters.
+		ea::vector<ea::unique_ptr<MetricCounter> > counters_;
+		/// Gauges.
+		ea::vector<ea::unique_ptr<MetricGauge> > gauges_;
+		/// Histograms.
+		ea::vector<ea::unique_ptr<MetricHistogram> > histograms_;
+	};
+}
@@ -23,7 +23,8 @@
 #include <Urho3D/Graphics/GraphicsEvents.h>
 
 #include "Mover.h"
-#include "Ragdolls.h"
+#include "ChunkedTerrain.h"
+#include "CrowdSteering.h"
 #include "CreateRagdoll.h"
 #include "MDRemoveCom.h"
 
@@ -35,34 +36,86 @@
 using namespace MonsterDolls;
 
 Mover3D::Mover3D(Context* context) :
-	LogicComponent(context),
+	ParallelLogicComponent(context),
 	moveSpeed_{ 0.0f, 0.0f, 0.0f }
 {
 	// Only the scene update event is needed: unsubscribe from the rest for optimization
 	SetUpdateEventMask(USE_UPDATE);
 }
 
-void Mover3D::SetParameters(const Vector3& moveSpeed, const BoundingBox& bounds, Ragdolls* ragdolls)
+void Mover3D::SetParameters(const Vector3& moveSpeed, const BoundingBox& bounds)
 {
 	moveSpeed_ = moveSpeed;
 	bounds_ = bounds;
-	ragdolls_ = ragdolls;
 }
 
-void Mover3D::Update(float timeStep)
+void Mover3D::DelayedStart()
+{
+	velocity_ = node_->GetWorldRotation() * moveSpeed_;
+
+	steering_ = GetScene()->GetComponent<CrowdSteering>();
+	if (steering_)
+		steering_->AddAgent(this);
+
+	terrain_ = GetScene()->GetComponent<ChunkedTerrain>(true);
+}
+
+void Mover3D::Stop()
+{
+	if (steering_)
+		steering_->RemoveAgent(this);
+	steering_.Reset();
+}
+
+void Mover3D::ParallelUpdate(float timeStep, LogicCommandBuffer& commands)
 {
 	// If in risk of going outside the plane, rotate the model right
 	Vector3 pos = node_->GetPosition();
+	Quaternion rot = node_->GetRotation();
 	if (pos.z_ > bounds_.min_.z_ && pos.z_ < bounds_.max_.z_)
-		// node_->Yaw(rotationSpeed_ * timeStep);
-		node_->Translate(GetMoveSpeed() * timeStep);
-	else {
-		ragdolls_->PlaySoundEffect("BigExplosion.wav");
-		ragdolls_->CreateKicking();
+	{
+		if (!steering_)
+			// node_->Yaw(rotationSpeed_ * timeStep);
+			pos += rot * (GetMoveSpeed() * timeStep);
+		else
+		{
+			// Steered walkers move along their world velocity and face it
+			Node* parent = node_->GetParent();
+			pos += parent->GetWorldTransform().Inverse() * Vector4(velocity_ * timeStep, 0.0f);
+			if (velocity_.LengthSquared() > M_EPSILON)
+				rot = parent->GetWorldRotation().Inverse() * Quaternion(Vector3::FORWARD, velocity_.Normalized());
+		}
+		if (terrain_)
+		{
+			// Stand on the ground read from the height grid, no physics query per walker
+			const Matrix3x4& parentTransform = node_->GetParent()->GetWorldTransform();
+			Vector3 worldPos = parentTransform * pos;
+			worldPos.y_ = terrain_->GetHeight(worldPos);
+			pos = parentTransform.Inverse() * worldPos;
+		}
+		commands.SetTransform(node_, pos, rot);
+	}
+	else
+	{
+		WeakPtr<Mover3D> self(this);
+		commands.Defer([self]()
+		{
+			if (self)
+				self->Arrive();
+		});
+	}
+}
 
-		auto* mdRemoveCom = node_->CreateComponent<MDRemoveCom>();
-		mdRemoveCom->SetCountNum(200);
+void Mover3D::Arrive()
+{
+	using namespace ZombieArrived;
 
-		node_->RemoveComponent<Mover3D>();
-	}
+	VariantMap& eventData = GetEventDataMap();
+	eventData[P_NODE] = node_;
+	node_->SendEvent(E_ZOMBIEARRIVED, eventData);
+
+	auto* mdRemoveCom = node_->CreateComponent<MDRemoveCom>();
+	mdRemoveCom->ScheduleRemoval(200);
+
+	node_->RemoveComponent<Mover3D>();
 }
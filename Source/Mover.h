@@ -22,27 +22,47 @@
 
 #pragma once
 
-#include <Urho3D/Scene/LogicComponent.h>
+#include "ParallelLogic.h"
 
 using namespace Urho3D;
 
+/// Zombie walked out of its movement boundaries.
+URHO3D_EVENT(E_ZOMBIEARRIVED, ZombieArrived)
+{
+	URHO3D_PARAM(P_NODE, Node);                    // Node pointer
+}
+
 namespace MonsterDolls
 {
-	class Ragdolls;
+	class ChunkedTerrain;
+	class CrowdSteering;
 
 	/// Custom logic component for moving the animated model and rotating at area edges.
-	class Mover3D : public LogicComponent
+	class Mover3D : public ParallelLogicComponent
 	{
-		URHO3D_OBJECT(Mover3D, LogicComponent);
+		URHO3D_OBJECT(Mover3D, ParallelLogicComponent);
 
 	public:
 		/// Construct.
 		explicit Mover3D(Context* context);
 
 		/// Set motion parameters: forward movement speed, and movement boundaries.
-		void SetParameters(const Vector3& moveSpeed, const BoundingBox& bounds, Ragdolls* ragdolls);
-		/// Handle scene update. Called by LogicComponent base class.
-		void Update(float timeStep) override;
+		void SetParameters(const Vector3& moveSpeed, const BoundingBox& bounds);
+		/// Join the crowd steering and follow the terrain of the scene, if any. Called by LogicComponent base class.
+		void DelayedStart() override;
+		/// Leave the crowd steering. Called by LogicComponent base class.
+		void Stop() override;
+		/// Move the walker, or report arrival once out of bounds. Called from the parallel phase.
+		void ParallelUpdate(float timeStep, LogicCommandBuffer& commands) override;
+
+		/// Set world space velocity. Used by crowd steering.
+		void SetVelocity(const Vector3& velocity) { velocity_ = velocity; }
+		/// Return world space velocity.
+		const Vector3& GetVelocity() const { return velocity_; }
+		/// Set whether the walker sees the steering target. Used by crowd steering.
+		void SetTargetVisible(bool visible) { targetVisible_ = visible; }
+		/// Return whether the walker sees the steering target.
+		bool IsTargetVisible() const { return targetVisible_; }
 
 		/// Return forward movement speed.
 		Vector3 GetMoveSpeed() const { return moveSpeed_; }
@@ -51,12 +71,20 @@ namespace MonsterDolls
 		const BoundingBox& GetBounds() const { return bounds_; }
 
 	private:
+		/// Leave the walk and send the arrival event, scripts waiting for it react. Main thread only.
+		void Arrive();
+
 		/// movement speed.
 		Vector3 moveSpeed_;
 		/// Movement boundaries.
 		BoundingBox bounds_;
-
-		Mutex mdMutex_;
-		Ragdolls* ragdolls_ = 0;
+		/// World space velocity.
+		Vector3 velocity_;
+		/// Crowd steering the walker belongs to.
+		WeakPtr<CrowdSteering> steering_;
+		/// Ground the walker stands on.
+		WeakPtr<ChunkedTerrain> terrain_;
+		/// Steering target in sight.
+		bool targetVisible_ = true;
 	};
 }
@@ -0,0 +1,254 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "OcclusionDepthBuffer.h"
+
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Corners of each box face, corner bits select max x, max y and max z.
+const unsigned BOX_FACES[6][4] =
+{
+	{ 0, 2, 6, 4 },
+	{ 1, 5, 7, 3 },
+	{ 0, 4, 5, 1 },
+	{ 2, 3, 7, 6 },
+	{ 0, 1, 3, 2 },
+	{ 4, 6, 7, 5 }
+};
+
+/// Return a box corner.
+Vector3 GetCorner(const BoundingBox& box, unsigned index)
+{
+	return Vector3(index & 1 ? box.max_.x_ : box.min_.x_, index & 2 ? box.max_.y_ : box.min_.y_,
+		index & 4 ? box.max_.z_ : box.min_.z_);
+}
+
+/// Edge function A * x + B * y + C, positive on the inner side of a counter-clockwise edge.
+struct EdgeFunction
+{
+	EdgeFunction(float ax, float ay, float bx, float by) :
+		a_(ay - by),
+		b_(bx - ax),
+		c_(-(a_ * ax + b_ * ay))
+	{
+	}
+
+	float a_;
+	float b_;
+	float c_;
+};
+
+}
+
+void OcclusionDepthBuffer::SetSize(unsigned width, unsigned height)
+{
+	width_ = (width + 3) & ~3u;
+	height_ = height;
+	depth_.resize(width_ * height_);
+	ea::fill(depth_.begin(), depth_.end(), M_INFINITY);
+}
+
+void OcclusionDepthBuffer::Clear(const Matrix4& viewProjection, float nearDistance)
+{
+	viewProjection_ = viewProjection;
+	nearDistance_ = nearDistance;
+	numTriangles_ = 0;
+	ea::fill(depth_.begin(), depth_.end(), M_INFINITY);
+}
+
+void OcclusionDepthBuffer::AddOccluder(const Matrix3x4& transform, const BoundingBox& localBox)
+{
+	ScreenVertex vertices[8];
+	for (unsigned i = 0; i < 8; ++i)
+		vertices[i] = Project(transform * GetCorner(localBox, i));
+
+	for (const auto& face : BOX_FACES)
+	{
+		RasterizeTriangle(vertices[face[0]], vertices[face[1]], vertices[face[2]]);
+		RasterizeTriangle(vertices[face[0]], vertices[face[2]], vertices[face[3]]);
+	}
+}
+
+bool OcclusionDepthBuffer::IsVisible(const BoundingBox& worldBox) const
+{
+	float minX = M_INFINITY;
+	float minY = M_INFINITY;
+	float maxX = -M_INFINITY;
+	float maxY = -M_INFINITY;
+	float minDepth = M_INFINITY;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		const ScreenVertex vertex = Project(GetCorner(worldBox, i));
+		// Reaching behind the near distance, the projected rectangle would not bound the box
+		if (vertex.clipped_)
+			return true;
+
+		minX = Min(minX, vertex.x_);
+		minY = Min(minY, vertex.y_);
+		maxX = Max(maxX, vertex.x_);
+		maxY = Max(maxY, vertex.y_);
+		minDepth = Min(minDepth, vertex.depth_);
+	}
+
+	const int x0 = Max(FloorToInt(minX), 0);
+	const int y0 = Max(FloorToInt(minY), 0);
+	const int x1 = Min(CeilToInt(maxX), (int)width_);
+	const int y1 = Min(CeilToInt(maxY), (int)height_);
+
+	// Outside the view
+	if (x0 >= x1 || y0 >= y1)
+		return false;
+
+#ifdef URHO3D_SSE
+	const __m128 laneIndices = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 first = _mm_set1_ps((float)x0);
+	const __m128 last = _mm_set1_ps((float)x1);
+	const __m128 boxDepth = _mm_set1_ps(minDepth);
+	for (int y = y0; y < y1; ++y)
+	{
+		const float* row = &depth_[y * width_];
+		for (int x = x0 & ~3; x < x1; x += 4)
+		{
+			const __m128 indices = _mm_add_ps(_mm_set1_ps((float)x), laneIndices);
+			const __m128 covered = _mm_and_ps(_mm_cmpge_ps(indices, first), _mm_cmplt_ps(indices, last));
+			const __m128 farther = _mm_cmpgt_ps(_mm_loadu_ps(row + x), boxDepth);
+			if (_mm_movemask_ps(_mm_and_ps(covered, farther)))
+				return true;
+		}
+	}
+#else
+	for (int y = y0; y < y1; ++y)
+	{
+		const float* row = &depth_[y * width_];
+		for (int x = x0; x < x1; ++x)
+		{
+			if (row[x] > minDepth)
+				return true;
+		}
+	}
+#endif
+
+	return false;
+}
+
+OcclusionDepthBuffer::ScreenVertex OcclusionDepthBuffer::Project(const Vector3& position) const
+{
+	const Vector4 clip = viewProjection_ * Vector4(position, 1.0f);
+
+	ScreenVertex vertex;
+	vertex.depth_ = clip.w_;
+	vertex.clipped_ = clip.w_ < nearDistance_;
+	if (vertex.clipped_)
+	{
+		vertex.x_ = vertex.y_ = 0.0f;
+		return vertex;
+	}
+
+	const float invW = 1.0f / clip.w_;
+	vertex.x_ = (clip.x_ * invW * 0.5f + 0.5f) * width_;
+	vertex.y_ = (0.5f - clip.y_ * invW * 0.5f) * height_;
+	return vertex;
+}
+
+void OcclusionDepthBuffer::RasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2)
+{
+	if (v0.clipped_ || v1.clipped_ || v2.clipped_)
+		return;
+
+	// Both windings are filled, box faces turned away from the camera end up behind the front ones anyway
+	const float area = (v1.x_ - v0.x_) * (v2.y_ - v0.y_) - (v1.y_ - v0.y_) * (v2.x_ - v0.x_);
+	if (Abs(area) < M_EPSILON)
+		return;
+
+	const ScreenVertex& a = v0;
+	const ScreenVertex& b = area > 0.0f ? v1 : v2;
+	const ScreenVertex& c = area > 0.0f ? v2 : v1;
+
+	const int x0 = Max(FloorToInt(Min(a.x_, Min(b.x_, c.x_))), 0);
+	const int y0 = Max(FloorToInt(Min(a.y_, Min(b.y_, c.y_))), 0);
+	const int x1 = Min(CeilToInt(Max(a.x_, Max(b.x_, c.x_))), (int)width_);
+	const int y1 = Min(CeilToInt(Max(a.y_, Max(b.y_, c.y_))), (int)height_);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	++numTriangles_;
+
+	const EdgeFunction e0(a.x_, a.y_, b.x_, b.y_);
+	const EdgeFunction e1(b.x_, b.y_, c.x_, c.y_);
+	const EdgeFunction e2(c.x_, c.y_, a.x_, a.y_);
+	const float depth = Max(a.depth_, Max(b.depth_, c.depth_));
+
+#ifdef URHO3D_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 a0 = _mm_set1_ps(e0.a_);
+	const __m128 a1 = _mm_set1_ps(e1.a_);
+	const __m128 a2 = _mm_set1_ps(e2.a_);
+	const __m128 triangleDepth = _mm_set1_ps(depth);
+	for (int y = y0; y < y1; ++y)
+	{
+		const float centerY = y + 0.5f;
+		const __m128 row0 = _mm_set1_ps(e0.b_ * centerY + e0.c_);
+		const __m128 row1 = _mm_set1_ps(e1.b_ * centerY + e1.c_);
+		const __m128 row2 = _mm_set1_ps(e2.b_ * centerY + e2.c_);
+		float* row = &depth_[y * width_];
+
+		// Lanes left of the bounds have their centers outside the triangle, the width is a multiple of four
+		for (int x = x0 & ~3; x < x1; x += 4)
+		{
+			const __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneCenters);
+			const __m128 inside = _mm_and_ps(_mm_and_ps(
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, centerX), row0), zero),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, centerX), row1), zero)),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, centerX), row2), zero));
+			if (!_mm_movemask_ps(inside))
+				continue;
+
+			const __m128 old = _mm_loadu_ps(row + x);
+			const __m128 nearer = _mm_min_ps(old, triangleDepth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+	}
+#else
+	for (int y = y0; y < y1; ++y)
+	{
+		const float centerY = y + 0.5f;
+		float* row = &depth_[y * width_];
+		for (int x = x0; x < x1; ++x)
+		{
+			const float centerX = x + 0.5f;
+			if (e0.a_ * centerX + e0.b_ * centerY + e0.c_ >= 0.0f &&
+				e1.a_ * centerX + e1.b_ * centerY + e1.c_ >= 0.0f &&
+				e2.a_ * centerX + e2.b_ * centerY + e2.c_ >= 0.0f)
+				row[x] = Min(row[x], depth);
+		}
+	}
+#endif
+}
@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Math/Matrix4.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Low resolution depth buffer rasterizing occluder boxes on the CPU and testing bounding boxes against them.
+	/// Depth is view distance, each triangle is written at its farthest vertex and each tested box is compared at its
+	/// nearest corner, so a box is reported occluded only when it is behind the occluders everywhere it covers.
+	/// Triangles crossing the near plane are left out. Rows are processed four pixels at a time with SSE when the
+	/// engine is built with it. Needs no engine objects, so it can be driven with synthetic occluders and boxes.
+	class OcclusionDepthBuffer
+	{
+	public:
+		/// Set resolution, the width is rounded up to a multiple of four.
+		void SetSize(unsigned width, unsigned height);
+		/// Clear to the far distance and set the view-projection matrix and near distance for the next occluders.
+		void Clear(const Matrix4& viewProjection, float nearDistance);
+		/// Rasterize a box with a world transform.
+		void AddOccluder(const Matrix3x4& transform, const BoundingBox& localBox);
+		/// Return whether any part of a world space box may be visible.
+		bool IsVisible(const BoundingBox& worldBox) const;
+
+		/// Return width.
+		unsigned GetWidth() const { return width_; }
+		/// Return height.
+		unsigned GetHeight() const { return height_; }
+		/// Return view distance stored at a pixel.
+		float GetDepth(unsigned x, unsigned y) const { return depth_[y * width_ + x]; }
+		/// Return number of triangles rasterized since the last clear.
+		unsigned GetNumTriangles() const { return numTriangles_; }
+
+	private:
+		/// Projected vertex in pixels with its view distance.
+		struct ScreenVertex
+		{
+			float x_;
+			float y_;
+			float depth_;
+			/// Vertex is behind the near distance.
+			bool clipped_;
+		};
+
+		/// Return a projected world position.
+		ScreenVertex Project(const Vector3& position) const;
+		/// Rasterize a triangle at a constant depth.
+		void RasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2);
+
+		/// View distances in row order.
+		ea::vector<float> depth_;
+		/// View-projection matrix.
+		Matrix4 viewProjection_;
+		/// Near distance.
+		float nearDistance_ = 0.0f;
+		/// Width in pixels, a multiple of four.
+		unsigned width_ = 0;
+		/// Height in pixels.
+		unsigned height_ = 0;
+		/// Triangles rasterized since the last clear.
+		unsigned numTriangles_ = 0;
+	};
+}
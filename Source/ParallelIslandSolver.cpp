@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <Bullet/BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h>
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+
+#include "ParallelIslandSolver.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Return whether an island touches a kinematic body. Kinematic bodies do not join islands, so several islands
+/// may share one, and the solver writes into every dynamic or kinematic body it touches.
+bool HasKinematicBody(const ea::vector<btPersistentManifold*>& manifolds, const ea::vector<btTypedConstraint*>& constraints)
+{
+	for (btPersistentManifold* manifold : manifolds)
+	{
+		if (manifold->getBody0()->isKinematicObject() || manifold->getBody1()->isKinematicObject())
+			return true;
+	}
+	for (btTypedConstraint* constraint : constraints)
+	{
+		if (constraint->getRigidBodyA().isKinematicObject() || constraint->getRigidBodyB().isKinematicObject())
+			return true;
+	}
+	return false;
+}
+
+}
+
+IslandSolverAdapter::IslandSolverAdapter(ParallelIslandSolver* owner) :
+	owner_(owner)
+{
+	const unsigned numThreads = owner_->GetSubsystem<WorkQueue>()->GetNumThreads() + 1;
+	for (unsigned i = 0; i < numThreads; ++i)
+		solvers_.push_back(new btSequentialImpulseConstraintSolver());
+}
+
+IslandSolverAdapter::~IslandSolverAdapter()
+{
+	for (btSequentialImpulseConstraintSolver* solver : solvers_)
+		delete solver;
+}
+
+btScalar IslandSolverAdapter::solveGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds,
+	int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info,
+	btIDebugDraw* debugDrawer, btDispatcher* dispatcher)
+{
+	if (numIslands_ == islands_.size())
+		islands_.emplace_back();
+
+	Island& island = islands_[numIslands_++];
+	island.bodies_.assign(bodies, bodies + numBodies);
+	island.manifolds_.assign(manifolds, manifolds + numManifolds);
+	island.constraints_.assign(constraints, constraints + numConstraints);
+	island.time_ = 0;
+	island.serial_ = HasKinematicBody(island.manifolds_, island.constraints_);
+
+	info_ = &info;
+	debugDrawer_ = debugDrawer;
+	dispatcher_ = dispatcher;
+	return 0.0f;
+}
+
+void IslandSolverAdapter::allSolved(const btContactSolverInfo& info, btIDebugDraw* debugDrawer)
+{
+	HiresTimer stepTimer;
+
+	// Islands sharing kinematic bodies go first on the main thread, the rest are picked by the workers in any order
+	for (unsigned i = 0; i < numIslands_; ++i)
+	{
+		if (islands_[i].serial_)
+			SolveIsland(islands_[i], 0);
+	}
+
+	auto* workQueue = owner_->GetSubsystem<WorkQueue>();
+	const unsigned maxThreads = owner_->numThreads_ ? owner_->numThreads_ : solvers_.size();
+	const unsigned numItems = Min(Min(maxThreads, (unsigned)solvers_.size()), numIslands_);
+
+	nextIsland_ = 0;
+	if (numItems <= 1)
+		SolveRemaining(0);
+	else
+	{
+		// The main thread takes items too while waiting in Complete
+		for (unsigned i = 0; i < numItems; ++i)
+		{
+			SharedPtr<WorkItem> item = workQueue->GetFreeItem();
+			item->priority_ = M_MAX_UNSIGNED;
+			item->workFunction_ = SolveIslands;
+			item->aux_ = this;
+			item->sendEvent_ = false;
+			workQueue->AddWorkItem(item);
+		}
+		workQueue->Complete(M_MAX_UNSIGNED);
+	}
+
+	owner_->islandTimes_.clear();
+	for (unsigned i = 0; i < numIslands_; ++i)
+	{
+		const Island& island = islands_[i];
+		owner_->islandTimes_.push_back({ (unsigned)island.bodies_.size(),
+			(unsigned)(island.manifolds_.size() + island.constraints_.size()), island.time_ });
+	}
+	owner_->solveTime_ = stepTimer.GetUSec(false);
+
+	numIslands_ = 0;
+}
+
+void IslandSolverAdapter::SolveIsland(Island& island, unsigned threadIndex)
+{
+	HiresTimer timer;
+	solvers_[threadIndex]->solveGroup(island.bodies_.data(), island.bodies_.size(), island.manifolds_.data(),
+		island.manifolds_.size(), island.constraints_.data(), island.constraints_.size(), *info_, debugDrawer_, dispatcher_);
+	island.time_ = timer.GetUSec(false);
+}
+
+void IslandSolverAdapter::SolveRemaining(unsigned threadIndex)
+{
+	for (unsigned i = nextIsland_++; i < numIslands_; i = nextIsland_++)
+	{
+		if (!islands_[i].serial_)
+			SolveIsland(islands_[i], threadIndex);
+	}
+}
+
+void IslandSolverAdapter::SolveIslands(const WorkItem* item, unsigned threadIndex)
+{
+	static_cast<IslandSolverAdapter*>(item->aux_)->SolveRemaining(threadIndex);
+}
+
+void IslandSolverAdapter::reset()
+{
+	for (btSequentialImpulseConstraintSolver* solver : solvers_)
+		solver->reset();
+}
+
+ParallelIslandSolver::ParallelIslandSolver(Context* context) :
+	Component(context)
+{
+}
+
+ParallelIslandSolver::~ParallelIslandSolver()
+{
+	Uninstall();
+}
+
+void ParallelIslandSolver::OnSceneSet(Scene* scene)
+{
+	Uninstall();
+	if (scene)
+	{
+		if (auto* physicsWorld = scene->GetComponent<PhysicsWorld>())
+			Install(physicsWorld);
+	}
+}
+
+void ParallelIslandSolver::Install(PhysicsWorld* physicsWorld)
+{
+	btDiscreteDynamicsWorld* world = physicsWorld->GetWorld();
+
+	physicsWorld_ = physicsWorld;
+	adapter_ = ea::make_unique<IslandSolverAdapter>(this);
+	originalSolver_ = world->getConstraintSolver();
+	originalBatchSize_ = world->getSolverInfo().m_minimumSolverBatchSize;
+
+	// Every island on its own, merging small islands into batches would hide them from the timing. The world does
+	// not own the PhysicsWorld's solver, so swapping does not free it
+	world->getSolverInfo().m_minimumSolverBatchSize = 1;
+	world->setConstraintSolver(adapter_.get());
+}
+
+void ParallelIslandSolver::Uninstall()
+{
+	if (physicsWorld_)
+	{
+		btDiscreteDynamicsWorld* world = physicsWorld_->GetWorld();
+		world->setConstraintSolver(originalSolver_);
+		world->getSolverInfo().m_minimumSolverBatchSize = originalBatchSize_;
+	}
+
+	physicsWorld_.Reset();
+	adapter_.reset();
+	originalSolver_ = nullptr;
+	islandTimes_.clear();
+}
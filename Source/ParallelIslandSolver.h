@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+#include <Bullet/BulletDynamics/ConstraintSolver/btConstraintSolver.h>
+
+#include <atomic>
+
+using namespace Urho3D;
+
+class btSequentialImpulseConstraintSolver;
+
+namespace Urho3D
+{
+	class PhysicsWorld;
+	struct WorkItem;
+}
+
+namespace MonsterDolls
+{
+	class ParallelIslandSolver;
+
+	/// Solve statistics of one simulation island.
+	struct IslandSolveTime
+	{
+		/// Bodies in the island.
+		unsigned numBodies_;
+		/// Contact manifolds and constraints in the island.
+		unsigned numConstraints_;
+		/// Solver time in microseconds.
+		long long time_;
+	};
+
+	/// Bullet constraint solver that collects the islands handed over by the dynamics world and solves them
+	/// together on the WorkQueue once all are known. Every thread has its own sequential impulse solver.
+	class IslandSolverAdapter : public btConstraintSolver
+	{
+	public:
+		/// Construct.
+		explicit IslandSolverAdapter(ParallelIslandSolver* owner);
+		/// Destruct.
+		~IslandSolverAdapter() override;
+
+		/// Store an island for the parallel solve.
+		btScalar solveGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds,
+			btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer,
+			btDispatcher* dispatcher) override;
+		/// Solve the stored islands.
+		void allSolved(const btContactSolverInfo& info, btIDebugDraw* debugDrawer) override;
+		/// Reset the per-thread solvers.
+		void reset() override;
+		/// Return solver type.
+		btConstraintSolverType getSolverType() const override { return BT_SEQUENTIAL_IMPULSE_SOLVER; }
+
+	private:
+		/// Bodies, manifolds and constraints of one island, copied since Bullet reuses its arrays.
+		struct Island
+		{
+			ea::vector<btCollisionObject*> bodies_;
+			ea::vector<btPersistentManifold*> manifolds_;
+			ea::vector<btTypedConstraint*> constraints_;
+			long long time_ = 0;
+			bool serial_ = false;
+		};
+
+		/// Solve one island with the solver of a thread.
+		void SolveIsland(Island& island, unsigned threadIndex);
+		/// Solve parallel islands until none is left.
+		void SolveRemaining(unsigned threadIndex);
+		/// Work item function solving islands until none is left.
+		static void SolveIslands(const WorkItem* item, unsigned threadIndex);
+
+		/// Component owning the adapter.
+		ParallelIslandSolver* owner_;
+		/// Sequential impulse solver per thread, the main thread is index 0.
+		ea::vector<btSequentialImpulseConstraintSolver*> solvers_;
+		/// Islands of the running step, reused between steps.
+		ea::vector<Island> islands_;
+		/// Number of islands in the running step.
+		unsigned numIslands_ = 0;
+		/// Next island to solve.
+		std::atomic<unsigned> nextIsland_{ 0 };
+		/// Solver settings of the running step.
+		const btContactSolverInfo* info_ = nullptr;
+		/// Debug drawer of the running step.
+		btIDebugDraw* debugDrawer_ = nullptr;
+		/// Dispatcher of the running step.
+		btDispatcher* dispatcher_ = nullptr;
+	};
+
+	/// Solves the ragdoll islands of the scene's physics world in parallel. Replaces the constraint solver of the
+	/// Bullet world while it is in the scene and records the solve time of every island of the last step.
+	class ParallelIslandSolver : public Component
+	{
+		URHO3D_OBJECT(ParallelIslandSolver, Component);
+
+	public:
+		/// Construct.
+		explicit ParallelIslandSolver(Context* context);
+		/// Destruct.
+		~ParallelIslandSolver() override;
+
+		/// Set maximum threads solving islands, including the main thread. 0 uses all WorkQueue threads.
+		void SetNumThreads(unsigned numThreads) { numThreads_ = numThreads; }
+
+		/// Return maximum threads solving islands.
+		unsigned GetNumThreads() const { return numThreads_; }
+		/// Return solve times of the islands of the last step.
+		const ea::vector<IslandSolveTime>& GetIslandTimes() const { return islandTimes_; }
+		/// Return total solve time of the last step in microseconds.
+		long long GetSolveTime() const { return solveTime_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		friend class IslandSolverAdapter;
+
+		/// Put the adapter into the Bullet world.
+		void Install(PhysicsWorld* physicsWorld);
+		/// Give the Bullet world its own solver back.
+		void Uninstall();
+
+		/// Physics world using the adapter.
+		WeakPtr<PhysicsWorld> physicsWorld_;
+		/// Solver installed in the world.
+		ea::unique_ptr<IslandSolverAdapter> adapter_;
+		/// Solver of the world before installing.
+		btConstraintSolver* originalSolver_ = nullptr;
+		/// Island batch size of the world before installing.
+		int originalBatchSize_ = 0;
+		/// Maximum threads.
+		unsigned numThreads_ = 0;
+		/// Island solve times of the last step.
+		ea::vector<IslandSolveTime> islandTimes_;
+		/// Total solve time of the last step.
+		long long solveTime_ = 0;
+	};
+}
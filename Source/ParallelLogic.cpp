@@ -0,0 +1,359 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "ParallelLogic.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Ticks run in one frame at most, a longer frame drops the rest of its time instead of falling further behind.
+const unsigned MAX_TICKS_PER_FRAME = 5;
+/// Seconds a frame may fall short of a tick and still run it, so frames at the tick rate run one tick each.
+const float TICK_TOLERANCE = 0.0001f;
+
+}
+
+void TransformInterpolation::SetTarget(Node* node, const Vector3& position, const Quaternion& rotation)
+{
+	auto it = entries_.find(node);
+	if (it == entries_.end())
+	{
+		// The node was not blended, its transform is where the tick started
+		it = entries_.emplace(node, Entry{ WeakPtr<Node>(node), node->GetPosition(), node->GetRotation(),
+			Vector3::ZERO, Quaternion::IDENTITY, false, false }).first;
+	}
+
+	Entry& entry = it->second;
+	entry.targetPosition_ = position;
+	entry.targetRotation_ = rotation;
+	entry.moved_ = true;
+	node->SetTransform(position, rotation);
+}
+
+void TransformInterpolation::BeginTick()
+{
+	for (auto it = entries_.begin(); it != entries_.end();)
+	{
+		Entry& entry = it->second;
+		if (!entry.node_ || !entry.moved_)
+		{
+			it = entries_.erase(it);
+			continue;
+		}
+
+		entry.startPosition_ = entry.targetPosition_;
+		entry.startRotation_ = entry.targetRotation_;
+		entry.moved_ = false;
+		++it;
+	}
+}
+
+void TransformInterpolation::Restore()
+{
+	for (auto& pair : entries_)
+	{
+		Entry& entry = pair.second;
+		if (entry.blended_ && entry.node_)
+			entry.node_->SetTransform(entry.targetPosition_, entry.targetRotation_);
+		entry.blended_ = false;
+	}
+}
+
+void TransformInterpolation::Apply(float alpha)
+{
+	for (auto& pair : entries_)
+	{
+		Entry& entry = pair.second;
+		if (!entry.node_ || (entry.startPosition_ == entry.targetPosition_ && entry.startRotation_ == entry.targetRotation_))
+			continue;
+
+		entry.node_->SetTransform(entry.startPosition_.Lerp(entry.targetPosition_, alpha),
+			entry.startRotation_.Slerp(entry.targetRotation_, alpha));
+		entry.blended_ = true;
+	}
+}
+
+void TransformInterpolation::Clear()
+{
+	Restore();
+	entries_.clear();
+}
+
+void LogicCommandBuffer::SetTransform(Node* node, const Vector3& position, const Quaternion& rotation)
+{
+	transforms_.push_back({ node, position, rotation });
+}
+
+void LogicCommandBuffer::RemoveNode(Node* node)
+{
+	removals_.push_back(node);
+}
+
+void LogicCommandBuffer::Defer(ea::function<void()> action)
+{
+	actions_.push_back(ea::move(action));
+}
+
+void LogicCommandBuffer::Prepare(TransformInterpolation* interpolation)
+{
+	for (const TransformCommand& command : transforms_)
+	{
+		if (interpolation)
+			interpolation->SetTarget(command.node_, command.position_, command.rotation_);
+		else
+			command.node_->SetTransform(command.position_, command.rotation_);
+	}
+	transforms_.clear();
+
+	for (Node* node : removals_)
+		preparedRemovals_.emplace_back(node);
+	removals_.clear();
+}
+
+void LogicCommandBuffer::Execute()
+{
+	for (const ea::function<void()>& action : actions_)
+		action();
+	actions_.clear();
+
+	for (const WeakPtr<Node>& node : preparedRemovals_)
+	{
+		if (node)
+			node->Remove();
+	}
+	preparedRemovals_.clear();
+}
+
+ParallelLogicComponent::ParallelLogicComponent(Context* context) :
+	LogicComponent(context)
+{
+}
+
+void ParallelLogicComponent::Update(float timeStep)
+{
+	LogicCommandBuffer commands;
+	ParallelUpdate(timeStep, commands);
+	commands.Prepare();
+	commands.Execute();
+}
+
+void ParallelLogicComponent::OnSceneSet(Scene* scene)
+{
+	LogicComponent::OnSceneSet(scene);
+
+	if (phase_)
+		phase_->RemoveComponent(this);
+	ResetPhase();
+	if (!scene)
+		return;
+
+	phase_ = scene->GetComponent<ParallelLogicPhase>();
+	if (phase_)
+	{
+		phase_->AddComponent(this);
+		// Still subscribed until the delayed start has run
+		SetUpdateEventMask(GetUpdateEventMask() & ~USE_UPDATE);
+	}
+}
+
+void ParallelLogicComponent::ResetPhase()
+{
+	phase_.Reset();
+	SetUpdateEventMask(GetUpdateEventMask() | USE_UPDATE);
+}
+
+ParallelLogicPhase::ParallelLogicPhase(Context* context) :
+	Component(context)
+{
+}
+
+ParallelLogicPhase::~ParallelLogicPhase()
+{
+	ResetComponents();
+}
+
+void ParallelLogicPhase::SetTickRate(unsigned ticksPerSecond)
+{
+	// Leave the nodes at their last tick transform
+	interpolation_.Clear();
+	tickRate_ = ticksPerSecond;
+	tickAccumulator_ = 0.0f;
+}
+
+void ParallelLogicPhase::AddComponent(ParallelLogicComponent* component)
+{
+	components_.push_back(component);
+}
+
+void ParallelLogicPhase::RemoveComponent(ParallelLogicComponent* component)
+{
+	auto it = ea::find(components_.begin(), components_.end(), component);
+	if (it != components_.end())
+	{
+		*it = components_.back();
+		components_.pop_back();
+	}
+}
+
+void ParallelLogicPhase::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(ParallelLogicPhase, HandleSceneUpdate));
+	else
+	{
+		UnsubscribeFromEvent(E_SCENEUPDATE);
+		ResetComponents();
+		interpolation_.Clear();
+	}
+}
+
+void ParallelLogicPhase::ResetComponents()
+{
+	// Components outliving the phase go back to serial updates
+	for (ParallelLogicComponent* component : components_)
+		component->ResetPhase();
+	components_.clear();
+}
+
+void ParallelLogicPhase::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace SceneUpdate;
+
+	const float timeStep = eventData[P_TIMESTEP].GetFloat();
+	if (!tickRate_)
+	{
+		numTicks_ = 1;
+		RunTick(timeStep);
+		return;
+	}
+
+	// Logic continues from the last tick, not from the blended transforms
+	const float tickStep = 1.0f / tickRate_;
+	interpolation_.Restore();
+
+	numTicks_ = 0;
+	tickAccumulator_ += timeStep;
+	while (tickAccumulator_ + TICK_TOLERANCE >= tickStep)
+	{
+		if (numTicks_ == MAX_TICKS_PER_FRAME)
+		{
+			tickAccumulator_ = 0.0f;
+			break;
+		}
+
+		tickAccumulator_ = Max(tickAccumulator_ - tickStep, 0.0f);
+		interpolation_.BeginTick();
+		RunTick(tickStep);
+		++numTicks_;
+	}
+
+	interpolation_.Apply(tickAccumulator_ / tickStep);
+}
+
+void ParallelLogicPhase::RunTick(float timeStep)
+{
+	timeStep_ = timeStep;
+
+	// Refresh cached world transforms here, lazy evaluation from several workers would race on shared parents
+	active_.clear();
+	for (ParallelLogicComponent* component : components_)
+	{
+		if (component->IsEnabledEffective() && component->IsDelayedStartCalled())
+		{
+			component->GetNode()->GetWorldTransform();
+			active_.push_back(component);
+		}
+	}
+	if (active_.empty())
+	{
+		SendPostTick();
+		return;
+	}
+
+	auto* workQueue = GetSubsystem<WorkQueue>();
+	const unsigned numThreads = workQueue->GetNumThreads() + 1;
+	const unsigned chunkSize = Max(minChunkSize_, (active_.size() + numThreads - 1) / numThreads);
+	const unsigned numChunks = (active_.size() + chunkSize - 1) / chunkSize;
+	if (chunks_.size() < numChunks)
+		chunks_.resize(numChunks);
+
+	if (numChunks == 1)
+	{
+		for (ParallelLogicComponent* component : active_)
+			component->ParallelUpdate(timeStep_, chunks_[0].commands_);
+	}
+	else
+	{
+		for (unsigned i = 0; i < numChunks; ++i)
+		{
+			SharedPtr<WorkItem> item = workQueue->GetFreeItem();
+			item->priority_ = M_MAX_UNSIGNED;
+			item->workFunction_ = UpdateChunk;
+			item->start_ = active_.data() + i * chunkSize;
+			item->end_ = active_.data() + Min((i + 1) * chunkSize, active_.size());
+			chunks_[i].phase_ = this;
+			item->aux_ = &chunks_[i];
+			item->sendEvent_ = false;
+			workQueue->AddWorkItem(item);
+		}
+		workQueue->Complete(M_MAX_UNSIGNED);
+	}
+
+	// Buffers in chunk order keep the result independent of which thread ran first
+	TransformInterpolation* interpolation = tickRate_ ? &interpolation_ : nullptr;
+	for (unsigned i = 0; i < numChunks; ++i)
+		chunks_[i].commands_.Prepare(interpolation);
+	for (unsigned i = 0; i < numChunks; ++i)
+		chunks_[i].commands_.Execute();
+
+	SendPostTick();
+}
+
+void ParallelLogicPhase::SendPostTick()
+{
+	using namespace LogicPostTick;
+
+	Scene* scene = GetScene();
+	VariantMap& eventData = GetEventDataMap();
+	eventData[P_SCENE] = scene;
+	eventData[P_TIMESTEP] = timeStep_;
+	scene->SendEvent(E_LOGICPOSTTICK, eventData);
+}
+
+void ParallelLogicPhase::UpdateChunk(const WorkItem* item, unsigned threadIndex)
+{
+	auto** start = static_cast<ParallelLogicComponent**>(item->start_);
+	auto** end = static_cast<ParallelLogicComponent**>(item->end_);
+	auto* chunk = static_cast<Chunk*>(item->aux_);
+	const float timeStep = chunk->phase_->timeStep_;
+
+	for (ParallelLogicComponent** component = start; component != end; ++component)
+		(*component)->ParallelUpdate(timeStep, chunk->commands_);
+}
@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/LogicComponent.h>
+
+#include <EASTL/functional.h>
+#include <EASTL/unordered_map.h>
+
+namespace Urho3D
+{
+	struct WorkItem;
+}
+
+using namespace Urho3D;
+
+/// Logic tick of a ParallelLogicPhase finished and its commands were applied. Sent by the scene.
+URHO3D_EVENT(E_LOGICPOSTTICK, LogicPostTick)
+{
+	URHO3D_PARAM(P_SCENE, Scene);                  // Scene pointer
+	URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
+}
+
+namespace MonsterDolls
+{
+	class ParallelLogicPhase;
+
+	/// Transforms of the nodes moved by fixed logic ticks. The nodes hold the transform of the last tick while logic
+	/// runs and are blended between the last two ticks for rendering.
+	class TransformInterpolation
+	{
+	public:
+		/// Record the transform a node has at the end of the running tick and set it.
+		void SetTarget(Node* node, const Vector3& position, const Quaternion& rotation);
+		/// Start a tick: forget nodes the previous tick did not move, the last targets become the start transforms.
+		void BeginTick();
+		/// Put blended nodes back to their last tick transform.
+		void Restore();
+		/// Blend nodes between their start and target transform.
+		void Apply(float alpha);
+		/// Restore the nodes and forget them.
+		void Clear();
+
+	private:
+		/// Interpolated node.
+		struct Entry
+		{
+			/// Node.
+			WeakPtr<Node> node_;
+			/// Position at the start of the last tick.
+			Vector3 startPosition_;
+			/// Rotation at the start of the last tick.
+			Quaternion startRotation_;
+			/// Position at the end of the last tick.
+			Vector3 targetPosition_;
+			/// Rotation at the end of the last tick.
+			Quaternion targetRotation_;
+			/// Moved by the running tick.
+			bool moved_;
+			/// Holds a blended transform.
+			bool blended_;
+		};
+
+		/// Interpolated nodes.
+		ea::unordered_map<Node*, Entry> entries_;
+	};
+
+	/// Scene changes requested from a parallel update, applied later on the main thread. A component may only
+	/// record changes of its own node, or deferred actions that run on the main thread.
+	class LogicCommandBuffer
+	{
+	public:
+		/// Set local position and rotation of a node.
+		void SetTransform(Node* node, const Vector3& position, const Quaternion& rotation);
+		/// Remove a node from the scene.
+		void RemoveNode(Node* node);
+		/// Run an action on the main thread, e.g. spawning, sound playback or component removal.
+		void Defer(ea::function<void()> action);
+
+		/// Apply the transforms, through the interpolation if any, and hold the removed nodes weakly. Must run for
+		/// every buffer before any Execute.
+		void Prepare(TransformInterpolation* interpolation = nullptr);
+		/// Run the deferred actions, then remove the nodes, and clear the buffer.
+		void Execute();
+
+	private:
+		/// Transform change.
+		struct TransformCommand
+		{
+			Node* node_;
+			Vector3 position_;
+			Quaternion rotation_;
+		};
+
+		/// Transform changes.
+		ea::vector<TransformCommand> transforms_;
+		/// Nodes to remove, as recorded.
+		ea::vector<Node*> removals_;
+		/// Nodes to remove, held weakly once prepared since deferred actions may remove them first.
+		ea::vector<WeakPtr<Node> > preparedRemovals_;
+		/// Deferred actions.
+		ea::vector<ea::function<void()> > actions_;
+	};
+
+	/// Logic component whose per-entity update may run on a worker thread. With a ParallelLogicPhase in the scene
+	/// ParallelUpdate is called from the phase, otherwise it runs serially from the scene update.
+	class ParallelLogicComponent : public LogicComponent
+	{
+		URHO3D_OBJECT(ParallelLogicComponent, LogicComponent);
+
+	public:
+		/// Construct.
+		explicit ParallelLogicComponent(Context* context);
+
+		/// Update from any thread. Must only read the scene and write the component's own state, everything else
+		/// goes through the command buffer.
+		virtual void ParallelUpdate(float timeStep, LogicCommandBuffer& commands) = 0;
+		/// Handle scene update when no phase runs the component. Called by LogicComponent base class.
+		void Update(float timeStep) override;
+
+		/// Forget the phase, the component updates serially again. Called by the phase when it goes away.
+		void ResetPhase();
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Phase running the component.
+		WeakPtr<ParallelLogicPhase> phase_;
+	};
+
+	/// Runs the ParallelLogicComponents of a scene in chunks on the WorkQueue during the scene update, then applies
+	/// their command buffers on the main thread in chunk order, so the outcome does not depend on thread timing.
+	/// With a tick rate the components run at that fixed rate instead of once per frame, as many ticks as the frame
+	/// time covers, and the nodes they move are blended between the last two ticks for rendering. Logic then gives
+	/// the same result at any frame rate.
+	class ParallelLogicPhase : public Component
+	{
+		URHO3D_OBJECT(ParallelLogicPhase, Component);
+
+	public:
+		/// Construct.
+		explicit ParallelLogicPhase(Context* context);
+		/// Destruct.
+		~ParallelLogicPhase() override;
+
+		/// Add a component.
+		void AddComponent(ParallelLogicComponent* component);
+		/// Remove a component.
+		void RemoveComponent(ParallelLogicComponent* component);
+
+		/// Set minimum components per work item.
+		void SetMinChunkSize(unsigned size) { minChunkSize_ = Max(size, 1u); }
+		/// Set logic ticks per second, 0 runs once per frame with the frame time step.
+		void SetTickRate(unsigned ticksPerSecond);
+
+		/// Return number of components.
+		unsigned GetNumComponents() const { return components_.size(); }
+		/// Return logic ticks per second, 0 when running once per frame.
+		unsigned GetTickRate() const { return tickRate_; }
+		/// Return ticks run in the last scene update.
+		unsigned GetNumTicks() const { return numTicks_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Commands of one work item.
+		struct Chunk
+		{
+			/// Phase running the chunk.
+			ParallelLogicPhase* phase_;
+			/// Recorded changes.
+			LogicCommandBuffer commands_;
+		};
+
+		/// Handle scene update.
+		void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+		/// Update the components once.
+		void RunTick(float timeStep);
+		/// Send the post tick event from the scene.
+		void SendPostTick();
+		/// Send every component back to serial updates.
+		void ResetComponents();
+		/// Work item function updating a chunk of components.
+		static void UpdateChunk(const WorkItem* item, unsigned threadIndex);
+
+		/// Registered components.
+		ea::vector<ParallelLogicComponent*> components_;
+		/// Components updated this frame.
+		ea::vector<ParallelLogicComponent*> active_;
+		/// Work item chunks.
+		ea::vector<Chunk> chunks_;
+		/// Minimum components per work item.
+		unsigned minChunkSize_ = 64;
+		/// Time step of the running update.
+		float timeStep_ = 0.0f;
+		/// Logic ticks per second, 0 runs once per frame.
+		unsigned tickRate_ = 0;
+		/// Frame time not yet covered by ticks.
+		float tickAccumulator_ = 0.0f;
+		/// Ticks run in the last scene update.
+		unsigned numTicks_ = 0;
+		/// Nodes moved by the ticks.
+		TransformInterpolation interpolation_;
+	};
+}
@@ -0,0 +1,249 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/XMLFile.h>
+
+#include "PerformanceProfiles.h"
+#include "Sample.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Config file attribute and command line option of a profile value.
+template <class T> struct ProfileValue
+{
+	const char* attribute_;
+	const char* option_;
+	T PerformanceProfile::*member_;
+};
+
+const ProfileValue<int> INT_VALUES[] =
+{
+	{ "maxFps", "--max-fps", &PerformanceProfile::maxFps_ },
+	{ "multiSample", "--multisample", &PerformanceProfile::multiSample_ },
+	{ "textureQuality", "--texture-quality", &PerformanceProfile::textureQuality_ },
+	{ "shadowMapSize", "--shadow-map-size", &PerformanceProfile::shadowMapSize_ },
+	{ "physicsFps", "--physics-fps", &PerformanceProfile::physicsFps_ },
+	{ "physicsSubSteps", "--physics-substeps", &PerformanceProfile::physicsSubSteps_ },
+	{ "physicsThreads", "--physics-threads", &PerformanceProfile::physicsThreads_ },
+	{ "logicFps", "--logic-fps", &PerformanceProfile::logicFps_ },
+	{ "zombies", "--zombies", &PerformanceProfile::numZombies_ },
+	{ "hitsToKill", "--hits-to-kill", &PerformanceProfile::hitsToKill_ },
+	{ "ragdollFrames", "--ragdoll-frames", &PerformanceProfile::ragdollFrames_ },
+};
+
+const ProfileValue<float> FLOAT_VALUES[] =
+{
+	{ "ragdollLinearRest", "--ragdoll-linear-rest", &PerformanceProfile::ragdollLinearRest_ },
+	{ "ragdollAngularRest", "--ragdoll-angular-rest", &PerformanceProfile::ragdollAngularRest_ },
+	{ "ragdollLinearDamping", "--ragdoll-linear-damping", &PerformanceProfile::ragdollLinearDamping_ },
+	{ "ragdollAngularDamping", "--ragdoll-angular-damping", &PerformanceProfile::ragdollAngularDamping_ },
+	{ "modelBudget", "--model-budget", &PerformanceProfile::modelBudget_ },
+	{ "animationBudget", "--animation-budget", &PerformanceProfile::animationBudget_ },
+	{ "soundBudget", "--sound-budget", &PerformanceProfile::soundBudget_ },
+	{ "textureBudget", "--texture-budget", &PerformanceProfile::textureBudget_ },
+	{ "frameBudget", "--frame-budget", &PerformanceProfile::frameBudget_ },
+};
+
+const ProfileValue<bool> BOOL_VALUES[] =
+{
+	{ "vsync", "--vsync", &PerformanceProfile::vsync_ },
+	{ "shadows", "--shadows", &PerformanceProfile::shadows_ },
+	{ "lowQualityShadows", "--low-quality-shadows", &PerformanceProfile::lowQualityShadows_ },
+	{ "occlusion", "--occlusion", &PerformanceProfile::occlusion_ },
+	{ "parallelSkinning", "--parallel-skinning", &PerformanceProfile::parallelSkinning_ },
+	{ "ragdollPose", "--ragdoll-pose", &PerformanceProfile::ragdollPose_ },
+};
+
+/// Return a built-in profile, starting from the high defaults.
+PerformanceProfile MakeProfile(const char* name)
+{
+	PerformanceProfile profile;
+	profile.name_ = name;
+	return profile;
+}
+
+}
+
+PerformanceProfiles::PerformanceProfiles(Context* context) :
+	Object(context)
+{
+	PerformanceProfile low = MakeProfile("low");
+	low.maxFps_ = 60;
+	low.vsync_ = true;
+	low.textureQuality_ = 0;
+	low.lowQualityShadows_ = true;
+	low.shadowMapSize_ = 512;
+	low.physicsFps_ = 30;
+	low.physicsSubSteps_ = 2;
+	low.logicFps_ = 30;
+	low.ragdollLinearRest_ = 2.5f;
+	low.ragdollAngularRest_ = 4.0f;
+	low.ragdollFrames_ = 50;
+	low.modelBudget_ = 24.0f;
+	low.animationBudget_ = 8.0f;
+	low.soundBudget_ = 8.0f;
+	low.textureBudget_ = 64.0f;
+	low.frameBudget_ = 33.3f;
+	profiles_[low.name_] = low;
+
+	PerformanceProfile medium = MakeProfile("medium");
+	medium.maxFps_ = 60;
+	medium.vsync_ = true;
+	medium.textureQuality_ = 1;
+	medium.physicsSubSteps_ = 2;
+	medium.ragdollLinearRest_ = 2.0f;
+	medium.ragdollAngularRest_ = 3.0f;
+	profiles_[medium.name_] = medium;
+
+	profiles_["high"] = MakeProfile("high");
+
+	// Repeatable load: no frame cap, a fixed quality level and a crowd large enough to measure
+	PerformanceProfile benchmark = MakeProfile("benchmark");
+	benchmark.maxFps_ = 0;
+	benchmark.numZombies_ = 100;
+	benchmark.frameBudget_ = 0.0f;
+	profiles_[benchmark.name_] = benchmark;
+
+	profile_ = profiles_["high"];
+}
+
+bool PerformanceProfiles::LoadFile(const ea::string& fileName)
+{
+	auto xml = MakeShared<XMLFile>(context_);
+	if (!xml->LoadFile(fileName))
+		return false;
+
+	// A profile changes the built-in one of the same name, or starts from its base profile, high by default
+	for (XMLElement element = xml->GetRoot().GetChild("profile"); element; element = element.GetNext("profile"))
+	{
+		const ea::string name = element.GetAttribute("name");
+		if (name.empty())
+		{
+			URHO3D_LOGWARNING("Skipping profile without a name in {}", fileName);
+			continue;
+		}
+
+		auto it = profiles_.find(name);
+		if (it == profiles_.end())
+		{
+			auto base = profiles_.find(element.HasAttribute("base") ? element.GetAttribute("base") : "high");
+			it = profiles_.emplace(name, base != profiles_.end() ? base->second : PerformanceProfile()).first;
+			it->second.name_ = name;
+		}
+		ReadValues(element, it->second);
+	}
+
+	auto it = profiles_.find(profile_.name_);
+	if (it != profiles_.end())
+		profile_ = it->second;
+	return true;
+}
+
+bool PerformanceProfiles::SelectProfile(const ea::string& name)
+{
+	auto it = profiles_.find(name.to_lower());
+	if (it == profiles_.end())
+	{
+		URHO3D_LOGWARNING("Unknown performance profile {}, keeping {}", name, profile_.name_);
+		return false;
+	}
+
+	profile_ = it->second;
+	return true;
+}
+
+void PerformanceProfiles::ApplyArguments()
+{
+	for (const ProfileValue<int>& value : INT_VALUES)
+	{
+		const ea::string argument = GetArgumentValue(value.option_);
+		if (!argument.empty())
+			profile_.*value.member_ = ToInt(argument);
+	}
+	for (const ProfileValue<float>& value : FLOAT_VALUES)
+	{
+		const ea::string argument = GetArgumentValue(value.option_);
+		if (!argument.empty())
+			profile_.*value.member_ = ToFloat(argument);
+	}
+	for (const ProfileValue<bool>& value : BOOL_VALUES)
+	{
+		const ea::string argument = GetArgumentValue(value.option_);
+		if (!argument.empty())
+			profile_.*value.member_ = ToBool(argument);
+	}
+}
+
+void PerformanceProfiles::ApplyEngineParameters(StringVariantMap& engineParameters) const
+{
+	engineParameters[EP_VSYNC] = profile_.vsync_;
+	engineParameters[EP_MULTI_SAMPLE] = profile_.multiSample_;
+	engineParameters[EP_TEXTURE_QUALITY] = profile_.textureQuality_;
+	engineParameters[EP_SHADOWS] = profile_.shadows_;
+	engineParameters[EP_LOW_QUALITY_SHADOWS] = profile_.lowQualityShadows_;
+}
+
+void PerformanceProfiles::ApplyToEngine() const
+{
+	GetSubsystem<Engine>()->SetMaxFps(profile_.maxFps_);
+	if (auto* renderer = GetSubsystem<Renderer>())
+		renderer->SetShadowMapSize(profile_.shadowMapSize_);
+
+	URHO3D_LOGINFO("Performance profile {}: {} fps cap, physics at {} Hz, {} zombies, frame budget {} ms", profile_.name_,
+		profile_.maxFps_, profile_.physicsFps_, profile_.numZombies_, profile_.frameBudget_);
+}
+
+const PerformanceProfile& PerformanceProfiles::GetCurrent(Context* context)
+{
+	static const PerformanceProfile defaultProfile;
+	auto* profiles = context->GetSubsystem<PerformanceProfiles>();
+	return profiles ? profiles->GetProfile() : defaultProfile;
+}
+
+void PerformanceProfiles::ReadValues(const XMLElement& element, PerformanceProfile& profile)
+{
+	for (const ProfileValue<int>& value : INT_VALUES)
+	{
+		if (element.HasAttribute(value.attribute_))
+			profile.*value.member_ = element.GetInt(value.attribute_);
+	}
+	for (const ProfileValue<float>& value : FLOAT_VALUES)
+	{
+		if (element.HasAttribute(value.attribute_))
+			profile.*value.member_ = element.GetFloat(value.attribute_);
+	}
+	for (const ProfileValue<bool>& value : BOOL_VALUES)
+	{
+		if (element.HasAttribute(value.attribute_))
+			profile.*value.member_ = element.GetBool(value.attribute_);
+	}
+}
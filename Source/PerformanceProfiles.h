@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class XMLElement;
+}
+
+namespace MonsterDolls
+{
+	/// Engine, physics, renderer and gameplay values of a hardware tier. Defaults match the "high" profile.
+	struct PerformanceProfile
+	{
+		/// Profile name.
+		ea::string name_ = "high";
+		/// Frame rate cap, 0 is unlimited.
+		int maxFps_ = 200;
+		/// Wait for vertical sync.
+		bool vsync_ = false;
+		/// Multisample antialiasing level.
+		int multiSample_ = 1;
+		/// Texture quality, 0 low to 2 high.
+		int textureQuality_ = 2;
+		/// Render shadows.
+		bool shadows_ = true;
+		/// Use 16-bit shadow maps.
+		bool lowQualityShadows_ = false;
+		/// Shadow map size in texels.
+		int shadowMapSize_ = 1024;
+		/// Physics steps per second.
+		int physicsFps_ = 60;
+		/// Physics steps per frame at most, 0 picks from the frame time.
+		int physicsSubSteps_ = 0;
+		/// Gameplay logic ticks per second, rendered in between by interpolation. 0 runs logic once per frame.
+		int logicFps_ = 60;
+		/// Island solver threads, 0 uses all work queue threads and -1 keeps the serial solver.
+		int physicsThreads_ = -1;
+		/// Freeze the animation of zombies hidden behind occluders.
+		bool occlusion_ = true;
+		/// Resolve crowd bone matrices on the work queue, otherwise on the main thread.
+		bool parallelSkinning_ = true;
+		/// Pose ragdoll bones straight from their bodies, otherwise every body sets its bone node each step.
+		bool ragdollPose_ = true;
+		/// Zombies in the arena.
+		int numZombies_ = 11;
+		/// Hits that kill a zombie, earlier ones only make the hit limb react. 1 kills with every hit.
+		int hitsToKill_ = 3;
+		/// Linear velocity under which ragdoll bodies go to sleep.
+		float ragdollLinearRest_ = 1.5f;
+		/// Angular velocity under which ragdoll bodies go to sleep.
+		float ragdollAngularRest_ = 2.5f;
+		/// Linear damping of ragdoll bodies.
+		float ragdollLinearDamping_ = 0.05f;
+		/// Angular damping of ragdoll bodies.
+		float ragdollAngularDamping_ = 0.85f;
+		/// Logic ticks a ragdoll lies on the floor before it is removed.
+		int ragdollFrames_ = 100;
+		/// Memory budget of cached models in megabytes, 0 is unlimited.
+		float modelBudget_ = 0.0f;
+		/// Memory budget of cached animations in megabytes, 0 is unlimited.
+		float animationBudget_ = 0.0f;
+		/// Memory budget of cached sounds in megabytes, 0 is unlimited.
+		float soundBudget_ = 0.0f;
+		/// Memory budget of cached textures in megabytes, 0 is unlimited.
+		float textureBudget_ = 0.0f;
+		/// Frame budget of the quality governor in milliseconds, 0 keeps the quality fixed.
+		float frameBudget_ = 16.6f;
+	};
+
+	/// Named performance profiles: built-in low, medium, high and benchmark, changed or extended by a config file,
+	/// one selected with --profile and every value overridable by its own command line option. Read once during
+	/// application setup and registered as a subsystem the engine, scenes and gameplay components read from.
+	class PerformanceProfiles : public Object
+	{
+		URHO3D_OBJECT(PerformanceProfiles, Object);
+
+	public:
+		/// Construct with the built-in profiles.
+		explicit PerformanceProfiles(Context* context);
+
+		/// Load profiles from an XML config file. Return true on success.
+		bool LoadFile(const ea::string& fileName);
+		/// Select the profile with a name. Return false and keep the current one if it does not exist.
+		bool SelectProfile(const ea::string& name);
+		/// Override values of the selected profile from the command line.
+		void ApplyArguments();
+		/// Write the window and renderer values into engine startup parameters.
+		void ApplyEngineParameters(StringVariantMap& engineParameters) const;
+		/// Apply the values that can only be set after engine initialization.
+		void ApplyToEngine() const;
+
+		/// Return the selected profile.
+		const PerformanceProfile& GetProfile() const { return profile_; }
+
+		/// Return the selected profile of the subsystem, or the defaults when it is not registered.
+		static const PerformanceProfile& GetCurrent(Context* context);
+
+	private:
+		/// Read the values present as attributes of an element.
+		static void ReadValues(const XMLElement& element, PerformanceProfile& profile);
+
+		/// All profiles by name.
+		ea::unordered_map<ea::string, PerformanceProfile> profiles_;
+		/// Selected profile with the command line overrides.
+		PerformanceProfile profile_;
+	};
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/DebugRenderer.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/Constraint.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "PhysicsDebugView.h"
+#include "ProjectileSweep.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+PhysicsDebugView::PhysicsDebugView(Context* context) :
+	Component(context)
+{
+}
+
+void PhysicsDebugView::Draw(Camera* camera, DebugRenderer* debug, bool depthTest)
+{
+	if (!camera || !debug)
+		return;
+
+	if (++framesSinceRefresh_ >= refreshInterval_)
+	{
+		framesSinceRefresh_ = 0;
+		Refresh(camera);
+	}
+
+	numDrawn_ = 0;
+	for (Component* component : drawList_)
+	{
+		// Anything removed since the refresh is simply skipped
+		if (component && component->IsEnabledEffective())
+		{
+			component->DrawDebugGeometry(debug, depthTest);
+			++numDrawn_;
+		}
+	}
+}
+
+void PhysicsDebugView::Refresh(Camera* camera)
+{
+	drawList_.clear();
+
+	auto* physicsWorld = GetScene()->GetComponent<PhysicsWorld>();
+	if (!physicsWorld)
+		return;
+
+	// Broadphase query instead of walking the scene
+	const Vector3 cameraPosition = camera->GetNode()->GetWorldPosition();
+	physicsWorld->GetRigidBodies(bodies_, Sphere(cameraPosition, radius_));
+
+	const Frustum& frustum = camera->GetFrustum();
+
+	for (RigidBody* body : bodies_)
+	{
+		if (drawList_.size() >= maxPrimitives_)
+			break;
+
+		const PhysicsDebugCategory category = GetCategory(body);
+		const bool drawShapes = (categories_ & category) != 0;
+		const bool drawConstraints = (categories_ & DEBUG_CONSTRAINTS) && category == DEBUG_RAGDOLLS;
+		if (!drawShapes && !drawConstraints)
+			continue;
+
+		Node* node = body->GetNode();
+
+		if (drawShapes)
+		{
+			node->GetComponents(components_, CollisionShape::GetTypeStatic());
+			for (Component* component : components_)
+			{
+				auto* shape = static_cast<CollisionShape*>(component);
+				if (frustumCulling_ && frustum.IsInsideFast(shape->GetWorldBoundingBox()) == OUTSIDE)
+					continue;
+				if (drawList_.size() < maxPrimitives_)
+					drawList_.push_back(WeakPtr<Component>(shape));
+			}
+		}
+
+		if (drawConstraints)
+		{
+			if (frustumCulling_ && frustum.IsInside(node->GetWorldPosition()) == OUTSIDE)
+				continue;
+
+			node->GetComponents(components_, Constraint::GetTypeStatic());
+			for (Component* component : components_)
+			{
+				if (drawList_.size() < maxPrimitives_)
+					drawList_.push_back(WeakPtr<Component>(component));
+			}
+		}
+	}
+}
+
+PhysicsDebugCategory PhysicsDebugView::GetCategory(RigidBody* body) const
+{
+	if (body->IsTrigger())
+		return DEBUG_TRIGGERS;
+	if (body->GetNode()->HasComponent<ProjectileSweep>())
+		return DEBUG_PROJECTILES;
+	if (body->GetMass() > 0.0f)
+		return DEBUG_RAGDOLLS;
+	return DEBUG_STATIC;
+}
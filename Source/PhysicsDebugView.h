@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Camera;
+	class DebugRenderer;
+	class RigidBody;
+}
+
+namespace MonsterDolls
+{
+	/// Physics debug geometry categories.
+	enum PhysicsDebugCategory : unsigned
+	{
+		DEBUG_TRIGGERS = 1,
+		DEBUG_RAGDOLLS = 2,
+		DEBUG_CONSTRAINTS = 4,
+		DEBUG_PROJECTILES = 8,
+		DEBUG_STATIC = 16,
+		DEBUG_ALL = 31
+	};
+
+	/// Physics debug drawing limited to what helps: bodies within a radius of the camera and inside its frustum,
+	/// filtered by category and capped in count. The set of shapes to draw is refreshed every N-th frame and
+	/// redrawn from the cache in between, instead of drawing the whole world every frame.
+	class PhysicsDebugView : public Component
+	{
+		URHO3D_OBJECT(PhysicsDebugView, Component);
+
+	public:
+		/// Construct.
+		explicit PhysicsDebugView(Context* context);
+
+		/// Draw the debug geometry seen by the camera.
+		void Draw(Camera* camera, DebugRenderer* debug, bool depthTest);
+
+		/// Set radius around the camera to draw.
+		void SetRadius(float radius) { radius_ = radius; }
+		/// Set whether to skip bodies outside the camera frustum.
+		void SetFrustumCulling(bool enable) { frustumCulling_ = enable; }
+		/// Set drawn categories as a PhysicsDebugCategory mask.
+		void SetCategories(unsigned categories) { categories_ = categories; }
+		/// Set frames between refreshes of the drawn set.
+		void SetRefreshInterval(unsigned frames) { refreshInterval_ = Max(frames, 1u); }
+		/// Set maximum number of drawn shapes and constraints.
+		void SetMaxPrimitives(unsigned count) { maxPrimitives_ = count; }
+
+		/// Return drawn categories.
+		unsigned GetCategories() const { return categories_; }
+		/// Return number of shapes and constraints drawn in the last frame.
+		unsigned GetNumDrawn() const { return numDrawn_; }
+
+	private:
+		/// Collect the shapes and constraints to draw.
+		void Refresh(Camera* camera);
+		/// Return category of a rigid body.
+		PhysicsDebugCategory GetCategory(RigidBody* body) const;
+
+		/// Cached shapes and constraints to draw.
+		ea::vector<WeakPtr<Component> > drawList_;
+		/// Candidates of the broadphase query, reused between refreshes.
+		ea::vector<RigidBody*> bodies_;
+		/// Scratch list of node components.
+		ea::vector<Component*> components_;
+		/// Camera radius.
+		float radius_ = 40.0f;
+		/// Frustum culling flag.
+		bool frustumCulling_ = true;
+		/// Drawn categories.
+		unsigned categories_ = DEBUG_ALL & ~DEBUG_STATIC;
+		/// Frames between refreshes.
+		unsigned refreshInterval_ = 4;
+		/// Cap of drawn shapes and constraints.
+		unsigned maxPrimitives_ = 1000;
+		/// Frames since the last refresh.
+		unsigned framesSinceRefresh_ = M_MAX_UNSIGNED;
+		/// Shapes and constraints drawn in the last frame.
+		unsigned numDrawn_ = 0;
+	};
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "ProjectileSweep.h"
+#include "CreateRagdoll.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Zombies one projectile may go through in a single step.
+const unsigned MAX_HITS_PER_STEP = 4;
+
+}
+
+ProjectileSweep::ProjectileSweep(Context* context) :
+	Component(context)
+{
+}
+
+void ProjectileSweep::OnSceneSet(Scene* scene)
+{
+	if (scene)
+	{
+		if (auto* physicsWorld = scene->GetComponent<PhysicsWorld>())
+			SubscribeToEvent(physicsWorld, E_PHYSICSPRESTEP, URHO3D_HANDLER(ProjectileSweep, HandlePhysicsPreStep));
+	}
+	else
+		UnsubscribeFromEvent(E_PHYSICSPRESTEP);
+}
+
+void ProjectileSweep::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PhysicsPreStep;
+
+	auto* body = GetComponent<RigidBody>();
+	if (!body)
+		return;
+
+	const Vector3 velocity = body->GetLinearVelocity();
+	float distance = velocity.Length() * eventData[P_TIMESTEP].GetFloat();
+	// Slow projectiles are handled fine by the discrete step
+	if (distance < radius_)
+		return;
+
+	auto* physicsWorld = static_cast<PhysicsWorld*>(eventData[P_WORLD].GetPtr());
+	Ray ray(body->GetPosition(), velocity.Normalized());
+
+	// Triggers do not stop the projectile, keep sweeping behind every zombie hit in this step
+	for (unsigned i = 0; i < MAX_HITS_PER_STEP && distance > 0.0f; ++i)
+	{
+		PhysicsRaycastResult result;
+		physicsWorld->SphereCast(result, ray, radius_, distance, ZOMBIE_TRIGGER_LAYER);
+		if (!result.body_)
+			break;
+
+		if (auto* createRagdoll = result.body_->GetComponent<CreateRagdoll>())
+			createRagdoll->Hit(result.position_, velocity * body->GetMass(), body);
+
+		const float advance = result.distance_ + radius_;
+		ray.origin_ += ray.direction_ * advance;
+		distance -= advance;
+	}
+}
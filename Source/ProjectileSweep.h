@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Continuous collision for a fast projectile against the zombie triggers. Before every physics step the
+	/// projectile's sphere is swept along the distance it will travel in the step, and every zombie trigger it
+	/// passes through is turned into a ragdoll, even when the discrete step would jump over the trigger.
+	class ProjectileSweep : public Component
+	{
+		URHO3D_OBJECT(ProjectileSweep, Component);
+
+	public:
+		/// Construct.
+		explicit ProjectileSweep(Context* context);
+
+		/// Set swept sphere radius in world units.
+		void SetRadius(float radius) { radius_ = radius; }
+		/// Return swept sphere radius.
+		float GetRadius() const { return radius_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle physics pre-step.
+		void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
+
+		/// Swept sphere radius.
+		float radius_ = 0.125f;
+	};
+}
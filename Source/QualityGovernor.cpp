@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "QualityGovernor.h"
+#include "ProjectileSweep.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Levels from the lowest to the highest quality.
+const QualityLevel QUALITY_LEVELS[] =
+{
+	{ "Low", Vector3(5.0f, 20.0f, 50.0f), 10.0f, 0.25f, RAGDOLL_TORSO, 8 },
+	{ "Medium", Vector3(8.0f, 30.0f, 100.0f), 25.0f, 0.5f, RAGDOLL_NO_FOREARMS, 16 },
+	{ "High", Vector3(10.0f, 50.0f, 200.0f), 50.0f, 1.0f, RAGDOLL_FULL, 32 },
+	{ "Ultra", Vector3(15.0f, 75.0f, 300.0f), 0.0f, 2.0f, RAGDOLL_FULL, 64 }
+};
+
+const unsigned NUM_QUALITY_LEVELS = sizeof(QUALITY_LEVELS) / sizeof(QUALITY_LEVELS[0]);
+
+/// Smoothing factor of the frame time average per frame.
+const float FRAME_TIME_SMOOTHING = 0.05f;
+/// Average over budget * this steps down.
+const float STEP_DOWN_RATIO = 1.05f;
+/// Average under budget * this steps up.
+const float STEP_UP_RATIO = 0.7f;
+/// Seconds over budget before stepping down.
+const float STEP_DOWN_DELAY = 0.5f;
+/// Seconds under budget before stepping up.
+const float STEP_UP_DELAY = 3.0f;
+/// Seconds after a change before the next one.
+const float CHANGE_COOLDOWN = 2.0f;
+/// Seconds between applying the knobs to new zombies.
+const float ZOMBIE_REFRESH_INTERVAL = 1.0f;
+
+}
+
+QualityGovernor::QualityGovernor(Context* context) :
+	Component(context),
+	level_(NUM_QUALITY_LEVELS - 2)
+{
+}
+
+void QualityGovernor::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(QualityGovernor, HandleUpdate));
+	else
+		UnsubscribeFromEvent(E_UPDATE);
+}
+
+unsigned QualityGovernor::GetNumLevels() const
+{
+	return NUM_QUALITY_LEVELS;
+}
+
+const QualityLevel& QualityGovernor::GetQuality() const
+{
+	return QUALITY_LEVELS[level_];
+}
+
+void QualityGovernor::SetTargets(Node* lightNode, Node* zombiesNode)
+{
+	lightNode_ = lightNode;
+	zombiesNode_ = zombiesNode;
+	SetLevel(level_);
+}
+
+void QualityGovernor::SetLevel(unsigned level)
+{
+	level_ = Min(level, NUM_QUALITY_LEVELS - 1);
+	const QualityLevel& quality = GetQuality();
+
+	if (lightNode_)
+	{
+		if (auto* light = lightNode_->GetComponent<Light>())
+		{
+			const Vector3& splits = quality.cascadeSplits_;
+			light->SetShadowCascade(CascadeParameters(splits.x_, splits.y_, splits.z_, 0.0f, 0.8f));
+		}
+	}
+
+	ApplyToZombies();
+	EnforceProjectileCap();
+}
+
+void QualityGovernor::ApplyToZombies()
+{
+	if (!zombiesNode_)
+		return;
+
+	const QualityLevel& quality = GetQuality();
+	for (Node* zombie : zombiesNode_->GetChildren())
+	{
+		if (auto* model = zombie->GetComponent<AnimatedModel>())
+		{
+			model->SetShadowDistance(quality.zombieShadowDistance_);
+			model->SetAnimationLodBias(quality.animationLodBias_);
+		}
+	}
+}
+
+void QualityGovernor::EnforceProjectileCap()
+{
+	GetScene()->GetChildrenWithComponent<ProjectileSweep>(projectiles_);
+
+	// Children keep their creation order, the first ones are the oldest
+	const unsigned maxProjectiles = GetQuality().maxProjectiles_;
+	for (unsigned i = 0; i + maxProjectiles < projectiles_.size(); ++i)
+		projectiles_[i]->Remove();
+}
+
+void QualityGovernor::HandleUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace Update;
+
+	const float timeStep = eventData[P_TIMESTEP].GetFloat();
+	averageFrameTime_ = averageFrameTime_ > 0.0f ? Lerp(averageFrameTime_, timeStep, FRAME_TIME_SMOOTHING) : timeStep;
+
+	zombieRefreshTimer_ -= timeStep;
+	if (zombieRefreshTimer_ <= 0.0f)
+	{
+		zombieRefreshTimer_ = ZOMBIE_REFRESH_INTERVAL;
+		ApplyToZombies();
+	}
+
+	overBudgetTime_ = averageFrameTime_ > frameBudget_ * STEP_DOWN_RATIO ? overBudgetTime_ + timeStep : 0.0f;
+	underBudgetTime_ = averageFrameTime_ < frameBudget_ * STEP_UP_RATIO ? underBudgetTime_ + timeStep : 0.0f;
+
+	if (cooldown_ > 0.0f)
+	{
+		cooldown_ -= timeStep;
+		return;
+	}
+
+	unsigned newLevel = level_;
+	if (overBudgetTime_ >= STEP_DOWN_DELAY && level_ > 0)
+		--newLevel;
+	else if (underBudgetTime_ >= STEP_UP_DELAY && level_ + 1 < NUM_QUALITY_LEVELS)
+		++newLevel;
+
+	if (newLevel == level_)
+		return;
+
+	URHO3D_LOGINFO("Quality {} -> {}, frame time {:.2f} ms, budget {:.2f} ms", GetQuality().name_,
+		QUALITY_LEVELS[newLevel].name_, averageFrameTime_ * 1000.0f, frameBudget_ * 1000.0f);
+
+	SetLevel(newLevel);
+	overBudgetTime_ = 0.0f;
+	underBudgetTime_ = 0.0f;
+	cooldown_ = CHANGE_COOLDOWN;
+}
@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Ragdoll detail tiers, fewer physical bones on lower tiers.
+	enum RagdollTier
+	{
+		RAGDOLL_FULL = 0,
+		RAGDOLL_NO_FOREARMS,
+		RAGDOLL_TORSO
+	};
+
+	/// Quality knobs of one governor level.
+	struct QualityLevel
+	{
+		/// Level name shown in the HUD.
+		const char* name_;
+		/// Directional light cascade split distances.
+		Vector3 cascadeSplits_;
+		/// Distance within which zombies cast shadows, 0 is unlimited.
+		float zombieShadowDistance_;
+		/// Animation LOD bias of the zombies, lower updates distant animations less often.
+		float animationLodBias_;
+		/// Detail of newly activated ragdolls.
+		RagdollTier ragdollTier_;
+		/// Maximum number of live projectiles.
+		unsigned maxProjectiles_;
+	};
+
+	/// Keeps the frame time within a budget by stepping quality levels. The smoothed frame time has to stay over
+	/// the budget for a while to step down and clearly under it for longer to step up, and every change is followed
+	/// by a cooldown, so the level does not oscillate between two neighbours.
+	class QualityGovernor : public Component
+	{
+		URHO3D_OBJECT(QualityGovernor, Component);
+
+	public:
+		/// Construct.
+		explicit QualityGovernor(Context* context);
+
+		/// Set frame time budget in seconds.
+		void SetFrameBudget(float seconds) { frameBudget_ = seconds; }
+		/// Set quality level and apply it.
+		void SetLevel(unsigned level);
+		/// Set scene nodes the knobs act on.
+		void SetTargets(Node* lightNode, Node* zombiesNode);
+		/// Remove oldest projectiles above the cap of the current level.
+		void EnforceProjectileCap();
+
+		/// Return frame time budget in seconds.
+		float GetFrameBudget() const { return frameBudget_; }
+		/// Return current level index, 0 is the lowest quality.
+		unsigned GetLevel() const { return level_; }
+		/// Return number of levels.
+		unsigned GetNumLevels() const;
+		/// Return knobs of the current level.
+		const QualityLevel& GetQuality() const;
+		/// Return smoothed frame time in seconds.
+		float GetAverageFrameTime() const { return averageFrameTime_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle the frame update.
+		void HandleUpdate(StringHash eventType, VariantMap& eventData);
+		/// Apply the zombie knobs to every zombie, also the ones created after the last level change.
+		void ApplyToZombies();
+
+		/// Directional light node.
+		WeakPtr<Node> lightNode_;
+		/// Parent node of the zombies.
+		WeakPtr<Node> zombiesNode_;
+		/// Projectile nodes scratch list.
+		ea::vector<Node*> projectiles_;
+		/// Frame time budget.
+		float frameBudget_ = 1.0f / 60.0f;
+		/// Exponential moving average of the frame time.
+		float averageFrameTime_ = 0.0f;
+		/// Time the average has been over the budget.
+		float overBudgetTime_ = 0.0f;
+		/// Time the average has been well under the budget.
+		float underBudgetTime_ = 0.0f;
+		/// Time left before the level may change again. Starts with a warm-up so loading does not count.
+		float cooldown_ = 2.0f;
+		/// Time until the zombie knobs are applied again.
+		float zombieRefreshTimer_ = 0.0f;
+		/// Current level.
+		unsigned level_ = 0;
+	};
+}
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Math/Quaternion.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Square root of two, range of the three smallest quaternion components is +-1/sqrt(2).
+	const float QUANTIZATION_SQRT2 = 1.41421356f;
+
+	/// Quantize a position inside the box to 16 bits per axis.
+	inline void QuantizePosition(const Vector3& position, const BoundingBox& box, unsigned short* out)
+	{
+		const Vector3 size = box.Size();
+		const Vector3 relative = position - box.min_;
+		const float values[3] = { relative.x_ / size.x_, relative.y_ / size.y_, relative.z_ / size.z_ };
+		for (unsigned i = 0; i < 3; ++i)
+			out[i] = (unsigned short)RoundToInt(Clamp(values[i], 0.0f, 1.0f) * 65535.0f);
+	}
+
+	/// Restore a position quantized with QuantizePosition.
+	inline Vector3 DequantizePosition(const unsigned short* in, const BoundingBox& box)
+	{
+		const Vector3 size = box.Size();
+		return box.min_ + Vector3(in[0] * size.x_, in[1] * size.y_, in[2] * size.z_) / 65535.0f;
+	}
+
+	/// Pack a unit quaternion into 32 bits: index of the largest component in the top 2 bits, the other three
+	/// components with 10 bits each. The largest component is restored from the unit length.
+	inline unsigned QuantizeRotation(const Quaternion& rotation)
+	{
+		const float components[4] = { rotation.w_, rotation.x_, rotation.y_, rotation.z_ };
+
+		unsigned largest = 0;
+		for (unsigned i = 1; i < 4; ++i)
+		{
+			if (Abs(components[i]) > Abs(components[largest]))
+				largest = i;
+		}
+
+		// q and -q are the same rotation, keep the dropped component positive
+		const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+		unsigned packed = largest << 30u;
+		for (unsigned i = 0, shift = 20; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+
+			const float value = Clamp(components[i] * sign * QUANTIZATION_SQRT2 * 0.5f + 0.5f, 0.0f, 1.0f);
+			packed |= (unsigned)RoundToInt(value * 1023.0f) << shift;
+			shift -= 10;
+		}
+		return packed;
+	}
+
+	/// Restore a rotation packed with QuantizeRotation.
+	inline Quaternion DequantizeRotation(unsigned packed)
+	{
+		const unsigned largest = packed >> 30u;
+
+		float components[4];
+		float sumSquares = 0.0f;
+		for (unsigned i = 0, shift = 20; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+
+			components[i] = (((packed >> shift) & 1023u) / 1023.0f - 0.5f) * QUANTIZATION_SQRT2;
+			sumSquares += components[i] * components[i];
+			shift -= 10;
+		}
+		components[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+
+		return Quaternion(components[0], components[1], components[2], components[3]).Normalized();
+	}
+}
@@ -0,0 +1,199 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Physics/PhysicsUtils.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "RagdollPose.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+RagdollMotionState::RagdollMotionState(RagdollPose* owner, RigidBody* body) :
+	owner_(owner),
+	body_(body),
+	centerOfMass_(body->GetCenterOfMass())
+{
+	const btTransform& worldTrans = body->GetBody()->getWorldTransform();
+	rotation_ = ToQuaternion(worldTrans.getRotation());
+	position_ = ToVector3(worldTrans.getOrigin()) - rotation_ * centerOfMass_;
+}
+
+void RagdollMotionState::getWorldTransform(btTransform& worldTrans) const
+{
+	worldTrans.setOrigin(ToBtVector3(position_ + rotation_ * centerOfMass_));
+	worldTrans.setRotation(ToBtQuaternion(rotation_));
+}
+
+void RagdollMotionState::setWorldTransform(const btTransform& worldTrans)
+{
+	rotation_ = ToQuaternion(worldTrans.getRotation());
+	position_ = ToVector3(worldTrans.getOrigin()) - rotation_ * centerOfMass_;
+	owner_->MarkChanged();
+}
+
+RagdollPose::RagdollPose(Context* context) :
+	Component(context)
+{
+}
+
+RagdollPose::~RagdollPose()
+{
+	Detach();
+}
+
+void RagdollPose::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(RagdollPose, HandleScenePostUpdate));
+	else
+	{
+		Detach();
+		UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+	}
+}
+
+void RagdollPose::Attach()
+{
+	Detach();
+
+	auto* model = GetComponent<AnimatedModel>();
+	if (!model)
+		return;
+
+	Skeleton& skeleton = model->GetSkeleton();
+	const unsigned numBones = skeleton.GetNumBones();
+	boneStates_.assign(numBones, nullptr);
+	worldTransforms_.resize(numBones);
+
+	ea::vector<bool> posed(numBones, false);
+	for (unsigned i = 0; i < numBones; ++i)
+	{
+		Node* boneNode = skeleton.GetBone(i)->node_;
+		auto* body = boneNode ? boneNode->GetComponent<RigidBody>() : nullptr;
+		if (!body || !body->GetBody() || body->GetMass() <= 0.0f)
+			continue;
+
+		states_.push_back(ea::make_unique<RagdollMotionState>(this, body));
+		boneStates_[i] = states_.back().get();
+		body->GetBody()->setMotionState(boneStates_[i]);
+
+		// The parents of a body bone are posed too, its transform is relative to theirs
+		for (unsigned j = i; !posed[j];)
+		{
+			posed[j] = true;
+			const unsigned parent = skeleton.GetBone(j)->parentIndex_;
+			if (parent == j || parent >= numBones)
+				break;
+			j = parent;
+		}
+	}
+
+	// Parents come before their children in the bone list
+	for (unsigned i = 0; i < numBones; ++i)
+	{
+		if (posed[i])
+			poseBones_.push_back(i);
+	}
+}
+
+void RagdollPose::Detach()
+{
+	// The RigidBody components read the node transforms back, bring them up to date first
+	if (GetScene())
+		Apply();
+
+	for (const auto& state : states_)
+	{
+		RigidBody* body = state->GetBody();
+		btRigidBody* btBody = body ? body->GetBody() : nullptr;
+		if (!btBody)
+			continue;
+
+		// The nodes may show an interpolated pose, keep the simulated one
+		const btTransform worldTrans = btBody->getWorldTransform();
+		btBody->setMotionState(body);
+		btBody->setWorldTransform(worldTrans);
+	}
+
+	states_.clear();
+	boneStates_.clear();
+	poseBones_.clear();
+	changed_ = false;
+}
+
+void RagdollPose::Apply()
+{
+	if (!changed_)
+		return;
+	changed_ = false;
+
+	auto* model = GetComponent<AnimatedModel>();
+	auto* physicsWorld = GetScene() ? GetScene()->GetComponent<PhysicsWorld>() : nullptr;
+	if (!model || !physicsWorld || model->GetSkeleton().GetNumBones() != boneStates_.size())
+		return;
+
+	// Parent relative transforms of the body bones, from the world transforms of the bodies and the parents
+	// posed before them. The rest of the bones keep their transform relative to their parent
+	Skeleton& skeleton = model->GetSkeleton();
+	for (unsigned i : poseBones_)
+	{
+		const Bone* bone = skeleton.GetBone(i);
+		Node* boneNode = bone->node_;
+		if (!boneNode)
+			continue;
+
+		const unsigned parent = bone->parentIndex_;
+		const Matrix3x4 parentTransform = parent != i && parent < boneStates_.size() ? worldTransforms_[parent] :
+			boneNode->GetParent()->GetWorldTransform();
+
+		const RagdollMotionState* state = boneStates_[i];
+		if (state && state->GetBody())
+		{
+			boneNode->SetPositionSilent(parentTransform.Inverse() * state->GetPosition());
+			boneNode->SetRotationSilent(parentTransform.Rotation().Inverse() * state->GetRotation());
+		}
+		worldTransforms_[i] = parentTransform * Matrix3x4(boneNode->GetPosition(), boneNode->GetRotation(),
+			boneNode->GetScale());
+	}
+
+	// One dirty walk per moved subtree notifies the AnimatedModel. The bodies already are where the nodes went,
+	// the RigidBody components must not push the pose back into them
+	physicsWorld->SetApplyingTransforms(true);
+	for (unsigned i : poseBones_)
+	{
+		Node* boneNode = skeleton.GetBone(i)->node_;
+		if (boneNode && boneStates_[i] && boneStates_[i]->GetBody())
+			boneNode->MarkDirty();
+	}
+	physicsWorld->SetApplyingTransforms(false);
+}
+
+void RagdollPose::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+	Apply();
+}
@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+#include <Bullet/LinearMath/btMotionState.h>
+
+#include <EASTL/unique_ptr.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class RigidBody;
+}
+
+namespace MonsterDolls
+{
+	class RagdollPose;
+
+	/// Bullet motion state that keeps the latest world transform of a ragdoll bone body for its RagdollPose,
+	/// without touching the bone node.
+	class RagdollMotionState : public btMotionState
+	{
+	public:
+		/// Construct for a body, starting from its current transform.
+		RagdollMotionState(RagdollPose* owner, RigidBody* body);
+
+		/// Return the stored transform to Bullet.
+		void getWorldTransform(btTransform& worldTrans) const override;
+		/// Store the transform Bullet computed, interpolated between steps if the world interpolates.
+		void setWorldTransform(const btTransform& worldTrans) override;
+
+		/// Return the body.
+		RigidBody* GetBody() const { return body_; }
+		/// Return world position of the bone node.
+		const Vector3& GetPosition() const { return position_; }
+		/// Return world rotation of the bone node.
+		const Quaternion& GetRotation() const { return rotation_; }
+
+	private:
+		/// Pose owning the state.
+		RagdollPose* owner_;
+		/// Body of the bone.
+		WeakPtr<RigidBody> body_;
+		/// Body center of mass relative to the bone node.
+		Vector3 centerOfMass_;
+		/// World position of the bone node.
+		Vector3 position_;
+		/// World rotation of the bone node.
+		Quaternion rotation_;
+	};
+
+	/// Poses the bones of a ragdoll straight from its rigid bodies. Once attached, Bullet hands the bodies' world
+	/// transforms to light motion states instead of the RigidBody components, so a physics step no longer sets the
+	/// world transform of every bone node, each dirtying its subtree and resolving its parents again. After the scene
+	/// update, or when Apply is called before the bodies are handed back, the parent relative transforms are computed
+	/// from the bodies in bone order and written without notification, then every moved subtree is marked dirty once
+	/// and the AnimatedModel rebuilds its skin matrices. Nothing is done while all bodies sleep.
+	class RagdollPose : public Component
+	{
+		URHO3D_OBJECT(RagdollPose, Component);
+
+	public:
+		/// Construct.
+		explicit RagdollPose(Context* context);
+		/// Destruct. Hands the bodies back to their RigidBody components.
+		~RagdollPose() override;
+
+		/// Take over the rigid bodies of the model's bones. Call once the ragdoll bodies and shapes are created.
+		void Attach();
+		/// Hand the bodies back to their RigidBody components, which set the node transforms again.
+		void Detach();
+		/// Write the latest body transforms into the bone nodes, if they moved since the last call.
+		void Apply();
+		/// Mark the pose changed. Called by the motion states.
+		void MarkChanged() { changed_ = true; }
+
+		/// Return number of posed bodies.
+		unsigned GetNumBodies() const { return states_.size(); }
+		/// Return motion state of a posed body, which holds its bone's world transform of the latest step.
+		const RagdollMotionState* GetMotionState(unsigned index) const { return states_[index].get(); }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle the scene update having finished.
+		void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+
+		/// Motion states of the bodies.
+		ea::vector<ea::unique_ptr<RagdollMotionState>> states_;
+		/// Motion state by bone index, null for bones not driven by a body.
+		ea::vector<RagdollMotionState*> boneStates_;
+		/// Indices of the bones driven by a body or with such a bone below them, parents first.
+		ea::vector<unsigned> poseBones_;
+		/// World transforms of the posed bones by bone index, scratch space for Apply.
+		ea::vector<Matrix3x4> worldTransforms_;
+		/// Bodies moved since the last Apply.
+		bool changed_ = false;
+	};
+}
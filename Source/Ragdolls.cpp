@@ -41,6 +41,7 @@
 #include <Urho3D/Physics/CollisionShape.h>
 #include <Urho3D/Physics/PhysicsWorld.h>
 #include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/Image.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/UI/Font.h>
@@ -61,6 +62,28 @@
 #include "Ragdolls.h"
 #include "Mover.h"
 #include "MDRemoveCom.h"
+#include "KillCamRecorder.h"
+#include "CrowdSteering.h"
+#include "ProjectileSweep.h"
+#include "PhysicsDebugView.h"
+#include "QualityGovernor.h"
+#include "ParallelLogic.h"
+#include "ParallelIslandSolver.h"
+#include "CompressedAnimation.h"
+#include "WorldStreamer.h"
+#include "PerformanceProfiles.h"
+#include "CrowdOcclusion.h"
+#include "CrowdSkinning.h"
+#include "ResourceBudgets.h"
+#include "ShooterBot.h"
+#include "ZombieVariants.h"
+#include "GameplayTasks.h"
+#include "SpatialQueries.h"
+#include "ChunkedTerrain.h"
+#include "RagdollPose.h"
+#if URHO3D_NETWORK
+#include "ReplicationClient.h"
+#endif
 
 #include <Urho3D/DebugNew.h>
 
@@ -68,12 +91,31 @@
 // Create animated models
 const float MODEL_MOVE_SPEED = 3.0f;
 const BoundingBox bounds(Vector3(-20.0f, 0.0f, -15.0f), Vector3(20.0f, 0.0f, 20.0f));
+// Seconds between the last zombie of a wave going down and the next wave
+const float WAVE_PAUSE = 3.0f;
+// Nearest distance along Z of a sector spawn point used for zombies, keeping them clear of the player
+const float SPAWN_POINT_MIN_Z = 10.0f;
+// Sideways spread of the zombies sharing a sector spawn point
+const float SPAWN_POINT_SPREAD = 1.5f;
+// Radius and impulse at the center of the explosion set off by a zombie walking out of the arena
+const float EXPLOSION_RADIUS = 5.0f;
+const float EXPLOSION_IMPULSE = 6.0f;
 
 using namespace MonsterDolls;
 
 Ragdolls::Ragdolls(Context* context)
 	: Sample(context)
 	, drawDebug_(false)
+{
+	RegisterComponents(context);
+}
+
+const BoundingBox& Ragdolls::GetArenaBounds()
+{
+	return bounds;
+}
+
+void Ragdolls::RegisterComponents(Context* context)
 {
 	// Register an object factory for our custom CreateRagdoll component so that we can create them to scene nodes
 	if (!context->IsReflected<CreateRagdoll>())
@@ -85,7 +127,55 @@ Ragdolls::Ragdolls(Context* context)
 		context->AddFactoryReflection<Mover3D>();
 
 	if (!context->IsReflected<MDRemoveCom>())
-		context->AddFactoryReflection<MDRemoveCom>();
+		MDRemoveCom::RegisterObject(context);
+
+	if (!context->IsReflected<KillCamRecorder>())
+		context->AddFactoryReflection<KillCamRecorder>();
+
+	if (!context->IsReflected<CrowdSteering>())
+		context->AddFactoryReflection<CrowdSteering>();
+
+	if (!context->IsReflected<ProjectileSweep>())
+		context->AddFactoryReflection<ProjectileSweep>();
+
+	if (!context->IsReflected<PhysicsDebugView>())
+		context->AddFactoryReflection<PhysicsDebugView>();
+
+	if (!context->IsReflected<QualityGovernor>())
+		context->AddFactoryReflection<QualityGovernor>();
+
+	if (!context->IsReflected<ParallelLogicPhase>())
+		context->AddFactoryReflection<ParallelLogicPhase>();
+
+	if (!context->IsReflected<ParallelIslandSolver>())
+		context->AddFactoryReflection<ParallelIslandSolver>();
+
+	if (!context->IsReflected<CompressedAnimation>())
+		CompressedAnimation::RegisterObject(context);
+
+	if (!context->IsReflected<WorldStreamer>())
+		context->AddFactoryReflection<WorldStreamer>();
+
+	if (!context->IsReflected<CrowdOcclusion>())
+		context->AddFactoryReflection<CrowdOcclusion>();
+
+	if (!context->IsReflected<CrowdSkinning>())
+		context->AddFactoryReflection<CrowdSkinning>();
+
+	if (!context->IsReflected<ShooterBot>())
+		context->AddFactoryReflection<ShooterBot>();
+
+	if (!context->IsReflected<GameplayScheduler>())
+		context->AddFactoryReflection<GameplayScheduler>();
+
+	if (!context->IsReflected<SpatialQueries>())
+		context->AddFactoryReflection<SpatialQueries>();
+
+	if (!context->IsReflected<ChunkedTerrain>())
+		context->AddFactoryReflection<ChunkedTerrain>();
+
+	if (!context->IsReflected<RagdollPose>())
+		context->AddFactoryReflection<RagdollPose>();
 }
 
 void Ragdolls::Start()
@@ -117,12 +207,20 @@ void Ragdolls::CreateScene()
 	scene_ = new Scene(context_);
 
 	// Create octree, use default volume (-1000, -1000, -1000) to (1000, 1000, 1000)
-	// Create a physics simulation world with default parameters, which will update at 60fps. Like the Octree must
+	// Create a physics simulation world updating at the rate of the performance profile. Like the Octree must
 	// exist before creating drawable components, the PhysicsWorld must exist before creating physics components.
 	// Finally, create a DebugRenderer component so that we can draw physics debug geometry
-	scene_->CreateComponent<Octree>();
-	scene_->CreateComponent<PhysicsWorld>();
+	const PerformanceProfile& profile = PerformanceProfiles::GetCurrent(context_);
+	auto* octree = scene_->CreateComponent<Octree>();
+	auto* physicsWorld = scene_->CreateComponent<PhysicsWorld>();
+	physicsWorld->SetFps(profile.physicsFps_);
+	physicsWorld->SetMaxSubSteps(profile.physicsSubSteps_);
 	scene_->CreateComponent<DebugRenderer>();
+	scene_->CreateComponent<PhysicsDebugView>();
+
+	// With --physics-threads <n> every ragdoll island is solved on its own worker, 0 uses all of them
+	if (profile.physicsThreads_ >= 0)
+		scene_->CreateComponent<ParallelIslandSolver>()->SetNumThreads(profile.physicsThreads_);
 
 	// Create a Zone component for ambient lighting & fog control
 	Node* zoneNode = scene_->CreateChild("Zone");
@@ -152,26 +250,6 @@ void Ragdolls::CreateScene()
 	skybox->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
 	skybox->SetMaterial(cache->GetResource<Material>("Materials/Skybox.xml"));
 
-	{
-		// Create a floor object, 500 x 500 world units. Adjust position so that the ground is at zero Y
-		Node* floorNode = scene_->CreateChild("Floor");
-		floorNode->SetPosition(Vector3(0.0f, -0.5f, 0.0f));
-		floorNode->SetScale(Vector3(500.0f, 1.0f, 500.0f));
-		auto* floorObject = floorNode->CreateComponent<StaticModel>();
-		floorObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		floorObject->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
-
-		// Make the floor physical by adding RigidBody and CollisionShape components
-		auto* body = floorNode->CreateComponent<RigidBody>();
-		// We will be spawning spherical objects in this sample. The ground also needs non-zero rolling friction so that
-		// the spheres will eventually come to rest
-		body->SetRollingFriction(0.15f);
-		auto* shape = floorNode->CreateComponent<CollisionShape>();
-		// Set a box shape of size 1 x 1 x 1 for collision. The shape will be scaled with the scene node scale, so the
-		// rendering and physics representation sizes should match (the box model is also 1 x 1 x 1.)
-		shape->SetBox(Vector3::ONE);
-	}
-
 	// Create the camera. Limit far clip distance to match the fog. Note: now we actually create the camera node outside
 	// the scene, because we want it to be unaffected by scene load / save
 	// 
@@ -192,7 +270,118 @@ void Ragdolls::CreateScene()
 	// Set an initial position for the camera scene node above the floor
 	cameraNode_->SetPosition(Vector3(0.0f, 2.0f, -20.0f));
 
-	CreateModels();
+	// With --world-sectors <n> the floor is a grid of n x n sectors of --sector-size units streamed around the
+	// camera within --sector-budget MB. Otherwise the ground is a terrain of --terrain <n> x n chunks, with collision
+	// only under moving bodies, or a single 500 x 500 box with --terrain 0. Replicated zombies walk the flat floor
+	// of the server
+	const unsigned numSectors = ToUInt(GetArgumentValue("--world-sectors", "0"));
+	const unsigned numTerrainChunks =
+		GetArgumentValue("--connect").empty() ? ToUInt(GetArgumentValue("--terrain", "8")) : 0;
+	if (numSectors)
+	{
+		auto* streamer = scene_->CreateComponent<WorldStreamer>();
+		streamer->SetGrid(numSectors, ToFloat(GetArgumentValue("--sector-size", "50")));
+		streamer->SetPinnedRegion(GetArenaBounds());
+		streamer->SetMemoryBudget((unsigned)(ToFloat(GetArgumentValue("--sector-budget", "2")) * 1024 * 1024));
+		streamer->SetFocus(cameraNode_);
+
+		// Large worlds grow past the default octree and zone volumes
+		BoundingBox worldBounds(-1000.0f, 1000.0f);
+		worldBounds.Merge(streamer->GetWorldBounds());
+		octree->SetSize(worldBounds, 8);
+		zone->SetBoundingBox(worldBounds);
+	}
+	else if (numTerrainChunks)
+	{
+		const ea::string heightMapName = GetArgumentValue("--terrain-heightmap");
+		auto* terrain = scene_->CreateChild("Terrain")->CreateComponent<ChunkedTerrain>();
+		terrain->Create(numTerrainChunks, ToUInt(GetArgumentValue("--terrain-chunk", "32")),
+			ToFloat(GetArgumentValue("--terrain-cell", "2")), ToFloat(GetArgumentValue("--terrain-height", "3")),
+			heightMapName.empty() ? nullptr : cache->GetResource<Image>(heightMapName));
+
+		BoundingBox worldBounds(-1000.0f, 1000.0f);
+		worldBounds.Merge(terrain->GetBounds());
+		octree->SetSize(worldBounds, 8);
+		zone->SetBoundingBox(worldBounds);
+
+		const Vector3 cameraPosition = cameraNode_->GetPosition();
+		cameraNode_->SetPosition(cameraPosition + Vector3(0.0f, terrain->GetHeight(cameraPosition), 0.0f));
+	}
+	else
+		CreateFloor(scene_);
+
+#if URHO3D_NETWORK
+	// With --connect <address> [--port <port>] zombies and projectiles come from an authoritative server
+	const ea::string serverAddress = GetArgumentValue("--connect");
+	if (!serverAddress.empty())
+	{
+		auto* client = scene_->CreateComponent<ReplicationClient>();
+		client->SetViewNode(cameraNode_);
+		client->Connect(serverAddress, (unsigned short)ToUInt(GetArgumentValue("--port", "2345")));
+		replicationClient_ = client;
+	}
+	else
+#endif
+	{
+		// Walkers update on the worker threads at the logic rate of the profile
+		auto* logicPhase = scene_->CreateComponent<ParallelLogicPhase>();
+		logicPhase->SetTickRate((unsigned)Max(profile.logicFps_, 0));
+
+		// Explosions and the crowd's line of sight are resolved as one batch of physics queries per frame
+		scene_->CreateComponent<SpatialQueries>();
+
+		// Walkers avoid each other and close in on the player once they see the camera
+		auto* steering = scene_->CreateComponent<CrowdSteering>();
+		steering->SetTarget(cameraNode_);
+
+		// Ch36 has a Mixamo rig, its attack clip, cooked if available, gets retargeted onto the Jack skeleton once here
+		variants_ = MakeShared<ZombieVariants>(context_);
+		variants_->SetBaseModel(cache->GetResource<Model>("Models/Jack.mdl"));
+		variants_->AddMixamoToBipedMapping();
+		attackVariant_ = variants_->AddVariant(cache->GetResource<Model>("Models/MeleeAttack.fbx.d/Models/Ch36.mdl"),
+			CompressedAnimation::LoadClip(cache, "Models/MeleeAttack.fbx.d/Animations/mixamo.com.ani"));
+
+		// Waves and the crowd's reaction to arrivals are scripts, the first wave is created right away
+		auto* scheduler = GameplayScheduler::Get(scene_);
+		scheduler->Start(RunWaves(scheduler));
+		scheduler->Start(RunKicking(scheduler));
+
+		// Walkers hidden behind occluders stop animating
+		if (profile.occlusion_)
+		{
+			auto* occlusion = scene_->CreateComponent<CrowdOcclusion>();
+			occlusion->SetCamera(camera);
+			occlusion->SetTargets(zombiesNode_);
+		}
+
+		// Bone matrices of the zombies in view are resolved on the worker threads before rendering
+		auto* skinning = scene_->CreateComponent<CrowdSkinning>();
+		skinning->SetCamera(camera);
+		skinning->SetTargets(zombiesNode_);
+		skinning->SetParallel(profile.parallelSkinning_);
+
+		// Keep the last seconds of the local simulation for the kill-cam
+		killCamRecorder_ = scene_->CreateComponent<KillCamRecorder>();
+
+		// With --bot random|sweep|clumps a synthetic player aims the camera and pulls the trigger
+		ShooterBotProfile botProfile;
+		if (ShooterBotProfile::FromArguments(botProfile))
+		{
+			shooterBot_ = cameraNode_->CreateComponent<ShooterBot>();
+			shooterBot_->SetProfile(botProfile);
+			shooterBot_->SetTargets(zombiesNode_);
+			cameraNode_->GetComponent<FreeFlyController>()->SetEnabled(false);
+		}
+	}
+
+	// Trade shadows, animation and physics detail for a steady frame rate, --frame-budget <ms> sets the target,
+	// 0 keeps the quality fixed
+	if (profile.frameBudget_ > 0.0f)
+	{
+		auto* governor = scene_->CreateComponent<QualityGovernor>();
+		governor->SetFrameBudget(profile.frameBudget_ * 0.001f);
+		governor->SetTargets(lightNode, zombiesNode_);
+	}
 
 	gunNode_ = cameraNode_->CreateChild("Gun Node");
 	gunNode_->SetPosition(Vector3(0.0f, -0.2f, 0.5f));
@@ -215,25 +404,77 @@ void Ragdolls::CreateScene()
 	shapeNode_->SetScale(Vector3(0.05f, 50.0f, 0.05f));
 }
 
-void Ragdolls::CreateModels()
+void Ragdolls::CreateFloor(Scene* scene)
 {
-	auto* cache = GetSubsystem<ResourceCache>();
+	auto* cache = scene->GetSubsystem<ResourceCache>();
+
+	// Create a floor object, 500 x 500 world units. Adjust position so that the ground is at zero Y
+	Node* floorNode = scene->CreateChild("Floor");
+	floorNode->SetPosition(Vector3(0.0f, -0.5f, 0.0f));
+	floorNode->SetScale(Vector3(500.0f, 1.0f, 500.0f));
+	auto* floorObject = floorNode->CreateComponent<StaticModel>();
+	floorObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+	floorObject->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
+
+	// Make the floor physical by adding RigidBody and CollisionShape components
+	auto* body = floorNode->CreateComponent<RigidBody>();
+	// We will be spawning spherical objects in this sample. The ground also needs non-zero rolling friction so that
+	// the spheres will eventually come to rest
+	body->SetRollingFriction(0.15f);
+	auto* shape = floorNode->CreateComponent<CollisionShape>();
+	// Set a box shape of size 1 x 1 x 1 for collision. The shape will be scaled with the scene node scale, so the
+	// rendering and physics representation sizes should match (the box model is also 1 x 1 x 1.)
+	shape->SetBox(Vector3::ONE);
+}
 
+void Ragdolls::CreateModels()
+{
 	if (!zombiesNode_)
 		zombiesNode_ = scene_->CreateChild("Zombie");
 	else
 		zombiesNode_->RemoveAllChildren();
 
-	for (int x = -5, i = 0; x <= 5; ++x, i++)
+	CreateZombies(zombiesNode_, PerformanceProfiles::GetCurrent(context_).numZombies_, this);
+}
+
+void Ragdolls::CreateZombies(Node* zombiesNode, int count, Ragdolls* ragdolls)
+{
+	auto* cache = zombiesNode->GetSubsystem<ResourceCache>();
+	auto* terrain = zombiesNode->GetScene()->GetComponent<ChunkedTerrain>(true);
+
+	// With a streamed world the zombies start at the spawn points of the resident sectors that lie in the far part
+	// of the arena, and in a line across it when there are none
+	ea::vector<Vector3> spawnPoints;
+	if (auto* streamer = zombiesNode->GetScene()->GetComponent<WorldStreamer>())
+	{
+		ea::vector<Vector3> sectorPoints;
+		streamer->GetSpawnPoints(sectorPoints);
+		for (const Vector3& point : sectorPoints)
+		{
+			if (point.x_ > bounds.min_.x_ && point.x_ < bounds.max_.x_ && point.z_ >= SPAWN_POINT_MIN_Z &&
+				point.z_ < bounds.max_.z_)
+				spawnPoints.push_back(point);
+		}
+	}
+
+	for (int i = 0, x = -count / 2; i < count; ++x, i++)
 	{
 		std::string name = "Zombie_" + std::to_string(i);
-		Node* modelNode = zombiesNode_->CreateChild(name.c_str());
+		Node* modelNode = zombiesNode->CreateChild(name.c_str());
 
 		float X = x * 4.0f;
 		float Y = 14 + Random(5.9f);
+		float height = terrain ? terrain->GetHeight(Vector3(X, 0.0f, Y)) : 0.0f;
+		if (!spawnPoints.empty())
+		{
+			const Vector3& point = spawnPoints[i % spawnPoints.size()];
+			X = Clamp(point.x_ + Random(-SPAWN_POINT_SPREAD, SPAWN_POINT_SPREAD), bounds.min_.x_, bounds.max_.x_);
+			Y = point.z_;
+			height = point.y_;
+		}
 		float phi = std::atan(X / Y);
 
-		modelNode->SetPosition(Vector3(X, 0.0f, Y));
+		modelNode->SetPosition(Vector3(X, height, Y));
 		modelNode->SetRotation(Quaternion(0.0f, 180.0f * (1.0f + 0.4f * phi / float(M_PI)), 0.0f));
 
 		auto* modelObject = modelNode->CreateComponent<AnimatedModel>();
@@ -251,6 +492,8 @@ void Ragdolls::CreateModels()
 		// The Trigger mode makes the rigid body only detect collisions, but impart no forces on the
 		// colliding objects
 		body->SetTrigger(true);
+		// Projectile sweeps only look for zombies
+		body->SetCollisionLayer(ZOMBIE_TRIGGER_LAYER);
 		auto* shape = modelNode->CreateComponent<CollisionShape>();
 		// Create the capsule shape with an offset so that it is correctly aligned with the model, which
 		// has its origin at the feet
@@ -259,7 +502,7 @@ void Ragdolls::CreateModels()
 		// Create an AnimationState for a walk animation. Its time position will need to be manually updated to advance the
 		// animation, The alternative would be to use an AnimationController component which updates the animation automatically,
 		// but we need to update the model's position manually in any case
-		auto* animation_running = cache->GetResource<Animation>("Models/Jack_Walk.ani");
+		auto* animation_running = CompressedAnimation::LoadClip(cache, "Models/Jack_Walk.ani");
 		//Animation* animation_running = cache->GetResource<Animation>("Models/Zombie Running.fbx.d/Animations/mixamo.com.ani");
 		const float startTime = Random(animation_running->GetLength());
 		auto animationController = modelNode->CreateComponent<AnimationController>();
@@ -268,11 +511,11 @@ void Ragdolls::CreateModels()
 		// Create our custom Mover3D component that will move & animate the model during each frame's update
 		auto* mover = modelNode->CreateComponent<Mover3D>();
 		Vector3 v{ MODEL_MOVE_SPEED * tan(phi) * 0.1f, 0, MODEL_MOVE_SPEED };
-		mover->SetParameters(v, bounds, this);
+		mover->SetParameters(v, bounds);
 
 		// Create a custom component that reacts to collisions and creates the ragdoll
 		auto* crd = modelNode->CreateComponent<CreateRagdoll>();
-		crd->SetRagdolls(this);
+		crd->SetRagdolls(ragdolls);
 	}
 }
 
@@ -299,6 +542,16 @@ void Ragdolls::CreateInstructions()
 	instructionText->SetVerticalAlignment(VA_CENTER);
 	instructionText->SetPosition(0, GetUIRoot()->GetHeight() / 4);
 	*/
+
+	// Current quality level of the governor in the top left corner
+	qualityText_ = GetUIRoot()->CreateChild<Text>();
+	qualityText_->SetFont(cache->GetResource<Font>("Fonts/Anonymous Pro.ttf"), 12);
+	qualityText_->SetPosition(10, 10);
+
+	// Resource memory against the budgets below it
+	resourceText_ = GetUIRoot()->CreateChild<Text>();
+	resourceText_->SetFont(cache->GetResource<Font>("Fonts/Anonymous Pro.ttf"), 12);
+	resourceText_->SetPosition(10, 28);
 }
 
 void Ragdolls::SetupViewport()
@@ -318,9 +571,11 @@ void Ragdolls::MoveCamera(float timeStep)
 
 	auto* input = GetSubsystem<Input>();
 
-	// "Shoot" a physics object with left mousebutton
+	// "Shoot" a physics object with left mousebutton, or whenever the bot pulls the trigger
 	if (input->GetMouseButtonPress(MOUSEB_LEFT))
 		SpawnObject();
+	while (shooterBot_ && shooterBot_->TakeShot())
+		SpawnObject();
 
 	// Check for loading / saving the scene
 	if (input->GetKeyPress(KEY_F5))
@@ -337,15 +592,46 @@ void Ragdolls::MoveCamera(float timeStep)
 	// Toggle physics debug geometry with space
 	if (input->GetKeyPress(KEY_SPACE))
 		drawDebug_ = !drawDebug_;
+
+	// Cycle the drawn physics debug categories with tab
+	if (drawDebug_ && input->GetKeyPress(KEY_TAB))
+	{
+		static const unsigned filters[] = { DEBUG_ALL & ~DEBUG_STATIC, DEBUG_RAGDOLLS | DEBUG_CONSTRAINTS,
+			DEBUG_TRIGGERS, DEBUG_PROJECTILES, DEBUG_ALL };
+		static const unsigned numFilters = sizeof(filters) / sizeof(filters[0]);
+		auto* debugView = scene_->GetComponent<PhysicsDebugView>();
+		unsigned index = 0;
+		while (index < numFilters && filters[index] != debugView->GetCategories())
+			++index;
+		debugView->SetCategories(filters[(index + 1) % numFilters]);
+	}
+
+	// Replay the latest ragdoll with R
+	if (input->GetKeyPress(KEY_R))
+		StartKillCam();
 }
 
 void Ragdolls::SpawnObject()
 {
-	auto* cache = GetSubsystem<ResourceCache>();
+#if URHO3D_NETWORK
+	if (replicationClient_)
+		replicationClient_->RequestFire(cameraNode_->GetPosition(), cameraNode_->GetRotation());
+	else
+#endif
+	SpawnProjectile(scene_, cameraNode_->GetPosition(), cameraNode_->GetRotation());
+
+	PlaySoundEffect("SmallExplosion.wav");
+
+	shakeComponent_->AddTrauma(1.0f);
+}
 
-	Node* boxNode = scene_->CreateChild("Sphere");
-	boxNode->SetPosition(cameraNode_->GetPosition());
-	boxNode->SetRotation(cameraNode_->GetRotation());
+Node* Ragdolls::SpawnProjectile(Scene* scene, const Vector3& position, const Quaternion& rotation)
+{
+	auto* cache = scene->GetSubsystem<ResourceCache>();
+
+	Node* boxNode = scene->CreateChild("Sphere");
+	boxNode->SetPosition(position);
+	boxNode->SetRotation(rotation);
 	boxNode->SetScale(0.25f);
 	auto* boxObject = boxNode->CreateComponent<StaticModel>();
 	boxObject->SetModel(cache->GetResource<Model>("Models/Sphere.mdl"));
@@ -358,15 +644,24 @@ void Ragdolls::SpawnObject()
 	auto* shape = boxNode->CreateComponent<CollisionShape>();
 	shape->SetSphere(1.0f);
 
+	// The sphere moves more than its size every step. Bullet's CCD keeps it from tunneling through solid bodies,
+	// the sweep does the same against the zombie triggers that Bullet's CCD ignores
+	const float radius = 0.5f * boxNode->GetScale().x_;
+	body->SetCcdRadius(radius);
+	body->SetCcdMotionThreshold(radius);
+	auto* sweep = boxNode->CreateComponent<ProjectileSweep>();
+	sweep->SetRadius(radius);
+
+	if (auto* governor = scene->GetComponent<QualityGovernor>())
+		governor->EnforceProjectileCap();
+
 	const float OBJECT_VELOCITY = 20.0f;
 
 	// Set initial velocity for the RigidBody based on camera forward vector. Add also a slight up component
 	// to overcome gravity better
-	body->SetLinearVelocity(cameraNode_->GetRotation() * Vector3(0.0f, 0.0f, 7.0f) * OBJECT_VELOCITY);
+	body->SetLinearVelocity(rotation * Vector3(0.0f, 0.0f, 7.0f) * OBJECT_VELOCITY);
 
-	PlaySoundEffect("SmallExplosion.wav");
-
-	shakeComponent_->AddTrauma(1.0f);
+	return boxNode;
 }
 
 void Ragdolls::SubscribeToEvents()
@@ -374,32 +669,127 @@ void Ragdolls::SubscribeToEvents()
 	// Subscribe HandlePostRenderUpdate() function for processing the post-render update event, during which we request
 	// debug geometry
 	SubscribeToEvent(E_POSTRENDERUPDATE, URHO3D_HANDLER(Ragdolls, HandlePostRenderUpdate));
+	SubscribeToEvent(E_RAGDOLLACTIVATED, URHO3D_HANDLER(Ragdolls, HandleRagdollActivated));
 }
 
 void Ragdolls::Update(float timeStep)
 {
+	UpdateQualityText();
+	UpdateResourceText();
+
+	if (killCamNode_)
+	{
+		UpdateKillCam(timeStep);
+		return;
+	}
+
 	// Move the camera, scale movement with time step
 	MoveCamera(timeStep);
 }
 
+void Ragdolls::UpdateQualityText()
+{
+	auto* governor = scene_->GetComponent<QualityGovernor>();
+	if (!governor || !qualityText_)
+		return;
+
+	qualityText_->SetText(Format("Quality {} ({:.1f} / {:.1f} ms)", governor->GetQuality().name_,
+		governor->GetAverageFrameTime() * 1000.0f, governor->GetFrameBudget() * 1000.0f));
+}
+
+void Ragdolls::UpdateResourceText()
+{
+	auto* budgets = GetSubsystem<ResourceBudgets>();
+	if (!budgets || !resourceText_)
+		return;
+
+	resourceText_->SetText("Resources " + budgets->GetUsageText());
+}
+
+void Ragdolls::HandleRagdollActivated(StringHash eventType, VariantMap& eventData)
+{
+	using namespace RagdollActivated;
+
+	auto* node = static_cast<Node*>(eventData[P_NODE].GetPtr());
+	if (node && node->GetScene() == scene_)
+		lastRagdoll_ = node;
+}
+
+void Ragdolls::StartKillCam()
+{
+	if (!killCamRecorder_ || !lastRagdoll_ || !killCamRecorder_->StartPlayback(3.0f))
+		return;
+
+	killCamNode_ = new Node(context_);
+	auto* camera = killCamNode_->CreateComponent<Camera>();
+	camera->SetFarClip(300.0f);
+	killCamYaw_ = cameraNode_->GetRotation().YawAngle() + 90.0f;
+
+	GetViewport(0)->SetCamera(camera);
+	UpdateKillCam(0.0f);
+}
+
+void Ragdolls::UpdateKillCam(float timeStep)
+{
+	if (!killCamRecorder_->IsPlaying() || !lastRagdoll_)
+	{
+		killCamRecorder_->StopPlayback();
+		GetViewport(0)->SetCamera(cameraNode_->GetComponent<Camera>());
+		killCamNode_.Reset();
+		return;
+	}
+
+	// Slowly orbit the ragdoll from the side
+	killCamYaw_ += 20.0f * timeStep;
+	Node* pelvis = lastRagdoll_->GetChild("Bip01_Pelvis", true);
+	const Vector3 target = pelvis ? pelvis->GetWorldPosition() : lastRagdoll_->GetWorldPosition() + Vector3(0.0f, 1.0f, 0.0f);
+	killCamNode_->SetPosition(target + Quaternion(killCamYaw_, Vector3::UP) * Vector3(0.0f, 1.5f, -6.0f));
+	killCamNode_->LookAt(target);
+}
+
 void Ragdolls::HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData)
 {
-	// If draw debug mode is enabled, draw physics debug geometry. Use depth test to make the result easier to interpret
+	// If draw debug mode is enabled, draw physics debug geometry near the camera. Use depth test to make the result
+	// easier to interpret
 	if (drawDebug_)
-		scene_->GetComponent<PhysicsWorld>()->DrawDebugGeometry(true);
+	{
+		scene_->GetComponent<PhysicsDebugView>()->Draw(cameraNode_->GetComponent<Camera>(),
+			scene_->GetComponent<DebugRenderer>(), true);
+	}
 }
 
 void Ragdolls::CreateKicking()
 {
-	for (auto ptr : zombiesNode_->GetChildren()) {
-		auto* cache = GetSubsystem<ResourceCache>();
-		Model* model_running = cache->GetResource<Model>("Models/MeleeAttack.fbx.d/Models/Ch36.mdl");
-		Animation* animation_running = cache->GetResource<Animation>("Models/MeleeAttack.fbx.d/Animations/mixamo.com.ani");
+	// The attack variant was prepared at scene creation, switching is only a new animation per zombie
+	for (auto ptr : zombiesNode_->GetChildren())
+		variants_->Apply(ptr, attackVariant_);
+}
 
-		auto* modelObject = ptr->GetComponent<AnimatedModel>();
-		modelObject->SetModel(model_running);
+GameplayTask Ragdolls::RunWaves(GameplayScheduler* scheduler)
+{
+	for (unsigned wave = 1; ; ++wave)
+	{
+		URHO3D_LOGINFO("Wave {}", wave);
+		CreateModels();
 
-		auto animationController = ptr->GetComponent<AnimationController>();
-		animationController->PlayNewExclusive(AnimationParameters{ animation_running }.Looped().Time(0));
+		co_await scheduler->AllZombiesDead(zombiesNode_);
+		co_await scheduler->Delay(WAVE_PAUSE);
+	}
+}
+
+GameplayTask Ragdolls::RunKicking(GameplayScheduler* scheduler)
+{
+	// Every zombie walking out of the arena sets off the explosion and turns the crowd to the attack
+	for (;;)
+	{
+		VariantMap eventData = co_await scheduler->WaitEvent(E_ZOMBIEARRIVED);
+		PlaySoundEffect("BigExplosion.wav");
+
+		// The blast pushes ragdolls and projectiles around and hits the zombies near the arrival
+		auto* node = static_cast<Node*>(eventData[ZombieArrived::P_NODE].GetPtr());
+		auto* queries = scene_->GetComponent<SpatialQueries>();
+		if (node && queries)
+			queries->Explode(node->GetWorldPosition(), EXPLOSION_RADIUS, EXPLOSION_IMPULSE);
+		CreateKicking();
 	}
 }
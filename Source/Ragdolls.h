@@ -24,6 +24,7 @@
 
 #include <Urho3D/Scene/ShakeComponent.h>
 
+#include "GameplayTasks.h"
 #include "Sample.h"
 
 #include <list>
@@ -33,11 +34,17 @@ namespace Urho3D
 
 	class Node;
 	class Scene;
+	class Text;
 
 }
 
 namespace MonsterDolls
 {
+	class KillCamRecorder;
+	class ZombieVariants;
+	class ReplicationClient;
+	class ShooterBot;
+
 	/// Ragdoll example.
 	/// This sample demonstrates:
 	///     - Detecting physics collisions
@@ -95,12 +102,37 @@ namespace MonsterDolls
 		void Update(float timeStep) override;
 		/// Handle the post-render update event.
 		void HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData);
+		/// Handle a zombie turning into a ragdoll.
+		void HandleRagdollActivated(StringHash eventType, VariantMap& eventData);
+		/// Replay the last seconds around the latest ragdoll from a side camera.
+		void StartKillCam();
+		/// Move the kill-cam camera, switch back to the player camera when the replay is over.
+		void UpdateKillCam(float timeStep);
+		/// Show the quality governor level in the HUD.
+		void UpdateQualityText();
+		/// Show memory of the budgeted resource categories in the HUD.
+		void UpdateResourceText();
+		/// Script spawning a wave, waiting until it is dead and pausing before the next one.
+		GameplayTask RunWaves(GameplayScheduler* scheduler);
+		/// Script switching the crowd to the attack whenever a zombie walks out of the arena.
+		GameplayTask RunKicking(GameplayScheduler* scheduler);
 
 	public:
 		/// Create animated models
 		void CreateModels();
 		/// Create kicking models
 		void CreateKicking();
+
+		/// Return the region zombies walk in.
+		static const BoundingBox& GetArenaBounds();
+		/// Register the gameplay component factories.
+		static void RegisterComponents(Context* context);
+		/// Create the physical floor into a scene.
+		static void CreateFloor(Scene* scene);
+		/// Create a row of walking zombies under the parent node. Ragdolls may be null for headless scenes.
+		static void CreateZombies(Node* zombiesNode, int count, Ragdolls* ragdolls);
+		/// Launch a physics sphere from the given position along the rotation's forward vector.
+		static Node* SpawnProjectile(Scene* scene, const Vector3& position, const Quaternion& rotation);
 	private:
 		/// Flag for drawing debug geometry.
 		bool drawDebug_;
@@ -109,5 +141,25 @@ namespace MonsterDolls
 		Node* shapeNode_ = 0;
 		ShakeComponent* shakeComponent_ = 0;
 		Node* zombiesNode_ = 0;
+		/// Prepared mesh and animation variants of the zombies.
+		SharedPtr<ZombieVariants> variants_;
+		/// Variant used by zombies attacking the player.
+		unsigned attackVariant_ = 0;
+		/// Recorder of the last seconds for the kill-cam.
+		KillCamRecorder* killCamRecorder_ = 0;
+		/// Kill-cam camera node, exists only during a replay.
+		SharedPtr<Node> killCamNode_;
+		/// Synthetic player driving the camera and the trigger, exists only with --bot.
+		ShooterBot* shooterBot_ = 0;
+		/// HUD text of the quality level.
+		Text* qualityText_ = 0;
+		/// HUD text of the resource memory.
+		Text* resourceText_ = 0;
+		/// Latest zombie turned into a ragdoll.
+		WeakPtr<Node> lastRagdoll_;
+		/// Kill-cam orbit angle.
+		float killCamYaw_ = 0.0f;
+		/// Replication client when connected to a server, null for a local simulation.
+		ReplicationClient* replicationClient_ = 0;
 	};
 }
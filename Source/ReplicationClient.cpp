@@ -0,0 +1,263 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#if URHO3D_NETWORK
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "ReplicationClient.h"
+#include "CompressedAnimation.h"
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+ReplicationClient::ReplicationClient(Context* context) :
+	Component(context)
+{
+}
+
+bool ReplicationClient::Connect(const ea::string& address, unsigned short port)
+{
+	// Connect without a scene, the engine's own scene replication would clear the client scene
+	auto* network = GetSubsystem<Network>();
+	if (!network->Connect(address, port, nullptr))
+	{
+		URHO3D_LOGERROR("Could not connect to replication server {}:{}", address, port);
+		return false;
+	}
+
+	SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(ReplicationClient, HandleNetworkMessage));
+	return true;
+}
+
+void ReplicationClient::RequestFire(const Vector3& position, const Quaternion& rotation)
+{
+	Connection* connection = GetSubsystem<Network>()->GetServerConnection();
+	if (!connection)
+		return;
+
+	VectorBuffer message;
+	message.WriteVector3(position);
+	message.WriteQuaternion(rotation);
+	connection->SendMessage(MSG_RAGDOLL_FIRE, true, true, message);
+}
+
+void ReplicationClient::HandleNetworkMessage(StringHash eventType, VariantMap& eventData)
+{
+	using namespace NetworkMessage;
+
+	if (eventData[P_MESSAGEID].GetInt() == MSG_RAGDOLL_SNAPSHOT)
+		ReceiveSnapshot(eventData[P_DATA].GetBuffer());
+}
+
+void ReplicationClient::ReceiveSnapshot(const ea::vector<unsigned char>& data)
+{
+	MemoryBuffer message(data);
+	const unsigned sequence = message.ReadUInt();
+	const unsigned baselineSequence = message.ReadUInt();
+
+	static const ReplicatedSnapshot emptySnapshot;
+	const ReplicatedSnapshot* baseline = &emptySnapshot;
+	if (baselineSequence)
+	{
+		baseline = &history_[baselineSequence % REPLICATION_HISTORY];
+		// The baseline fell out of the history, wait for a snapshot against a newer ack
+		if (baseline->sequence_ != baselineSequence)
+			return;
+	}
+
+	ReplicatedSnapshot& snapshot = history_[sequence % REPLICATION_HISTORY];
+	if (&snapshot == baseline)
+		return;
+
+	// Start from the baseline, then overwrite what changed and drop what was removed
+	snapshot.sequence_ = sequence;
+	snapshot.states_ = baseline->states_;
+
+	ea::vector<ReplicatedState> changed;
+	const unsigned numChanged = message.ReadVLE();
+	for (unsigned i = 0; i < numChanged && !message.IsEof(); ++i)
+		changed.push_back(ReadReplicatedState(message, *baseline));
+
+	ea::vector<unsigned> removed;
+	const unsigned numRemoved = message.ReadVLE();
+	for (unsigned i = 0; i < numRemoved && !message.IsEof(); ++i)
+		removed.push_back(message.ReadVLE());
+
+	for (const ReplicatedState& state : changed)
+	{
+		if (ReplicatedState* existing = snapshot.Find(state.id_))
+			*existing = state;
+		else
+			snapshot.states_.push_back(state);
+	}
+	snapshot.Sort();
+
+	ea::sort(removed.begin(), removed.end());
+	snapshot.states_.erase(ea::remove_if(snapshot.states_.begin(), snapshot.states_.end(),
+		[&removed](const ReplicatedState& state) { return ea::binary_search(removed.begin(), removed.end(), state.id_); }),
+		snapshot.states_.end());
+
+	// Acknowledge every decodable snapshot, the server only moves its baseline forward
+	if (Connection* connection = GetSubsystem<Network>()->GetServerConnection())
+	{
+		VectorBuffer ack;
+		ack.WriteUInt(sequence);
+		ack.WriteVector3(viewNode_ ? viewNode_->GetWorldPosition() : Vector3::ZERO);
+		connection->SendMessage(MSG_RAGDOLL_ACK, false, false, ack);
+	}
+
+	// Late snapshots only serve as baselines
+	if (sequence <= lastApplied_)
+		return;
+	lastApplied_ = sequence;
+
+	// Compare with what the proxies show rather than with the baseline: entities of unacknowledged snapshots may
+	// have come and gone since it, and an entity back at its baseline state may still show a later one
+	for (const ReplicatedState& state : shown_.states_)
+	{
+		if (!snapshot.Find(state.id_))
+			RemoveProxy(state.id_);
+	}
+	for (const ReplicatedState& state : snapshot.states_)
+	{
+		const ReplicatedState* current = shown_.Find(state.id_);
+		if (!current || !current->SamePosition(state) || current->rotation_ != state.rotation_)
+			ApplyState(state);
+	}
+	shown_ = snapshot;
+
+	// Retry ragdoll bones that arrived before their zombie
+	ea::vector<unsigned> pendingBones;
+	pendingBones.swap(pendingBones_);
+	for (unsigned id : pendingBones)
+	{
+		if (const ReplicatedState* state = snapshot.Find(id))
+			ApplyState(*state);
+	}
+}
+
+void ReplicationClient::ApplyState(const ReplicatedState& state)
+{
+	Node* node = nullptr;
+	if (state.kind_ == REPLICATED_BONE)
+	{
+		node = FindBone(state);
+		if (!node)
+		{
+			pendingBones_.push_back(state.id_);
+			return;
+		}
+	}
+	else
+	{
+		auto it = proxies_.find(state.id_);
+		node = it != proxies_.end() ? it->second.Get() : nullptr;
+		if (!node)
+			node = CreateProxy(state);
+	}
+
+	node->SetWorldPosition(DequantizePosition(state.position_, REPLICATION_BOX));
+	node->SetWorldRotation(DequantizeRotation(state.rotation_));
+}
+
+void ReplicationClient::RemoveProxy(unsigned id)
+{
+	auto it = proxies_.find(id);
+	if (it == proxies_.end())
+		return;
+
+	if (it->second)
+		it->second->Remove();
+	proxies_.erase(it);
+}
+
+Node* ReplicationClient::CreateProxy(const ReplicatedState& state)
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+
+	if (!proxiesNode_)
+		proxiesNode_ = GetScene()->CreateChild("Replicated", LOCAL);
+
+	Node* node = proxiesNode_->CreateChild(state.kind_ == REPLICATED_ZOMBIE ? "Zombie" : "Sphere", LOCAL);
+	proxies_[state.id_] = node;
+
+	if (state.kind_ == REPLICATED_ZOMBIE)
+	{
+		auto* modelObject = node->CreateComponent<AnimatedModel>();
+		modelObject->SetModel(cache->GetResource<Model>("Models/Jack.mdl"));
+		modelObject->SetCastShadows(true);
+		modelObject->SetUpdateInvisible(true);
+
+		// Walking is animated locally, only the root transform comes from the server
+		auto* animation = CompressedAnimation::LoadClip(cache, "Models/Jack_Walk.ani");
+		auto* animationController = node->CreateComponent<AnimationController>();
+		animationController->PlayNewExclusive(AnimationParameters{ animation }.Looped().Time(Random(animation->GetLength())));
+	}
+	else
+	{
+		node->SetScale(0.25f);
+		auto* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("Models/Sphere.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("Materials/StoneSmall.xml"));
+		object->SetCastShadows(true);
+	}
+
+	return node;
+}
+
+Node* ReplicationClient::FindBone(const ReplicatedState& state)
+{
+	auto it = proxies_.find(state.owner_);
+	Node* zombie = it != proxies_.end() ? it->second.Get() : nullptr;
+	if (!zombie)
+		return nullptr;
+
+	// The first bone of a ragdoll stops the local animation of the whole skeleton
+	if (auto* animationController = zombie->GetComponent<AnimationController>())
+	{
+		animationController->StopAll();
+		Skeleton& skeleton = zombie->GetComponent<AnimatedModel>()->GetSkeleton();
+		for (unsigned i = 0; i < skeleton.GetNumBones(); ++i)
+			skeleton.GetBone(i)->animated_ = false;
+		animationController->Remove();
+	}
+
+	return zombie->GetChild(state.bone_, true);
+}
+
+#endif
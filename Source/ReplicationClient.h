@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+#include "ReplicationProtocol.h"
+
+#include <EASTL/unordered_map.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Thin client side of the ragdoll replication. Rebuilds server snapshots from their delta baselines,
+	/// acknowledges them and poses local proxy nodes: animated zombies, ragdoll bones and projectiles.
+	class ReplicationClient : public Component
+	{
+		URHO3D_OBJECT(ReplicationClient, Component);
+
+	public:
+		/// Construct.
+		explicit ReplicationClient(Context* context);
+
+		/// Connect to a replication server. Return true if the connection attempt started.
+		bool Connect(const ea::string& address, unsigned short port);
+		/// Ask the server to fire a projectile.
+		void RequestFire(const Vector3& position, const Quaternion& rotation);
+		/// Set the node whose position is reported as the area of interest center.
+		void SetViewNode(Node* node) { viewNode_ = node; }
+
+		/// Return sequence of the latest applied snapshot.
+		unsigned GetLastSequence() const { return lastApplied_; }
+
+	private:
+		/// Handle a server message.
+		void HandleNetworkMessage(StringHash eventType, VariantMap& eventData);
+		/// Decode a snapshot, store it as a future baseline and apply it if it is the newest.
+		void ReceiveSnapshot(const ea::vector<unsigned char>& data);
+		/// Move or create the proxy of an entity.
+		void ApplyState(const ReplicatedState& state);
+		/// Remove the proxy of an entity.
+		void RemoveProxy(unsigned id);
+		/// Create the proxy node of a zombie or projectile.
+		Node* CreateProxy(const ReplicatedState& state);
+		/// Return the proxy bone node of a ragdoll bone, or null if its zombie is not known yet.
+		Node* FindBone(const ReplicatedState& state);
+
+		/// Decoded snapshots, indexed by sequence modulo history size.
+		ReplicatedSnapshot history_[REPLICATION_HISTORY];
+		/// Proxy nodes by server node ID.
+		ea::unordered_map<unsigned, WeakPtr<Node> > proxies_;
+		/// Latest applied snapshot, what the proxies show.
+		ReplicatedSnapshot shown_;
+		/// Ragdoll bones whose zombie proxy did not exist when they arrived.
+		ea::vector<unsigned> pendingBones_;
+		/// Area of interest center.
+		WeakPtr<Node> viewNode_;
+		/// Parent of all proxy nodes.
+		WeakPtr<Node> proxiesNode_;
+		/// Sequence of the latest applied snapshot.
+		unsigned lastApplied_ = 0;
+	};
+}
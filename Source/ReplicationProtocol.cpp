@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "ReplicationProtocol.h"
+#include "CreateRagdoll.h"
+#include "RagdollPose.h"
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+namespace MonsterDolls
+{
+
+namespace
+{
+
+/// Entity is new to the client and carries its identity.
+const unsigned char FLAG_NEW = 1;
+/// Entity carries a position.
+const unsigned char FLAG_POSITION = 2;
+/// Entity carries a rotation.
+const unsigned char FLAG_ROTATION = 4;
+/// Shift of the entity kind in the flags byte.
+const unsigned KIND_SHIFT = 4;
+
+}
+
+const ReplicatedState* ReplicatedSnapshot::Find(unsigned id) const
+{
+	auto it = ea::lower_bound(states_.begin(), states_.end(), id,
+		[](const ReplicatedState& state, unsigned value) { return state.id_ < value; });
+	return it != states_.end() && it->id_ == id ? &*it : nullptr;
+}
+
+void ReplicatedSnapshot::Sort()
+{
+	ea::sort(states_.begin(), states_.end(),
+		[](const ReplicatedState& lhs, const ReplicatedState& rhs) { return lhs.id_ < rhs.id_; });
+}
+
+Vector3 ReplicatedNode::GetWorldPosition() const
+{
+	return state_ ? state_->GetPosition() : node_->GetWorldPosition();
+}
+
+Quaternion ReplicatedNode::GetWorldRotation() const
+{
+	return state_ ? state_->GetRotation() : node_->GetWorldRotation();
+}
+
+void GatherReplicatedNodes(Scene* scene, ea::vector<ReplicatedNode>& nodes, ea::vector<RigidBody*>& bodies,
+	unsigned maxNodes)
+{
+	nodes.clear();
+
+	Node* zombiesNode = nullptr;
+	for (Node* child : scene->GetChildren())
+	{
+		if (child->GetName() == "Zombie")
+			zombiesNode = child;
+		else if (child->GetName() == "Sphere" && nodes.size() < maxNodes)
+			nodes.push_back({ child, REPLICATED_PROJECTILE, 0 });
+	}
+	if (!zombiesNode)
+		return;
+
+	for (Node* zombie : zombiesNode->GetChildren())
+	{
+		// Bones are only driven by physics once the ragdoll was created
+		if (zombie->HasComponent<CreateRagdoll>())
+			continue;
+
+		const unsigned first = nodes.size();
+
+		// Directly posed bones are only written once per frame, the readers take the step's transforms from the
+		// motion states instead
+		auto* pose = zombie->GetComponent<RagdollPose>();
+		if (pose && pose->GetNumBodies())
+		{
+			for (unsigned i = 0; i < pose->GetNumBodies(); ++i)
+			{
+				const RagdollMotionState* state = pose->GetMotionState(i);
+				RigidBody* body = state->GetBody();
+				if (body && body->GetNode() != zombie)
+					nodes.push_back({ body->GetNode(), REPLICATED_BONE, zombie->GetID(), state });
+			}
+		}
+		else
+		{
+			zombie->GetComponents<RigidBody>(bodies, true);
+			for (RigidBody* body : bodies)
+			{
+				if (body->GetNode() != zombie)
+					nodes.push_back({ body->GetNode(), REPLICATED_BONE, zombie->GetID() });
+			}
+		}
+
+		// A ragdoll is taken whole or not at all
+		if (nodes.size() > maxNodes)
+			nodes.resize(first);
+	}
+
+	for (Node* zombie : zombiesNode->GetChildren())
+	{
+		if (nodes.size() >= maxNodes)
+			break;
+		nodes.push_back({ zombie, REPLICATED_ZOMBIE, 0 });
+	}
+}
+
+bool WriteReplicatedState(Serializer& dest, const ReplicatedState& state, const ReplicatedState* baseline)
+{
+	unsigned char flags = (unsigned char)(state.kind_ << KIND_SHIFT);
+	if (!baseline)
+		flags |= FLAG_NEW | FLAG_POSITION | FLAG_ROTATION;
+	else
+	{
+		if (!state.SamePosition(*baseline))
+			flags |= FLAG_POSITION;
+		if (state.rotation_ != baseline->rotation_)
+			flags |= FLAG_ROTATION;
+		if (!(flags & (FLAG_POSITION | FLAG_ROTATION)))
+			return false;
+	}
+
+	dest.WriteVLE(state.id_);
+	dest.WriteUByte(flags);
+	if (flags & FLAG_NEW)
+	{
+		dest.WriteVLE(state.owner_);
+		dest.WriteStringHash(state.bone_);
+	}
+	if (flags & FLAG_POSITION)
+	{
+		for (unsigned short value : state.position_)
+			dest.WriteUShort(value);
+	}
+	if (flags & FLAG_ROTATION)
+		dest.WriteUInt(state.rotation_);
+
+	return true;
+}
+
+ReplicatedState ReadReplicatedState(Deserializer& source, const ReplicatedSnapshot& baseline)
+{
+	ReplicatedState state;
+	state.id_ = source.ReadVLE();
+	const unsigned char flags = source.ReadUByte();
+	state.kind_ = (ReplicatedKind)(flags >> KIND_SHIFT);
+
+	if (flags & FLAG_NEW)
+	{
+		state.owner_ = source.ReadVLE();
+		state.bone_ = source.ReadStringHash();
+	}
+	else if (const ReplicatedState* previous = baseline.Find(state.id_))
+		state = *previous;
+
+	if (flags & FLAG_POSITION)
+	{
+		for (unsigned short& value : state.position_)
+			value = source.ReadUShort();
+	}
+	if (flags & FLAG_ROTATION)
+		state.rotation_ = source.ReadUInt();
+
+	return state;
+}
+
+}
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/Serializer.h>
+#include <Urho3D/Math/StringHash.h>
+
+#include "Quantization.h"
+
+#include <EASTL/vector.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Node;
+	class RigidBody;
+	class Scene;
+}
+
+namespace MonsterDolls
+{
+	class RagdollMotionState;
+
+	/// Server to client: delta compressed snapshot, unreliable.
+	static const int MSG_RAGDOLL_SNAPSHOT = 0x200;
+	/// Client to server: acknowledged snapshot sequence and view position, unreliable.
+	static const int MSG_RAGDOLL_ACK = 0x201;
+	/// Client to server: fire request with gun position and rotation, reliable.
+	static const int MSG_RAGDOLL_FIRE = 0x202;
+
+	/// Number of snapshots kept as delta baselines on both sides.
+	static const unsigned REPLICATION_HISTORY = 32;
+
+	/// Region all replicated positions are quantized in: the walking area extended by the room ragdolls and
+	/// projectiles need to fly around.
+	const BoundingBox REPLICATION_BOX(Vector3(-64.0f, -2.0f, -64.0f), Vector3(64.0f, 30.0f, 64.0f));
+
+	/// Kind of a replicated entity.
+	enum ReplicatedKind : unsigned char
+	{
+		REPLICATED_ZOMBIE = 0,
+		REPLICATED_BONE,
+		REPLICATED_PROJECTILE
+	};
+
+	/// Quantized state of a replicated entity.
+	struct ReplicatedState
+	{
+		/// Server node ID.
+		unsigned id_ = 0;
+		/// Entity kind.
+		ReplicatedKind kind_ = REPLICATED_ZOMBIE;
+		/// Server node ID of the zombie owning a bone.
+		unsigned owner_ = 0;
+		/// Bone name hash.
+		StringHash bone_;
+		/// Quantized world position.
+		unsigned short position_[3] = {};
+		/// Quantized world rotation.
+		unsigned rotation_ = 0;
+
+		/// Test for equal position.
+		bool SamePosition(const ReplicatedState& rhs) const
+		{
+			return position_[0] == rhs.position_[0] && position_[1] == rhs.position_[1] && position_[2] == rhs.position_[2];
+		}
+	};
+
+	/// Set of entity states sorted by ID.
+	struct ReplicatedSnapshot
+	{
+		/// Snapshot sequence, zero for none.
+		unsigned sequence_ = 0;
+		/// Entity states sorted by ID.
+		ea::vector<ReplicatedState> states_;
+
+		/// Return state of an entity or null.
+		const ReplicatedState* Find(unsigned id) const;
+		/// Return state of an entity or null.
+		ReplicatedState* Find(unsigned id) { return const_cast<ReplicatedState*>(static_cast<const ReplicatedSnapshot*>(this)->Find(id)); }
+		/// Sort states by ID.
+		void Sort();
+	};
+
+	/// Node of a replicated entity.
+	struct ReplicatedNode
+	{
+		/// Scene node.
+		Node* node_;
+		/// Entity kind.
+		ReplicatedKind kind_;
+		/// Server node ID of the zombie owning a bone.
+		unsigned owner_;
+		/// Motion state of a directly posed bone, whose node is only updated after the scene update, or null.
+		const RagdollMotionState* state_ = nullptr;
+
+		/// Return current world position, from the motion state for a posed bone.
+		Vector3 GetWorldPosition() const;
+		/// Return current world rotation, from the motion state for a posed bone.
+		Quaternion GetWorldRotation() const;
+	};
+
+	/// Collect projectiles, bones of active ragdolls and zombie roots of a Ragdolls scene in this order, up to a
+	/// maximum count. Ragdolls that do not fit whole are left out. Directly posed bones are not brought up to date,
+	/// read them through ReplicatedNode. Bodies is scratch space.
+	void GatherReplicatedNodes(Scene* scene, ea::vector<ReplicatedNode>& nodes, ea::vector<RigidBody*>& bodies,
+		unsigned maxNodes = M_MAX_UNSIGNED);
+	/// Write an entity against its baseline state, which is null for a new entity. Return false if nothing changed.
+	bool WriteReplicatedState(Serializer& dest, const ReplicatedState& state, const ReplicatedState* baseline);
+	/// Read an entity written by WriteReplicatedState. Unchanged fields are taken from the baseline snapshot.
+	ReplicatedState ReadReplicatedState(Deserializer& source, const ReplicatedSnapshot& baseline);
+}
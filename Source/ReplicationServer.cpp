@@ -0,0 +1,281 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#if URHO3D_NETWORK
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "ReplicationServer.h"
+#include "Ragdolls.h"
+
+#include <EASTL/algorithm.h>
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Largest snapshot header: sequence, baseline sequence and the change and removal counts.
+const unsigned SNAPSHOT_HEADER_SIZE = 16;
+
+}
+
+ReplicationServer::ReplicationServer(Context* context) :
+	Component(context)
+{
+}
+
+bool ReplicationServer::Start(unsigned short port)
+{
+	auto* network = GetSubsystem<Network>();
+	if (!network->StartServer(port))
+	{
+		URHO3D_LOGERROR("Could not start replication server on port {}", port);
+		return false;
+	}
+
+	SubscribeToEvent(E_CLIENTCONNECTED, URHO3D_HANDLER(ReplicationServer, HandleClientConnected));
+	SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(ReplicationServer, HandleClientDisconnected));
+	SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(ReplicationServer, HandleNetworkMessage));
+
+	URHO3D_LOGINFO("Replication server listening on port {}", port);
+	return true;
+}
+
+void ReplicationServer::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(ReplicationServer, HandleScenePostUpdate));
+	else
+		UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+}
+
+void ReplicationServer::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace ScenePostUpdate;
+
+	const float timeStep = eventData[P_TIMESTEP].GetFloat();
+	for (auto& client : clients_)
+		client->fireTimer_ += timeStep;
+
+	sendTimer_ += timeStep;
+	if (sendTimer_ < sendInterval_ || clients_.empty())
+		return;
+	sendTimer_ = Min(sendTimer_ - sendInterval_, sendInterval_);
+
+	HiresTimer timer;
+	bytesSent_ = 0;
+
+	// Quantize the world once, every client snapshot is a culled and delta compressed view of it
+	GatherWorldStates();
+	for (auto& client : clients_)
+	{
+		if (client->connection_)
+			SendSnapshot(*client);
+	}
+	++sequence_;
+
+	tickTime_ = timer.GetUSec(false);
+}
+
+void ReplicationServer::GatherWorldStates()
+{
+	GatherReplicatedNodes(GetScene(), nodes_, bodies_);
+
+	worldStates_.clear();
+	for (const ReplicatedNode& node : nodes_)
+	{
+		ReplicatedState state;
+		state.id_ = node.node_->GetID();
+		state.kind_ = node.kind_;
+		state.owner_ = node.owner_;
+		if (node.kind_ == REPLICATED_BONE)
+			state.bone_ = node.node_->GetNameHash();
+		QuantizePosition(node.GetWorldPosition(), REPLICATION_BOX, state.position_);
+		state.rotation_ = QuantizeRotation(node.GetWorldRotation());
+		worldStates_.push_back(state);
+	}
+}
+
+void ReplicationServer::SendSnapshot(ClientView& client)
+{
+	const ReplicatedSnapshot& baseline = client.history_[client.lastAcked_ % REPLICATION_HISTORY];
+	const bool hasBaseline = client.lastAcked_ && baseline.sequence_ == client.lastAcked_;
+	static const ReplicatedSnapshot emptySnapshot;
+	const ReplicatedSnapshot& reference = hasBaseline ? baseline : emptySnapshot;
+
+	// Nearest entities first, so the caps drop the far ones
+	const float radiusSquared = interestRadius_ * interestRadius_;
+	priorities_.clear();
+	for (unsigned i = 0; i < worldStates_.size(); ++i)
+	{
+		const Vector3 position = DequantizePosition(worldStates_[i].position_, REPLICATION_BOX);
+		const float distanceSquared = (position - client.viewPosition_).LengthSquared();
+		if (distanceSquared <= radiusSquared)
+			priorities_.emplace_back(distanceSquared, i);
+	}
+	ea::sort(priorities_.begin(), priorities_.end());
+
+	const unsigned numInterest = Min((unsigned)priorities_.size(), maxEntities_);
+	interestIds_.clear();
+	for (unsigned i = 0; i < numInterest; ++i)
+		interestIds_.push_back(worldStates_[priorities_[i].second].id_);
+	ea::sort(interestIds_.begin(), interestIds_.end());
+
+	ReplicatedSnapshot& snapshot = client.history_[sequence_ % REPLICATION_HISTORY];
+	snapshot.sequence_ = sequence_;
+	snapshot.states_.clear();
+
+	// The whole snapshot fits one datagram, losing a fragment would lose it all
+	const unsigned budget = maxPacketSize_ > SNAPSHOT_HEADER_SIZE ? maxPacketSize_ - SNAPSHOT_HEADER_SIZE : 0;
+
+	// Whatever the client had and is no longer of interest is gone. Removals take a few bytes and go first, one that
+	// does not fit leaves the entity with the client until a later snapshot
+	VectorBuffer removals;
+	unsigned numRemoved = 0;
+	for (const ReplicatedState& state : reference.states_)
+	{
+		if (ea::binary_search(interestIds_.begin(), interestIds_.end(), state.id_))
+			continue;
+
+		const unsigned size = removals.GetSize();
+		removals.WriteVLE(state.id_);
+		if (removals.GetSize() <= budget)
+			++numRemoved;
+		else
+		{
+			removals.Resize(size);
+			snapshot.states_.push_back(state);
+		}
+	}
+
+	VectorBuffer changes;
+	unsigned numChanged = 0;
+	for (unsigned i = 0; i < numInterest; ++i)
+	{
+		const ReplicatedState& state = worldStates_[priorities_[i].second];
+		const ReplicatedState* previous = reference.Find(state.id_);
+
+		const unsigned size = changes.GetSize();
+		if (!WriteReplicatedState(changes, state, previous))
+			snapshot.states_.push_back(state);
+		else if (removals.GetSize() + changes.GetSize() <= budget)
+		{
+			snapshot.states_.push_back(state);
+			++numChanged;
+		}
+		else
+		{
+			// Over budget: the client keeps what it has, new entities wait for a later snapshot
+			changes.Resize(size);
+			if (previous)
+				snapshot.states_.push_back(*previous);
+		}
+	}
+	snapshot.Sort();
+
+	VectorBuffer message;
+	message.WriteUInt(sequence_);
+	message.WriteUInt(hasBaseline ? client.lastAcked_ : 0);
+	message.WriteVLE(numChanged);
+	message.Write(changes.GetData(), changes.GetSize());
+	message.WriteVLE(numRemoved);
+	message.Write(removals.GetData(), removals.GetSize());
+
+	client.connection_->SendMessage(MSG_RAGDOLL_SNAPSHOT, false, false, message);
+	bytesSent_ += message.GetSize();
+}
+
+void ReplicationServer::HandleClientConnected(StringHash eventType, VariantMap& eventData)
+{
+	using namespace ClientConnected;
+
+	auto client = ea::make_unique<ClientView>();
+	client->connection_ = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+	client->viewPosition_ = Vector3(0.0f, 2.0f, -20.0f);
+	clients_.push_back(ea::move(client));
+
+	URHO3D_LOGINFO("Replication client connected, {} clients", clients_.size());
+}
+
+void ReplicationServer::HandleClientDisconnected(StringHash eventType, VariantMap& eventData)
+{
+	using namespace ClientDisconnected;
+
+	auto* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+	clients_.erase(ea::remove_if(clients_.begin(), clients_.end(),
+		[connection](const ea::unique_ptr<ClientView>& client) { return !client->connection_ || client->connection_ == connection; }),
+		clients_.end());
+}
+
+void ReplicationServer::HandleNetworkMessage(StringHash eventType, VariantMap& eventData)
+{
+	using namespace NetworkMessage;
+
+	ClientView* client = FindClient(static_cast<Connection*>(eventData[P_CONNECTION].GetPtr()));
+	if (!client)
+		return;
+
+	const int messageId = eventData[P_MESSAGEID].GetInt();
+	const ea::vector<unsigned char>& data = eventData[P_DATA].GetBuffer();
+	MemoryBuffer message(data);
+
+	if (messageId == MSG_RAGDOLL_ACK)
+	{
+		const unsigned acked = message.ReadUInt();
+		// Acks travel unreliably and may arrive out of order, never go back to an older baseline
+		if (acked > client->lastAcked_ && acked < sequence_)
+			client->lastAcked_ = acked;
+		client->viewPosition_ = message.ReadVector3();
+	}
+	else if (messageId == MSG_RAGDOLL_FIRE)
+	{
+		const Vector3 position = message.ReadVector3();
+		const Quaternion rotation = message.ReadQuaternion();
+		if (client->fireTimer_ < fireInterval_)
+			return;
+
+		client->fireTimer_ = 0.0f;
+		Ragdolls::SpawnProjectile(GetScene(), position, rotation);
+	}
+}
+
+ReplicationServer::ClientView* ReplicationServer::FindClient(Connection* connection)
+{
+	for (auto& client : clients_)
+	{
+		if (client->connection_ == connection)
+			return client.get();
+	}
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Scene/Component.h>
+
+#include "ReplicationProtocol.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Authoritative server side of the ragdoll replication. Sends quantized zombie, ragdoll bone and projectile
+	/// transforms to every client, delta compressed against the last snapshot the client acknowledged and culled
+	/// to the client's area of interest. The per client entity count and the snapshot size are capped, the latter
+	/// to one unfragmented datagram. Entities that do not fit keep their baseline state on the client and are sent
+	/// in a later snapshot, removals that do not fit wait the same way.
+	class ReplicationServer : public Component
+	{
+		URHO3D_OBJECT(ReplicationServer, Component);
+
+	public:
+		/// Construct.
+		explicit ReplicationServer(Context* context);
+
+		/// Start listening on the port. Return true on success.
+		bool Start(unsigned short port);
+
+		/// Set snapshots sent per second.
+		void SetSendRate(float rate) { sendInterval_ = 1.0f / Max(rate, 1.0f); }
+		/// Set radius around the client view position to replicate.
+		void SetInterestRadius(float radius) { interestRadius_ = radius; }
+		/// Set maximum entities considered per client and snapshot.
+		void SetMaxEntities(unsigned count) { maxEntities_ = count; }
+		/// Set maximum snapshot size in bytes, header and removals included.
+		void SetMaxPacketSize(unsigned size) { maxPacketSize_ = size; }
+		/// Set minimum seconds between two fire requests of a client.
+		void SetFireInterval(float interval) { fireInterval_ = interval; }
+
+		/// Return duration of the last server tick in microseconds.
+		long long GetTickTime() const { return tickTime_; }
+		/// Return payload bytes sent in the last server tick.
+		unsigned GetBytesSent() const { return bytesSent_; }
+		/// Return number of replicated entities in the last server tick.
+		unsigned GetNumEntities() const { return worldStates_.size(); }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Per client replication state.
+		struct ClientView
+		{
+			/// Client connection.
+			WeakPtr<Connection> connection_;
+			/// Last reported camera position.
+			Vector3 viewPosition_;
+			/// Latest acknowledged snapshot sequence.
+			unsigned lastAcked_ = 0;
+			/// Time since the last accepted fire request.
+			float fireTimer_ = 0.0f;
+			/// Snapshots sent, indexed by sequence modulo history size.
+			ReplicatedSnapshot history_[REPLICATION_HISTORY];
+		};
+
+		/// Handle scene post-update.
+		void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+		/// Handle a new client.
+		void HandleClientConnected(StringHash eventType, VariantMap& eventData);
+		/// Handle a client leaving.
+		void HandleClientDisconnected(StringHash eventType, VariantMap& eventData);
+		/// Handle a client message.
+		void HandleNetworkMessage(StringHash eventType, VariantMap& eventData);
+		/// Gather quantized states of all replicated entities.
+		void GatherWorldStates();
+		/// Build and send the snapshot of a client.
+		void SendSnapshot(ClientView& client);
+		/// Return client view of a connection or null.
+		ClientView* FindClient(Connection* connection);
+
+		/// Connected clients.
+		ea::vector<ea::unique_ptr<ClientView> > clients_;
+		/// Quantized states of all entities in the current tick.
+		ea::vector<ReplicatedState> worldStates_;
+		/// Replicated nodes of the current tick.
+		ea::vector<ReplicatedNode> nodes_;
+		/// Ragdoll bodies of a zombie, reused between zombies.
+		ea::vector<RigidBody*> bodies_;
+		/// Squared distance of the world states from the current client, reused between clients.
+		ea::vector<ea::pair<float, unsigned> > priorities_;
+		/// Sorted IDs of the entities within the current client's interest and entity cap, reused between clients.
+		ea::vector<unsigned> interestIds_;
+		/// Next snapshot sequence.
+		unsigned sequence_ = 1;
+		/// Time since the last snapshot.
+		float sendTimer_ = 0.0f;
+		/// Seconds between snapshots.
+		float sendInterval_ = 1.0f / 20.0f;
+		/// Area of interest radius.
+		float interestRadius_ = 60.0f;
+		/// Entity cap per client and snapshot.
+		unsigned maxEntities_ = 1024;
+		/// Size cap per snapshot, below a typical MTU.
+		unsigned maxPacketSize_ = 1200;
+		/// Minimum seconds between fire requests.
+		float fireInterval_ = 0.1f;
+		/// Duration of the last tick.
+		long long tickTime_ = 0;
+		/// Bytes sent in the last tick.
+		unsigned bytesSent_ = 0;
+	};
+}
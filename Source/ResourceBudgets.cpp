@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Audio/Sound.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/Graphics/Texture2DArray.h>
+#include <Urho3D/Graphics/Texture3D.h>
+#include <Urho3D/Graphics/TextureCube.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "ResourceBudgets.h"
+#include "CompressedAnimation.h"
+#include "PerformanceProfiles.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Milliseconds between budget checks.
+const unsigned CHECK_INTERVAL = 1000;
+
+const char* CATEGORY_NAMES[] = { "models", "animations", "sounds", "textures" };
+
+/// Resource types of a category.
+ea::vector<StringHash> GetCategoryTypes(ResourceCategory category)
+{
+	switch (category)
+	{
+	case RESOURCE_MODELS:
+		return { Model::GetTypeStatic() };
+	case RESOURCE_ANIMATIONS:
+		return { Animation::GetTypeStatic(), CompressedAnimation::GetTypeStatic() };
+	case RESOURCE_SOUNDS:
+		return { Sound::GetTypeStatic() };
+	case RESOURCE_TEXTURES:
+		return { Texture2D::GetTypeStatic(), Texture2DArray::GetTypeStatic(), Texture3D::GetTypeStatic(),
+			TextureCube::GetTypeStatic() };
+	default:
+		return {};
+	}
+}
+
+/// Convert megabytes of a profile to bytes.
+unsigned long long MegabytesToBytes(float megabytes)
+{
+	return megabytes > 0.0f ? (unsigned long long)(megabytes * 1024.0f * 1024.0f) : 0;
+}
+
+}
+
+ResourceBudgets::ResourceBudgets(Context* context) :
+	Object(context)
+{
+	SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(ResourceBudgets, HandleEndFrame));
+}
+
+void ResourceBudgets::SetBudgets(const PerformanceProfile& profile)
+{
+	SetBudget(RESOURCE_MODELS, MegabytesToBytes(profile.modelBudget_));
+	SetBudget(RESOURCE_ANIMATIONS, MegabytesToBytes(profile.animationBudget_));
+	SetBudget(RESOURCE_SOUNDS, MegabytesToBytes(profile.soundBudget_));
+	SetBudget(RESOURCE_TEXTURES, MegabytesToBytes(profile.textureBudget_));
+}
+
+unsigned ResourceBudgets::Enforce()
+{
+	unsigned evicted = 0;
+	for (unsigned i = 0; i < MAX_RESOURCE_CATEGORIES; ++i)
+	{
+		if (budgets_[i])
+			evicted += EnforceCategory((ResourceCategory)i);
+	}
+	return evicted;
+}
+
+unsigned long long ResourceBudgets::GetMemoryUse(ResourceCategory category) const
+{
+	const auto* cache = GetSubsystem<ResourceCache>();
+	unsigned long long total = 0;
+	for (StringHash type : GetCategoryTypes(category))
+		total += cache->GetMemoryUse(type);
+	return total;
+}
+
+ea::string ResourceBudgets::GetUsageText() const
+{
+	ea::string text;
+	for (unsigned i = 0; i < MAX_RESOURCE_CATEGORIES; ++i)
+	{
+		const auto category = (ResourceCategory)i;
+		const float used = GetMemoryUse(category) / (1024.0f * 1024.0f);
+		if (!text.empty())
+			text += ", ";
+		if (budgets_[i])
+			text += Format("{} {:.1f} / {:.1f} MB", CATEGORY_NAMES[i], used, budgets_[i] / (1024.0f * 1024.0f));
+		else
+			text += Format("{} {:.1f} MB", CATEGORY_NAMES[i], used);
+	}
+	return text;
+}
+
+const char* ResourceBudgets::GetCategoryName(ResourceCategory category)
+{
+	return CATEGORY_NAMES[category];
+}
+
+void ResourceBudgets::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+	if (checkTimer_.GetMSec(false) < CHECK_INTERVAL)
+		return;
+
+	checkTimer_.Reset();
+	Enforce();
+}
+
+unsigned ResourceBudgets::EnforceCategory(ResourceCategory category)
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+	const ea::vector<StringHash> types = GetCategoryTypes(category);
+	const auto& groups = cache->GetAllResources();
+
+	unsigned evicted = 0;
+	for (;;)
+	{
+		// Find the resource unused for the longest time among those only the cache holds
+		unsigned long long total = 0;
+		Resource* oldest = nullptr;
+		unsigned oldestTime = 0;
+		for (StringHash type : types)
+		{
+			auto group = groups.find(type);
+			if (group == groups.end())
+				continue;
+
+			for (const auto& pair : group->second.resources_)
+			{
+				Resource* resource = pair.second;
+				total += resource->GetMemoryUse();
+				// The cache does not release resources held elsewhere, even weakly
+				if (resource->Refs() > 1 || resource->WeakRefs() > 0)
+					continue;
+
+				const unsigned time = resource->GetUseTimer();
+				if (!oldest || time > oldestTime)
+				{
+					oldest = resource;
+					oldestTime = time;
+				}
+			}
+		}
+
+		// Resources in use may keep the category over budget
+		if (total <= budgets_[category] || !oldest)
+			break;
+
+		const StringHash type = oldest->GetType();
+		const ea::string name = oldest->GetName();
+		URHO3D_LOGDEBUG("Evicting {} ({} bytes, unused for {} ms) over the {} budget", name, oldest->GetMemoryUse(),
+			oldestTime, CATEGORY_NAMES[category]);
+		cache->ReleaseResource(type, name);
+		++evicted;
+	}
+
+	numEvicted_ += evicted;
+	return evicted;
+}
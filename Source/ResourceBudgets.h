@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	struct PerformanceProfile;
+
+	/// Resource types sharing a memory budget.
+	enum ResourceCategory
+	{
+		RESOURCE_MODELS = 0,
+		RESOURCE_ANIMATIONS,
+		RESOURCE_SOUNDS,
+		RESOURCE_TEXTURES,
+		MAX_RESOURCE_CATEGORIES
+	};
+
+	/// Memory budgets of the resource cache per category. The cache itself only budgets single resource types and
+	/// only when one is loaded, so resources released by the game stay until another of their type comes. Every
+	/// second the categories over budget drop their least recently used resources nothing but the cache refers to.
+	class ResourceBudgets : public Object
+	{
+		URHO3D_OBJECT(ResourceBudgets, Object);
+
+	public:
+		/// Construct.
+		explicit ResourceBudgets(Context* context);
+
+		/// Set budget of a category in bytes, 0 is unlimited.
+		void SetBudget(ResourceCategory category, unsigned long long budget) { budgets_[category] = budget; }
+		/// Set the budgets of a performance profile.
+		void SetBudgets(const PerformanceProfile& profile);
+		/// Evict resources of the categories over budget. Return number of resources evicted.
+		unsigned Enforce();
+
+		/// Return budget of a category in bytes, 0 is unlimited.
+		unsigned long long GetBudget(ResourceCategory category) const { return budgets_[category]; }
+		/// Return memory used by the cached resources of a category.
+		unsigned long long GetMemoryUse(ResourceCategory category) const;
+		/// Return number of resources evicted so far.
+		unsigned GetNumEvicted() const { return numEvicted_; }
+		/// Return usage and budget of every category as one line of text.
+		ea::string GetUsageText() const;
+
+		/// Return category name.
+		static const char* GetCategoryName(ResourceCategory category);
+
+	private:
+		/// Handle end of frame.
+		void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+		/// Evict resources of a category until it fits its budget. Return number of resources evicted.
+		unsigned EnforceCategory(ResourceCategory category);
+
+		/// Budgets in bytes.
+		unsigned long long budgets_[MAX_RESOURCE_CATEGORIES]{};
+		/// Resources evicted so far.
+		unsigned numEvicted_ = 0;
+		/// Time since the last check.
+		Timer checkTimer_;
+	};
+}
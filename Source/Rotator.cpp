@@ -29,7 +29,7 @@
 using namespace MonsterDolls;
 
 Rotator::Rotator(Context* context) :
-    LogicComponent(context),
+    ParallelLogicComponent(context),
     rotationSpeed_(Vector3::ZERO)
 {
     // Only the scene update event is needed: unsubscribe from the rest for optimization
@@ -41,9 +41,10 @@ void Rotator::SetRotationSpeed(const Vector3& speed)
     rotationSpeed_ = speed;
 }
 
-void Rotator::Update(float timeStep)
+void Rotator::ParallelUpdate(float timeStep, LogicCommandBuffer& commands)
 {
     // Components have their scene node as a member variable for convenient access. Rotate the scene node now: construct a
     // rotation quaternion from Euler angles, scale rotation speed with the scene update time step
-    node_->Rotate(Quaternion(rotationSpeed_.x_ * timeStep, rotationSpeed_.y_ * timeStep, rotationSpeed_.z_ * timeStep));
+    const Quaternion delta(rotationSpeed_.x_ * timeStep, rotationSpeed_.y_ * timeStep, rotationSpeed_.z_ * timeStep);
+    commands.SetTransform(node_, node_->GetPosition(), (node_->GetRotation() * delta).Normalized());
 }
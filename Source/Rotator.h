@@ -22,7 +22,7 @@
 
 #pragma once
 
-#include <Urho3D/Scene/LogicComponent.h>
+#include "ParallelLogic.h"
 
 // All Urho3D classes reside in namespace Urho3D
 using namespace Urho3D;
@@ -30,9 +30,9 @@ using namespace Urho3D;
 namespace MonsterDolls
 {
 	/// Custom logic component for rotating a scene node.
-	class Rotator : public LogicComponent
+	class Rotator : public ParallelLogicComponent
 	{
-		URHO3D_OBJECT(Rotator, LogicComponent);
+		URHO3D_OBJECT(Rotator, ParallelLogicComponent);
 
 	public:
 		/// Construct.
@@ -40,8 +40,8 @@ namespace MonsterDolls
 
 		/// Set rotation speed about the Euler axes. Will be scaled with scene update time step.
 		void SetRotationSpeed(const Vector3& speed);
-		/// Handle scene update. Called by LogicComponent base class.
-		void Update(float timeStep) override;
+		/// Rotate the node. Called from the parallel phase.
+		void ParallelUpdate(float timeStep, LogicCommandBuffer& commands) override;
 
 		/// Return rotation speed.
 		const Vector3& GetRotationSpeed() const { return rotationSpeed_; }
@@ -49,6 +49,7 @@
 #include <Urho3D/Resource/XMLFile.h>
 #include <Urho3D/IO/Log.h>
 #include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Core/ProcessUtils.h>
 
 
 // All Urho3D classes reside in namespace Urho3D
@@ -63,6 +64,18 @@ URHO3D_EVENT(E_SAMPLE_EXIT_REQUESTED, SampleExitRequested)
 
 namespace MonsterDolls
 {
+	/// Return value following a command line option, or the default value if the option is missing.
+	inline ea::string GetArgumentValue(const ea::string& option, const ea::string& defaultValue = EMPTY_STRING)
+	{
+		const StringVector& args = GetArguments();
+		for (unsigned i = 0; i + 1 < args.size(); ++i)
+		{
+			if (args[i] == option)
+				return args[i + 1];
+		}
+		return defaultValue;
+	}
+
 	/// Sample class, as framework for all samples.
 	///    - Initialization of the Urho3D engine (in Application class)
 	///    - Modify engine parameters for windowed mode and to show the class name as title
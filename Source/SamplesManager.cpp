@@ -21,6 +21,7 @@
 #include <Urho3D/Engine/EngineDefs.h>
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/Core/CommandLine.h>
+#include <Urho3D/Core/ProcessUtils.h>
 #include <Urho3D/Core/StringUtils.h>
 #include <Urho3D/Input/Input.h>
 #include <Urho3D/Input/InputEvents.h>
@@ -39,6 +40,14 @@
 #include <Urho3D/UI/UI.h>
 #include <Urho3D/UI/UIEvents.h>
 
+#include "BatchSimulation.h"
+#include "HeadlessScenario.h"
+#include "MetricsExporter.h"
+#include "PerformanceProfiles.h"
+#include "ResourceBudgets.h"
+#if URHO3D_NETWORK
+#include "ReplicationServer.h"
+#endif
 #include "Ragdolls.h"
 
 #include "Rotator.h"
@@ -85,14 +94,90 @@ void SamplesManager::Setup()
 			engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";..;../..";
 	}
 	engineParameters_[EP_AUTOLOAD_PATHS] = "Autoload";
+
+	// Hardware tier values: --profile low|medium|high|benchmark, changed by Profiles.xml next to the executable or
+	// --profile-file <file>, and each value by its own option
+	auto profiles = MakeShared<PerformanceProfiles>(context_);
+	const ea::string profileFile = GetArgumentValue("--profile-file",
+		GetSubsystem<FileSystem>()->GetProgramDir() + "Profiles.xml");
+	if (GetSubsystem<FileSystem>()->FileExists(profileFile))
+		profiles->LoadFile(profileFile);
+	profiles->SelectProfile(GetArgumentValue("--profile", "high"));
+	profiles->ApplyArguments();
+	profiles->ApplyEngineParameters(engineParameters_);
+	context_->RegisterSubsystem(profiles);
+
+	// Batch simulation runs without window and sound, its workers would fight over a shared log file
+	if (BatchSimulation::IsRequested(GetArguments()))
+	{
+		engineParameters_[EP_HEADLESS] = true;
+		engineParameters_[EP_SOUND] = false;
+		engineParameters_[EP_LOG_NAME] = "";
+	}
+
+	// Replication server only simulates
+	if (!GetArgumentValue("--server").empty())
+	{
+		engineParameters_[EP_HEADLESS] = true;
+		engineParameters_[EP_SOUND] = false;
+	}
 }
 
 void SamplesManager::Start()
 {
+	GetSubsystem<PerformanceProfiles>()->ApplyToEngine();
+
+	// Memory ceilings of the profile per resource category, evicting resources no longer in use
+	auto budgets = MakeShared<ResourceBudgets>(context_);
+	budgets->SetBudgets(GetSubsystem<PerformanceProfiles>()->GetProfile());
+	context_->RegisterSubsystem(budgets);
+
 	ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
 	VirtualFileSystem* vfs = context_->GetSubsystem<VirtualFileSystem>();
 	vfs->SetWatching(true);
 
+	// Run the batch simulation instead of the menu
+	auto batchSimulation = MakeShared<BatchSimulation>(context_);
+	if (batchSimulation->ParseArguments(GetArguments()))
+	{
+		exitCode_ = batchSimulation->Run();
+		engine_->Exit();
+		return;
+	}
+
+	// Soak runs export their counters with --metrics <file.prom> [--metrics-interval <seconds>]
+	const ea::string metricsFile = GetArgumentValue("--metrics");
+	if (!metricsFile.empty())
+	{
+		metricsExporter_ = MakeShared<MetricsExporter>(context_);
+		metricsExporter_->SetOutput(metricsFile, ToFloat(GetArgumentValue("--metrics-interval", "5")));
+	}
+
+#if URHO3D_NETWORK
+	// Host the simulation for thin replication clients instead of the menu
+	const ea::string serverPort = GetArgumentValue("--server");
+	if (!serverPort.empty())
+	{
+		ScenarioParameters parameters;
+		parameters.numZombies_ = ToInt(GetArgumentValue("--server-zombies", "11"));
+
+		auto scenario = MakeShared<HeadlessScenario>(context_);
+		scenario->Create(parameters);
+		serverScenario_ = scenario;
+
+		auto* server = scenario->GetScene()->CreateComponent<ReplicationServer>();
+		if (!server->Start((unsigned short)ToUInt(serverPort)))
+		{
+			ErrorExit("Could not start replication server");
+			return;
+		}
+
+		// Headless frames are not limited by vsync
+		engine_->SetMaxFps(60);
+		return;
+	}
+#endif
+
 	UI* ui = context_->GetSubsystem<UI>();
 
 #if MOBILE
@@ -174,6 +259,8 @@ void SamplesManager::Start()
 
 void SamplesManager::Stop()
 {
+	if (metricsExporter_)
+		metricsExporter_->WriteSummary();
 	engine_->DumpResources(true);
 	GetSubsystem<StateManager>()->Reset();
 }
@@ -35,6 +35,8 @@ using namespace Urho3D;
 
 namespace MonsterDolls
 {
+	class MetricsExporter;
+
 	struct SampleInformation
 	{
 		/// Title of the sample.
@@ -86,6 +88,11 @@ namespace MonsterDolls
 		std::vector<std::string> commandLineArgsTemp_; // TODO: Get rid of it
 		ea::vector<ea::string> commandLineArgs_;
 
+		/// Headless scene hosted for replication clients.
+		SharedPtr<Object> serverScenario_;
+		/// Metrics file writer of soak runs.
+		SharedPtr<MetricsExporter> metricsExporter_;
+
 		/// Generic Serializable inspector.
 		/// @{
 		SharedPtr<Scene> inspectorNode_;
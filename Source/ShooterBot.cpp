@@ -0,0 +1,313 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "ShooterBot.h"
+#include "CreateRagdoll.h"
+#include "Sample.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Degrees off the aim point a shot is still taken at.
+const float ON_TARGET_ANGLE = 3.0f;
+/// Shots kept due while the owner does not take them, e.g. during the kill-cam.
+const unsigned MAX_PENDING_SHOTS = 4;
+/// Distance within which zombies count as one clump.
+const float CLUMP_RADIUS = 3.0f;
+/// Aim height above a zombie's feet.
+const Vector3 AIM_OFFSET(0.0f, 1.0f, 0.0f);
+
+}
+
+float ShooterBotProfile::GetFireRate(float time) const
+{
+	if (ramp_.empty())
+		return fireRate_;
+	if (time <= ramp_.front().time_)
+		return ramp_.front().fireRate_;
+
+	for (unsigned i = 0; i + 1 < ramp_.size(); ++i)
+	{
+		const BotRampStage& stage = ramp_[i];
+		const BotRampStage& next = ramp_[i + 1];
+		if (time < next.time_)
+			return Lerp(stage.fireRate_, next.fireRate_, (time - stage.time_) / Max(next.time_ - stage.time_, M_EPSILON));
+	}
+	return ramp_.back().fireRate_;
+}
+
+bool ShooterBotProfile::GetBuiltIn(const ea::string& name, ShooterBotProfile& profile)
+{
+	profile = ShooterBotProfile();
+
+	if (name == "random")
+		return true;
+	else if (name == "sweep")
+	{
+		profile.targeting_ = BOT_SWEEP;
+		profile.fireRate_ = 4.0f;
+		profile.aimSpread_ = 1.0f;
+		profile.turnSpeed_ = 30.0f;
+		return true;
+	}
+	else if (name == "clumps")
+	{
+		profile.targeting_ = BOT_CLUMPS;
+		profile.fireRate_ = 8.0f;
+		profile.aimSpread_ = 3.0f;
+		profile.burstLength_ = 5;
+		profile.burstPause_ = 1.0f;
+		profile.turnSpeed_ = 240.0f;
+		return true;
+	}
+
+	return false;
+}
+
+bool ShooterBotProfile::FromArguments(ShooterBotProfile& profile)
+{
+	const ea::string name = GetArgumentValue("--bot");
+	if (name.empty())
+		return false;
+
+	if (!GetBuiltIn(name, profile))
+		URHO3D_LOGWARNING("Unknown bot profile {}, using random", name);
+
+	const ea::string rate = GetArgumentValue("--bot-rate");
+	if (!rate.empty())
+		profile.fireRate_ = ToFloat(rate);
+	const ea::string spread = GetArgumentValue("--bot-spread");
+	if (!spread.empty())
+		profile.aimSpread_ = ToFloat(spread);
+	const ea::string burst = GetArgumentValue("--bot-burst");
+	if (!burst.empty())
+		profile.burstLength_ = ToUInt(burst);
+	const ea::string burstPause = GetArgumentValue("--bot-burst-pause");
+	if (!burstPause.empty())
+		profile.burstPause_ = ToFloat(burstPause);
+	const ea::string turnSpeed = GetArgumentValue("--bot-turn-speed");
+	if (!turnSpeed.empty())
+		profile.turnSpeed_ = ToFloat(turnSpeed);
+
+	// Stages in increasing time, e.g. 0:1,30:4,60:10
+	for (const ea::string& stage : GetArgumentValue("--bot-ramp").split(','))
+	{
+		const ea::vector<ea::string> parts = stage.split(':');
+		if (parts.size() == 2)
+			profile.ramp_.push_back({ ToFloat(parts[0]), ToFloat(parts[1]) });
+	}
+
+	return true;
+}
+
+ShooterBot::ShooterBot(Context* context) :
+	Component(context)
+{
+}
+
+void ShooterBot::OnSceneSet(Scene* scene)
+{
+	if (scene)
+		SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(ShooterBot, HandleSceneUpdate));
+	else
+		UnsubscribeFromEvent(E_SCENEUPDATE);
+}
+
+void ShooterBot::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+	using namespace SceneUpdate;
+
+	if (IsEnabledEffective())
+		Update(eventData[P_TIMESTEP].GetFloat());
+}
+
+void ShooterBot::Update(float timeStep)
+{
+	if (!node_)
+		return;
+
+	time_ += timeStep;
+	if (!aimValid_)
+	{
+		aim_ = node_->GetWorldRotation();
+		sweepYaw_ = aim_.YawAngle();
+		burstLeft_ = profile_.burstLength_;
+		aimValid_ = true;
+	}
+
+	GatherTargets();
+	if (targets_.empty())
+	{
+		node_->SetWorldRotation(aim_);
+		return;
+	}
+
+	if (profile_.targeting_ == BOT_SWEEP)
+		sweepYaw_ += sweepDirection_ * profile_.turnSpeed_ * timeStep;
+
+	// Turn towards the aim point no faster than the profile allows
+	const Quaternion desired(Vector3::FORWARD, GetAimDirection());
+	const float angle = (aim_ * Vector3::FORWARD).Angle(desired * Vector3::FORWARD);
+	const float turn = profile_.turnSpeed_ * timeStep;
+	aim_ = angle > turn ? aim_.Slerp(desired, turn / angle) : desired;
+	node_->SetWorldRotation(aim_);
+
+	if (pauseLeft_ > 0.0f)
+	{
+		pauseLeft_ -= timeStep;
+		if (pauseLeft_ <= 0.0f)
+		{
+			burstLeft_ = profile_.burstLength_;
+			target_.Reset();
+		}
+		return;
+	}
+
+	// The trigger is only pulled once the aim is on the target
+	if (angle - turn > ON_TARGET_ANGLE)
+		return;
+
+	shotProgress_ += GetFireRate() * timeStep;
+	while (shotProgress_ >= 1.0f)
+	{
+		shotProgress_ -= 1.0f;
+		pendingShots_ = Min(pendingShots_ + 1, MAX_PENDING_SHOTS);
+
+		if (burstLeft_ && --burstLeft_ == 0)
+		{
+			pauseLeft_ = profile_.burstPause_;
+			shotProgress_ = 0.0f;
+		}
+	}
+}
+
+bool ShooterBot::TakeShot()
+{
+	if (!pendingShots_ || !node_)
+		return false;
+
+	--pendingShots_;
+	++numShots_;
+
+	// The spread only turns the node for this shot, the next update continues from the unspread aim
+	const float spread = profile_.aimSpread_;
+	node_->SetWorldRotation(Quaternion(Random(-1.0f, 1.0f) * spread, Random(-1.0f, 1.0f) * spread, 0.0f) * aim_);
+
+	if (profile_.targeting_ == BOT_RANDOM)
+		target_.Reset();
+	return true;
+}
+
+void ShooterBot::GatherTargets()
+{
+	targets_.clear();
+	if (!zombiesNode_)
+		return;
+
+	// Only zombies still carrying the trigger can be hit
+	for (Node* zombie : zombiesNode_->GetChildren())
+	{
+		if (zombie->HasComponent<CreateRagdoll>())
+			targets_.push_back(zombie);
+	}
+}
+
+void ShooterBot::PickTarget()
+{
+	if (profile_.targeting_ != BOT_CLUMPS)
+	{
+		target_ = targets_[Rand() % targets_.size()];
+		targetOffset_ = AIM_OFFSET;
+		return;
+	}
+
+	// The zombie with the most others within the clump radius, aiming at the center of its clump
+	unsigned bestCount = 0;
+	Vector3 bestCenter;
+	for (Node* zombie : targets_)
+	{
+		const Vector3 position = zombie->GetWorldPosition();
+		Vector3 center;
+		unsigned count = 0;
+		for (Node* other : targets_)
+		{
+			const Vector3 otherPosition = other->GetWorldPosition();
+			if ((otherPosition - position).LengthSquared() <= CLUMP_RADIUS * CLUMP_RADIUS)
+			{
+				center += otherPosition;
+				++count;
+			}
+		}
+
+		if (count > bestCount)
+		{
+			bestCount = count;
+			bestCenter = center / (float)count;
+			target_ = zombie;
+		}
+	}
+
+	targetOffset_ = bestCenter - target_->GetWorldPosition() + AIM_OFFSET;
+}
+
+Vector3 ShooterBot::GetAimDirection()
+{
+	const Vector3 position = node_->GetWorldPosition();
+
+	if (profile_.targeting_ == BOT_SWEEP)
+	{
+		// Swing between the outermost zombies, pitched at their average distance
+		float minYaw = M_INFINITY;
+		float maxYaw = -M_INFINITY;
+		float distance = 0.0f;
+		for (Node* zombie : targets_)
+		{
+			const Vector3 offset = zombie->GetWorldPosition() - position;
+			const float yaw = Atan2(offset.x_, offset.z_);
+			minYaw = Min(minYaw, yaw);
+			maxYaw = Max(maxYaw, yaw);
+			distance += Vector2(offset.x_, offset.z_).Length();
+		}
+		distance /= targets_.size();
+
+		if (sweepYaw_ >= maxYaw)
+			sweepDirection_ = -1.0f;
+		else if (sweepYaw_ <= minYaw)
+			sweepDirection_ = 1.0f;
+		sweepYaw_ = Clamp(sweepYaw_, minYaw, maxYaw);
+
+		return Quaternion(sweepYaw_, Vector3::UP) * Vector3(0.0f, AIM_OFFSET.y_ - position.y_, distance);
+	}
+
+	if (!target_ || !target_->HasComponent<CreateRagdoll>())
+		PickTarget();
+	return target_->GetWorldPosition() + targetOffset_ - position;
+}
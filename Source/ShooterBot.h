@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// How the bot picks where to shoot.
+	enum BotTargeting
+	{
+		/// Single shots at a random living zombie.
+		BOT_RANDOM = 0,
+		/// Swing back and forth across the crowd, firing as the aim passes.
+		BOT_SWEEP,
+		/// Bursts at the zombie with the most others around it.
+		BOT_CLUMPS
+	};
+
+	/// Fire rate from a point in time on, linearly interpolated to the next stage.
+	struct BotRampStage
+	{
+		/// Seconds since the bot started.
+		float time_;
+		/// Shots per second.
+		float fireRate_;
+	};
+
+	/// Behaviour of the shooter bot. Built-in profiles are random, sweep and clumps, every value has an option:
+	///     --bot <name> --bot-rate <shots/s> --bot-spread <degrees> --bot-burst <shots> --bot-burst-pause <seconds>
+	///     --bot-turn-speed <degrees/s> --bot-ramp <seconds:shots/s,...>
+	struct ShooterBotProfile
+	{
+		/// Target selection.
+		BotTargeting targeting_ = BOT_RANDOM;
+		/// Shots per second when there is no ramp.
+		float fireRate_ = 2.0f;
+		/// Maximum aim deviation of a shot in degrees.
+		float aimSpread_ = 2.0f;
+		/// Shots per burst, 0 fires continuously.
+		unsigned burstLength_ = 0;
+		/// Seconds between two bursts.
+		float burstPause_ = 1.0f;
+		/// Degrees per second the aim turns at.
+		float turnSpeed_ = 180.0f;
+		/// Fire rate schedule, empty keeps the fire rate constant.
+		ea::vector<BotRampStage> ramp_;
+
+		/// Return the fire rate at a time since the start.
+		float GetFireRate(float time) const;
+
+		/// Return a built-in profile by name, or false if there is none.
+		static bool GetBuiltIn(const ea::string& name, ShooterBotProfile& profile);
+		/// Return the profile selected with --bot and the overrides of its options, or false without --bot.
+		static bool FromArguments(ShooterBotProfile& profile);
+	};
+
+	/// Synthetic player for load generation. Turns its node towards the zombies picked by the profile at a limited
+	/// speed and schedules shots at the profile's fire rate, once the aim is on target. The owner fires through its
+	/// usual path with the node transform whenever TakeShot returns true, so bot shots cost the same as the player's.
+	/// Aiming and spread use the engine's random generator and are repeatable with the same seed and time steps.
+	class ShooterBot : public Component
+	{
+		URHO3D_OBJECT(ShooterBot, Component);
+
+	public:
+		/// Construct.
+		explicit ShooterBot(Context* context);
+
+		/// Set behaviour.
+		void SetProfile(const ShooterBotProfile& profile) { profile_ = profile; }
+		/// Set parent node of the zombies to shoot at.
+		void SetTargets(Node* zombiesNode) { zombiesNode_ = zombiesNode; }
+		/// Advance aim and fire schedule.
+		void Update(float timeStep);
+		/// Consume a due shot. The node is already turned to the shot direction.
+		bool TakeShot();
+
+		/// Return behaviour.
+		const ShooterBotProfile& GetProfile() const { return profile_; }
+		/// Return the fire rate at the current time.
+		float GetFireRate() const { return profile_.GetFireRate(time_); }
+		/// Return seconds since the start.
+		float GetTime() const { return time_; }
+		/// Return shots taken.
+		unsigned GetNumShots() const { return numShots_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle the scene update.
+		void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+		/// Collect the zombies that can still be hit.
+		void GatherTargets();
+		/// Pick a target point for the random and clumps profiles.
+		void PickTarget();
+		/// Return the direction to aim at now.
+		Vector3 GetAimDirection();
+
+		/// Behaviour.
+		ShooterBotProfile profile_;
+		/// Parent node of the zombies.
+		WeakPtr<Node> zombiesNode_;
+		/// Zombies that can still be hit, gathered every update.
+		ea::vector<Node*> targets_;
+		/// Zombie aimed at by the random and clumps profiles.
+		WeakPtr<Node> target_;
+		/// Offset from the target zombie to the aim point.
+		Vector3 targetOffset_;
+		/// Aim without the spread of the last shot.
+		Quaternion aim_;
+		/// Whether the aim was initialized from the node.
+		bool aimValid_ = false;
+		/// Sweep yaw in degrees.
+		float sweepYaw_ = 0.0f;
+		/// Sweep direction, 1 or -1.
+		float sweepDirection_ = 1.0f;
+		/// Seconds since the start.
+		float time_ = 0.0f;
+		/// Fraction of the next shot accumulated from the fire rate.
+		float shotProgress_ = 0.0f;
+		/// Seconds left of the pause between bursts.
+		float pauseLeft_ = 0.0f;
+		/// Shots left in the current burst.
+		unsigned burstLeft_ = 0;
+		/// Due shots not taken yet.
+		unsigned pendingShots_ = 0;
+		/// Shots taken.
+		unsigned numShots_ = 0;
+	};
+}
@@ -0,0 +1,342 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Physics/PhysicsUtils.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include <Bullet/BulletCollision/BroadphaseCollision/btBroadphaseInterface.h>
+#include <Bullet/BulletCollision/CollisionDispatch/btCollisionWorld.h>
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+
+#include "SpatialQueries.h"
+#include "CreateRagdoll.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Narrowest and widest cone half angle in degrees.
+const float MIN_CONE_ANGLE = 1.0f;
+const float MAX_CONE_ANGLE = 89.0f;
+/// Point hit on a zombie trigger, above its feet.
+const Vector3 TRIGGER_CENTER(0.0f, 1.0f, 0.0f);
+
+/// Collects the broadphase proxies on the wanted collision layers.
+class CandidateCollector : public btBroadphaseAabbCallback
+{
+public:
+	/// Construct.
+	explicit CandidateCollector(unsigned collisionMask) :
+		collisionMask_(collisionMask)
+	{
+	}
+
+	/// Keep a proxy whose box overlaps the query box.
+	bool process(const btBroadphaseProxy* proxy) override
+	{
+		if ((unsigned)proxy->m_collisionFilterGroup & collisionMask_)
+			proxies_.push_back(proxy);
+		return true;
+	}
+
+	/// Collision layers to keep.
+	unsigned collisionMask_;
+	/// Kept proxies.
+	ea::vector<const btBroadphaseProxy*> proxies_;
+};
+
+/// Tests the rigid bodies on the wanted collision layers whose broadphase box the ray passes through against the
+/// ray, keeping the closest hit.
+class RayTester : public btBroadphaseRayCallback
+{
+public:
+	/// Construct for a segment.
+	RayTester(const btVector3& from, const btVector3& to, unsigned collisionMask) :
+		from_(btQuaternion::getIdentity(), from),
+		to_(btQuaternion::getIdentity(), to),
+		collisionMask_(collisionMask),
+		closest_(from, to)
+	{
+		// Same setup as the ray callback of btCollisionWorld::rayTest
+		const btVector3 direction = (to - from).normalized();
+		for (int i = 0; i < 3; ++i)
+		{
+			m_rayDirectionInverse[i] =
+				direction[i] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[i];
+			m_signs[i] = m_rayDirectionInverse[i] < btScalar(0.0);
+		}
+		m_lambda_max = direction.dot(to - from);
+	}
+
+	/// Test the shape of a body whose box the ray passes through.
+	bool process(const btBroadphaseProxy* proxy) override
+	{
+		// Nothing is closer than a hit at the start
+		if (closest_.m_closestHitFraction == btScalar(0.0))
+			return false;
+		if (!((unsigned)proxy->m_collisionFilterGroup & collisionMask_))
+			return true;
+
+		// Only rigid bodies carry their component as user pointer
+		auto* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+		if (!object || object->getInternalType() != btCollisionObject::CO_RIGID_BODY || !object->getUserPointer())
+			return true;
+
+		++numTested_;
+		btCollisionWorld::rayTestSingle(from_, to_, object, object->getCollisionShape(), object->getWorldTransform(),
+			closest_);
+		return true;
+	}
+
+	/// Segment start.
+	btTransform from_;
+	/// Segment end.
+	btTransform to_;
+	/// Collision layers to hit.
+	unsigned collisionMask_;
+	/// Closest hit.
+	btCollisionWorld::ClosestRayResultCallback closest_;
+	/// Bodies whose shape was tested.
+	unsigned numTested_ = 0;
+};
+
+/// Return whether a sphere touches a cone given by its apex, unit axis, half angle and range.
+bool SphereInCone(const Vector3& apex, const Vector3& axis, float sinAngle, float cosAngle, float range,
+	const Vector3& center, float radius)
+{
+	const Vector3 offset = center - apex;
+	const float distanceSquared = offset.LengthSquared();
+	if (distanceSquared > (range + radius) * (range + radius))
+		return false;
+
+	// Moving the apex back along the axis widens the cone by the sphere radius
+	const Vector3 shifted = center - (apex - axis * (radius / sinAngle));
+	const float along = shifted.DotProduct(axis);
+	if (along <= 0.0f || along * along < shifted.LengthSquared() * cosAngle * cosAngle)
+		return false;
+
+	// Behind the apex the widened cone is too wide, there only a sphere around the apex counts
+	const float behind = -offset.DotProduct(axis);
+	if (behind > 0.0f && behind * behind >= distanceSquared * sinAngle * sinAngle)
+		return distanceSquared <= radius * radius;
+	return true;
+}
+
+}
+
+SpatialQueries::SpatialQueries(Context* context) :
+	Component(context)
+{
+}
+
+void SpatialQueries::OnSceneSet(Scene* scene)
+{
+	if (scene)
+	{
+		physicsWorld_ = scene->GetComponent<PhysicsWorld>();
+		SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(SpatialQueries, HandleScenePostUpdate));
+	}
+	else
+	{
+		physicsWorld_.Reset();
+		UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+	}
+}
+
+void SpatialQueries::QuerySphere(const Sphere& sphere, unsigned collisionMask, OverlapCallback callback)
+{
+	overlaps_.push_back(OverlapQuery{ sphere, Vector3::ZERO, 1.0f, 0.0f, collisionMask, ea::move(callback) });
+}
+
+void SpatialQueries::QueryCone(const Vector3& apex, const Vector3& direction, float angle, float range,
+	unsigned collisionMask, OverlapCallback callback)
+{
+	angle = Clamp(angle, MIN_CONE_ANGLE, MAX_CONE_ANGLE);
+	overlaps_.push_back(OverlapQuery{ Sphere(apex, range), direction.Normalized(), Cos(angle), Sin(angle),
+		collisionMask, ea::move(callback) });
+}
+
+void SpatialQueries::CastRays(ea::vector<QueryRay> rays, unsigned collisionMask, RaysCallback callback)
+{
+	rayQueries_.push_back(RayQuery{ ea::move(rays), collisionMask, ea::move(callback) });
+}
+
+void SpatialQueries::Explode(const Vector3& center, float radius, float impulse)
+{
+	QuerySphere(Sphere(center, radius), M_MAX_UNSIGNED, [center, radius, impulse](const ea::vector<RigidBody*>& bodies)
+	{
+		// Hits may turn zombies into ragdolls and remove their triggers, hold on to the found bodies weakly
+		ea::vector<WeakPtr<RigidBody> > targets;
+		for (RigidBody* body : bodies)
+			targets.emplace_back(body);
+
+		for (const WeakPtr<RigidBody>& body : targets)
+		{
+			if (!body)
+				continue;
+
+			const Vector3 offset = body->GetPosition() - center;
+			const float distance = offset.Length();
+			const float strength = impulse * Clamp(1.0f - distance / radius, 0.0f, 1.0f);
+			const Vector3 push = (distance > M_EPSILON ? offset / distance : Vector3::UP) * strength;
+
+			if (auto* createRagdoll = body->GetComponent<CreateRagdoll>())
+				createRagdoll->Hit(body->GetNode()->GetWorldPosition() + TRIGGER_CENTER, push);
+			else if (body->GetMass() > 0.0f && !body->IsTrigger())
+				body->ApplyImpulse(push);
+		}
+	});
+}
+
+void SpatialQueries::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+	if (!overlaps_.empty() || !rayQueries_.empty())
+		Resolve();
+}
+
+void SpatialQueries::Resolve()
+{
+	HiresTimer timer;
+
+	// Queries requested by the callbacks wait for the next batch
+	ea::vector<OverlapQuery> overlaps;
+	ea::vector<RayQuery> rayQueries;
+	overlaps.swap(overlaps_);
+	rayQueries.swap(rayQueries_);
+
+	numOverlaps_ = overlaps.size();
+	numRays_ = 0;
+	numCandidates_ = 0;
+
+	if (!overlaps.empty())
+	{
+		BoundingBox box;
+		unsigned collisionMask = 0;
+		for (const OverlapQuery& query : overlaps)
+		{
+			box.Merge(query.sphere_);
+			collisionMask |= query.collisionMask_;
+		}
+		GatherCandidates(box, collisionMask);
+
+		ea::vector<RigidBody*> bodies;
+		for (const OverlapQuery& query : overlaps)
+		{
+			bodies.clear();
+			ResolveOverlap(query, bodies);
+			query.callback_(bodies);
+		}
+		candidates_.clear();
+	}
+
+	// A box around rays spread over the arena would make every body a candidate of every ray, so each ray walks the
+	// broadphase along itself instead
+	ea::vector<PhysicsRaycastResult> results;
+	for (const RayQuery& query : rayQueries)
+	{
+		numRays_ += query.rays_.size();
+		results.resize(query.rays_.size());
+		for (unsigned i = 0; i < query.rays_.size(); ++i)
+			ResolveRay(query.rays_[i], query.collisionMask_, results[i]);
+		query.callback_(results);
+	}
+
+	resolveTime_ = timer.GetUSec(false);
+}
+
+void SpatialQueries::GatherCandidates(const BoundingBox& box, unsigned collisionMask)
+{
+	candidates_.clear();
+	if (!physicsWorld_ || !box.Defined())
+		return;
+
+	CandidateCollector collector(collisionMask);
+	physicsWorld_->GetWorld()->getBroadphase()->aabbTest(ToBtVector3(box.min_), ToBtVector3(box.max_), collector);
+
+	for (const btBroadphaseProxy* proxy : collector.proxies_)
+	{
+		// Only rigid bodies carry their component as user pointer
+		auto* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+		if (!object || object->getInternalType() != btCollisionObject::CO_RIGID_BODY || !object->getUserPointer())
+			continue;
+
+		auto* body = static_cast<RigidBody*>(object->getUserPointer());
+		candidates_.push_back(Candidate{ WeakPtr<RigidBody>(body),
+			BoundingBox(ToVector3(proxy->m_aabbMin), ToVector3(proxy->m_aabbMax)), (unsigned)proxy->m_collisionFilterGroup });
+	}
+	numCandidates_ += candidates_.size();
+}
+
+void SpatialQueries::ResolveOverlap(const OverlapQuery& query, ea::vector<RigidBody*>& bodies) const
+{
+	const bool cone = query.direction_ != Vector3::ZERO;
+	for (const Candidate& candidate : candidates_)
+	{
+		if (!candidate.body_ || !(candidate.collisionLayer_ & query.collisionMask_))
+			continue;
+
+		bool inside;
+		if (cone)
+		{
+			inside = SphereInCone(query.sphere_.center_, query.direction_, query.sinAngle_, query.cosAngle_,
+				query.sphere_.radius_, candidate.box_.Center(), candidate.box_.HalfSize().Length());
+		}
+		else
+		{
+			const Vector3 closest = VectorMax(candidate.box_.min_, VectorMin(query.sphere_.center_, candidate.box_.max_));
+			inside = (closest - query.sphere_.center_).LengthSquared() <= query.sphere_.radius_ * query.sphere_.radius_;
+		}
+
+		if (inside)
+			bodies.push_back(candidate.body_);
+	}
+}
+
+void SpatialQueries::ResolveRay(const QueryRay& ray, unsigned collisionMask, PhysicsRaycastResult& result)
+{
+	result = PhysicsRaycastResult();
+
+	if (!physicsWorld_ || (ray.end_ - ray.start_).LengthSquared() < M_EPSILON * M_EPSILON)
+		return;
+
+	// The broadphase tree picks the bodies whose box the segment passes through, Bullet tests their shapes and
+	// keeps the closest hit
+	RayTester tester(ToBtVector3(ray.start_), ToBtVector3(ray.end_), collisionMask);
+	physicsWorld_->GetWorld()->getBroadphase()->rayTest(tester.from_.getOrigin(), tester.to_.getOrigin(), tester);
+	numCandidates_ += tester.numTested_;
+
+	const btCollisionWorld::ClosestRayResultCallback& closest = tester.closest_;
+	if (closest.hasHit())
+	{
+		result.position_ = ToVector3(closest.m_hitPointWorld);
+		result.normal_ = ToVector3(closest.m_hitNormalWorld);
+		result.distance_ = (result.position_ - ray.start_).Length();
+		result.hitFraction_ = closest.m_closestHitFraction;
+		result.body_ = static_cast<RigidBody*>(closest.m_collisionObject->getUserPointer());
+	}
+}
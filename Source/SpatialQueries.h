@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Scene/Component.h>
+
+#include <EASTL/functional.h>
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Segment of a batched ray query.
+	struct QueryRay
+	{
+		/// Start point.
+		Vector3 start_;
+		/// End point.
+		Vector3 end_;
+	};
+
+	/// Bodies found by an overlap query.
+	using OverlapCallback = ea::function<void(const ea::vector<RigidBody*>& bodies)>;
+	/// Closest hit of every ray of a batch in request order, a null body where the segment is clear.
+	using RaysCallback = ea::function<void(const ea::vector<PhysicsRaycastResult>& results)>;
+
+	/// Collects the spatial queries of a frame, sphere overlaps, cones and batches of rays, and resolves them
+	/// together after the scene update. Overlaps walk the physics broadphase once for the bounding box of all of
+	/// them, then test the candidates' broadphase boxes per query. Rays each walk the broadphase tree along their
+	/// segment, as a box around rays spread over the arena would hold every body, and are tested exactly against
+	/// the bodies whose box they pass through. Callbacks run on the main thread and may change the scene; queries
+	/// they request are resolved the next frame.
+	class SpatialQueries : public Component
+	{
+		URHO3D_OBJECT(SpatialQueries, Component);
+
+	public:
+		/// Construct.
+		explicit SpatialQueries(Context* context);
+
+		/// Find the bodies on the collision layers of the mask whose box overlaps a sphere.
+		void QuerySphere(const Sphere& sphere, unsigned collisionMask, OverlapCallback callback);
+		/// Find the bodies on the collision layers of the mask within a cone of a half angle in degrees and a range.
+		void QueryCone(const Vector3& apex, const Vector3& direction, float angle, float range, unsigned collisionMask,
+			OverlapCallback callback);
+		/// Find the first body on the collision layers of the mask along every segment.
+		void CastRays(ea::vector<QueryRay> rays, unsigned collisionMask, RaysCallback callback);
+		/// Push every dynamic body within the radius away from the center, the impulse fading to zero at the edge,
+		/// and hit the zombies there.
+		void Explode(const Vector3& center, float radius, float impulse);
+
+		/// Resolve the requested queries now.
+		void Resolve();
+
+		/// Return number of overlap queries resolved in the last batch.
+		unsigned GetNumOverlaps() const { return numOverlaps_; }
+		/// Return number of rays resolved in the last batch.
+		unsigned GetNumRays() const { return numRays_; }
+		/// Return number of broadphase candidates of the last batch, overlap candidates and bodies tested by rays.
+		unsigned GetNumCandidates() const { return numCandidates_; }
+		/// Return time of the last batch in microseconds, callbacks included.
+		long long GetResolveTime() const { return resolveTime_; }
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Requested sphere or cone overlap.
+		struct OverlapQuery
+		{
+			/// Sphere, or the apex and range of a cone.
+			Sphere sphere_;
+			/// Cone axis, zero for a sphere.
+			Vector3 direction_;
+			/// Cosine of the cone half angle.
+			float cosAngle_;
+			/// Sine of the cone half angle.
+			float sinAngle_;
+			/// Collision layers to find.
+			unsigned collisionMask_;
+			/// Result receiver.
+			OverlapCallback callback_;
+		};
+
+		/// Requested ray batch.
+		struct RayQuery
+		{
+			/// Segments.
+			ea::vector<QueryRay> rays_;
+			/// Collision layers to hit.
+			unsigned collisionMask_;
+			/// Result receiver.
+			RaysCallback callback_;
+		};
+
+		/// Body found by the broadphase.
+		struct Candidate
+		{
+			/// Body, checked before use since callbacks may remove it.
+			WeakPtr<RigidBody> body_;
+			/// Broadphase box.
+			BoundingBox box_;
+			/// Collision layer.
+			unsigned collisionLayer_;
+		};
+
+		/// Handle scene post-update.
+		void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+		/// Gather the broadphase bodies on the collision layers whose box overlaps a box.
+		void GatherCandidates(const BoundingBox& box, unsigned collisionMask);
+		/// Resolve an overlap query against the candidates.
+		void ResolveOverlap(const OverlapQuery& query, ea::vector<RigidBody*>& bodies) const;
+		/// Resolve a ray against the bodies along it.
+		void ResolveRay(const QueryRay& ray, unsigned collisionMask, PhysicsRaycastResult& result);
+
+		/// Physics world of the scene.
+		WeakPtr<PhysicsWorld> physicsWorld_;
+		/// Requested overlaps.
+		ea::vector<OverlapQuery> overlaps_;
+		/// Requested ray batches.
+		ea::vector<RayQuery> rayQueries_;
+		/// Candidates of the batch being resolved.
+		ea::vector<Candidate> candidates_;
+		/// Overlap queries of the last batch.
+		unsigned numOverlaps_ = 0;
+		/// Rays of the last batch.
+		unsigned numRays_ = 0;
+		/// Broadphase candidates of the last batch.
+		unsigned numCandidates_ = 0;
+		/// Time of the last batch.
+		long long resolveTime_ = 0;
+	};
+}
@@ -0,0 +1,374 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/ResourceEvents.h>
+#include <Urho3D/Resource/XMLFile.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "WorldStreamer.h"
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Name of the nodes marking spawn points in sector files and generated sectors.
+const char* SPAWN_POINT_NAME = "SpawnPoint";
+/// Static boxes in a generated sector at most.
+const unsigned MAX_SECTOR_PROPS = 4;
+/// Spawn points in a generated sector.
+const unsigned SECTOR_SPAWN_POINTS = 2;
+/// Estimated memory of a component with its renderer or physics counterpart.
+const unsigned COMPONENT_MEMORY = 1024;
+
+/// Xorshift generator, so a generated sector looks the same every time it streams in and the global random
+/// sequence of the simulation is left alone.
+class SectorRandom
+{
+public:
+	explicit SectorRandom(unsigned seed) :
+		state_(seed * 2654435761u + 1u)
+	{
+	}
+
+	/// Return a value between min and max.
+	float Range(float min, float max)
+	{
+		state_ ^= state_ << 13;
+		state_ ^= state_ >> 17;
+		state_ ^= state_ << 5;
+		return min + (max - min) * (state_ & 0xffffff) / 16777216.0f;
+	}
+
+private:
+	unsigned state_;
+};
+
+}
+
+WorldStreamer::WorldStreamer(Context* context) :
+	Component(context)
+{
+}
+
+void WorldStreamer::OnSceneSet(Scene* scene)
+{
+	if (scene)
+	{
+		SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(WorldStreamer, HandleUpdate));
+		SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(WorldStreamer, HandleBackgroundLoaded));
+	}
+	else
+	{
+		UnsubscribeFromEvent(E_UPDATE);
+		UnsubscribeFromEvent(E_RESOURCEBACKGROUNDLOADED);
+		UnloadAll();
+	}
+}
+
+void WorldStreamer::SetGrid(unsigned numSectors, float sectorSize)
+{
+	UnloadAll();
+	numSectors_ = numSectors;
+	sectorSize_ = sectorSize;
+	sectors_.clear();
+	sectors_.resize(numSectors * numSectors);
+	SetPinnedRegion(pinnedRegion_);
+}
+
+void WorldStreamer::SetPinnedRegion(const BoundingBox& region)
+{
+	pinnedRegion_ = region;
+
+	const float halfSize = sectorSize_ * 0.5f;
+	for (unsigned i = 0; i < sectors_.size(); ++i)
+	{
+		const Vector3 center = GetSectorCenter(i);
+		sectors_[i].pinned_ = region.Defined() &&
+			region.min_.x_ <= center.x_ + halfSize && region.max_.x_ >= center.x_ - halfSize &&
+			region.min_.z_ <= center.z_ + halfSize && region.max_.z_ >= center.z_ - halfSize;
+	}
+}
+
+BoundingBox WorldStreamer::GetWorldBounds() const
+{
+	const float halfExtent = numSectors_ * sectorSize_ * 0.5f;
+	return BoundingBox(Vector3(-halfExtent, -sectorSize_, -halfExtent), Vector3(halfExtent, sectorSize_, halfExtent));
+}
+
+void WorldStreamer::GetSpawnPoints(ea::vector<Vector3>& points) const
+{
+	points.clear();
+	for (const WorldSector& sector : sectors_)
+		points.insert(points.end(), sector.spawnPoints_.begin(), sector.spawnPoints_.end());
+}
+
+void WorldStreamer::HandleUpdate(StringHash eventType, VariantMap& eventData)
+{
+	if (!focus_ || sectors_.empty())
+		return;
+
+	const Vector3 focusPosition = focus_->GetWorldPosition();
+	const float halfExtent = numSectors_ * sectorSize_ * 0.5f;
+	const int focusX = Clamp(FloorToInt((focusPosition.x_ + halfExtent) / sectorSize_), 0, (int)numSectors_ - 1);
+	const int focusZ = Clamp(FloorToInt((focusPosition.z_ + halfExtent) / sectorSize_), 0, (int)numSectors_ - 1);
+
+	// One sector of hysteresis, so moving along a sector border does not load and unload the same row
+	candidates_.clear();
+	for (unsigned i = 0; i < sectors_.size(); ++i)
+	{
+		const WorldSector& sector = sectors_[i];
+		const unsigned distance = GetDistance(i, focusX, focusZ);
+		if (sector.state_ != SECTOR_UNLOADED && !sector.pinned_ && distance > loadRadius_ + 1)
+			UnloadSector(i);
+		else if (sector.state_ != SECTOR_RESIDENT && (sector.pinned_ || distance <= loadRadius_))
+			candidates_.push_back(i);
+	}
+
+	// Pinned sectors first, then nearest first
+	ea::sort(candidates_.begin(), candidates_.end(), [&](unsigned lhs, unsigned rhs)
+	{
+		const unsigned lhsDistance = sectors_[lhs].pinned_ ? 0 : GetDistance(lhs, focusX, focusZ) + 1;
+		const unsigned rhsDistance = sectors_[rhs].pinned_ ? 0 : GetDistance(rhs, focusX, focusZ) + 1;
+		return lhsDistance < rhsDistance;
+	});
+
+	bool instantiated = false;
+	for (unsigned index : candidates_)
+	{
+		if (sectors_[index].state_ == SECTOR_UNLOADED)
+			RequestSector(index);
+		if (sectors_[index].state_ != SECTOR_READY || instantiated)
+			continue;
+
+		// Over the budget a farther resident sector gives way, the focus sector and its neighbours always load
+		const unsigned distance = GetDistance(index, focusX, focusZ);
+		if (memoryUse_ >= memoryBudget_ && !sectors_[index].pinned_ && distance > 1)
+		{
+			unsigned farthest = M_MAX_UNSIGNED;
+			unsigned farthestDistance = distance;
+			for (unsigned i = 0; i < sectors_.size(); ++i)
+			{
+				const unsigned residentDistance = GetDistance(i, focusX, focusZ);
+				if (sectors_[i].state_ == SECTOR_RESIDENT && !sectors_[i].pinned_ && residentDistance > farthestDistance)
+				{
+					farthest = i;
+					farthestDistance = residentDistance;
+				}
+			}
+			if (farthest == M_MAX_UNSIGNED)
+				continue;
+			UnloadSector(farthest);
+		}
+
+		InstantiateSector(index);
+		instantiated = true;
+	}
+}
+
+void WorldStreamer::HandleBackgroundLoaded(StringHash eventType, VariantMap& eventData)
+{
+	using namespace ResourceBackgroundLoaded;
+
+	const ea::string& name = eventData[P_RESOURCENAME].GetString();
+	auto it = loadingFiles_.find(name);
+	if (it == loadingFiles_.end())
+		return;
+
+	WorldSector& sector = sectors_[it->second];
+	loadingFiles_.erase(it);
+
+	// The focus moved on while the file was read
+	if (sector.state_ != SECTOR_LOADING)
+	{
+		GetSubsystem<ResourceCache>()->ReleaseResource(XMLFile::GetTypeStatic(), name);
+		return;
+	}
+
+	if (eventData[P_SUCCESS].GetBool())
+		sector.source_ = static_cast<XMLFile*>(eventData[P_RESOURCE].GetPtr());
+	else
+		URHO3D_LOGWARNING("Failed to load sector {}, generating it instead", name);
+	sector.state_ = SECTOR_READY;
+}
+
+void WorldStreamer::RequestSector(unsigned index)
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+	WorldSector& sector = sectors_[index];
+	const ea::string fileName = GetSectorFileName(index);
+
+	sector.source_ = cache->GetExistingResource<XMLFile>(fileName);
+	if (loadingFiles_.find(fileName) != loadingFiles_.end())
+		sector.state_ = SECTOR_LOADING;
+	else if (sector.source_)
+		sector.state_ = SECTOR_READY;
+	else if (cache->Exists(fileName) && cache->BackgroundLoadResource<XMLFile>(fileName))
+	{
+		loadingFiles_[fileName] = index;
+		sector.state_ = SECTOR_LOADING;
+	}
+	else
+		sector.state_ = SECTOR_READY;
+}
+
+void WorldStreamer::InstantiateSector(unsigned index)
+{
+	WorldSector& sector = sectors_[index];
+	const Vector3 center = GetSectorCenter(index);
+
+	// Streamed content is recreated on every client, it is not part of the replicated state
+	if (sector.source_)
+		sector.node_ = GetScene()->InstantiateXML(sector.source_->GetRoot(), center, Quaternion::IDENTITY, LOCAL);
+	if (!sector.node_)
+	{
+		sector.node_ = GetScene()->CreateChild(Format("Sector_{}_{}", index % numSectors_, index / numSectors_), LOCAL);
+		sector.node_->SetPosition(center);
+		GenerateSector(index, sector.node_);
+	}
+
+	ea::vector<Node*> nodes;
+	sector.node_->GetChildren(nodes, true);
+	nodes.push_back(sector.node_);
+
+	unsigned numComponents = 0;
+	for (Node* node : nodes)
+	{
+		numComponents += node->GetNumComponents();
+		if (node->GetName() == SPAWN_POINT_NAME)
+			sector.spawnPoints_.push_back(node->GetWorldPosition());
+	}
+
+	sector.memoryUse_ = nodes.size() * sizeof(Node) + numComponents * COMPONENT_MEMORY +
+		(sector.source_ ? sector.source_->GetMemoryUse() : 0);
+	sector.state_ = SECTOR_RESIDENT;
+	memoryUse_ += sector.memoryUse_;
+	++numResident_;
+
+	URHO3D_LOGDEBUG("Sector {} in, {} resident, {} KB", sector.node_->GetName(), numResident_, memoryUse_ / 1024);
+}
+
+void WorldStreamer::GenerateSector(unsigned index, Node* node) const
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+	Model* boxModel = cache->GetResource<Model>("Models/Box.mdl");
+
+	// Floor tile with its top at zero Y, as the single floor box of the unstreamed arena
+	Node* floorNode = node->CreateChild("Floor", LOCAL);
+	floorNode->SetPosition(Vector3(0.0f, -0.5f, 0.0f));
+	floorNode->SetScale(Vector3(sectorSize_, 1.0f, sectorSize_));
+	auto* floorObject = floorNode->CreateComponent<StaticModel>(LOCAL);
+	floorObject->SetModel(boxModel);
+	floorObject->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
+	floorNode->CreateComponent<RigidBody>(LOCAL)->SetRollingFriction(0.15f);
+	floorNode->CreateComponent<CollisionShape>(LOCAL)->SetBox(Vector3::ONE);
+
+	SectorRandom random(index);
+	const float range = sectorSize_ * 0.4f;
+
+	// Keep the pinned arena clear for the zombies
+	if (!sectors_[index].pinned_)
+	{
+		const unsigned numProps = (unsigned)random.Range(0.0f, MAX_SECTOR_PROPS + 1.0f);
+		for (unsigned i = 0; i < numProps; ++i)
+		{
+			const Vector3 size(random.Range(1.0f, 4.0f), random.Range(1.0f, 4.0f), random.Range(1.0f, 4.0f));
+			Node* propNode = node->CreateChild("Prop", LOCAL);
+			propNode->SetPosition(Vector3(random.Range(-range, range), size.y_ * 0.5f, random.Range(-range, range)));
+			propNode->SetRotation(Quaternion(random.Range(0.0f, 360.0f), Vector3::UP));
+			propNode->SetScale(size);
+			auto* propObject = propNode->CreateComponent<StaticModel>(LOCAL);
+			propObject->SetModel(boxModel);
+			propObject->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
+			propObject->SetCastShadows(true);
+			propObject->SetOccluder(true);
+			propNode->CreateComponent<RigidBody>(LOCAL);
+			propNode->CreateComponent<CollisionShape>(LOCAL)->SetBox(Vector3::ONE);
+		}
+	}
+
+	for (unsigned i = 0; i < SECTOR_SPAWN_POINTS; ++i)
+	{
+		Node* spawnNode = node->CreateChild(SPAWN_POINT_NAME, LOCAL);
+		spawnNode->SetPosition(Vector3(random.Range(-range, range), 0.0f, random.Range(-range, range)));
+	}
+}
+
+void WorldStreamer::UnloadSector(unsigned index)
+{
+	WorldSector& sector = sectors_[index];
+	if (sector.state_ == SECTOR_RESIDENT)
+	{
+		memoryUse_ -= sector.memoryUse_;
+		--numResident_;
+	}
+
+	if (sector.node_)
+	{
+		sector.node_->Remove();
+		sector.node_.Reset();
+	}
+	if (sector.source_)
+	{
+		// Drop the parsed file too, the cache keeps it otherwise
+		sector.source_.Reset();
+		GetSubsystem<ResourceCache>()->ReleaseResource(XMLFile::GetTypeStatic(), GetSectorFileName(index));
+	}
+
+	sector.spawnPoints_.clear();
+	sector.memoryUse_ = 0;
+	sector.state_ = SECTOR_UNLOADED;
+}
+
+void WorldStreamer::UnloadAll()
+{
+	for (unsigned i = 0; i < sectors_.size(); ++i)
+		UnloadSector(i);
+}
+
+ea::string WorldStreamer::GetSectorFileName(unsigned index) const
+{
+	return Format("Sectors/Sector_{}_{}.xml", index % numSectors_, index / numSectors_);
+}
+
+Vector3 WorldStreamer::GetSectorCenter(unsigned index) const
+{
+	const float halfExtent = numSectors_ * sectorSize_ * 0.5f;
+	return Vector3((index % numSectors_ + 0.5f) * sectorSize_ - halfExtent, 0.0f,
+		(index / numSectors_ + 0.5f) * sectorSize_ - halfExtent);
+}
+
+unsigned WorldStreamer::GetDistance(unsigned index, int focusX, int focusZ) const
+{
+	return (unsigned)Max(Abs((int)(index % numSectors_) - focusX), Abs((int)(index / numSectors_) - focusZ));
+}
@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class XMLFile;
+}
+
+namespace MonsterDolls
+{
+	/// Residency state of a world sector.
+	enum SectorState
+	{
+		SECTOR_UNLOADED = 0,
+		/// Sector file is being read by the resource cache worker.
+		SECTOR_LOADING,
+		/// Content is ready to be instantiated.
+		SECTOR_READY,
+		SECTOR_RESIDENT
+	};
+
+	/// One cell of the world grid with its floor, static geometry, collision and spawn points.
+	struct WorldSector
+	{
+		/// Residency state.
+		SectorState state_ = SECTOR_UNLOADED;
+		/// Root node of the instantiated content.
+		SharedPtr<Node> node_;
+		/// Loaded sector file, null for generated sectors.
+		SharedPtr<XMLFile> source_;
+		/// World positions of the spawn points.
+		ea::vector<Vector3> spawnPoints_;
+		/// Estimated memory use of the instantiated content.
+		unsigned memoryUse_ = 0;
+		/// Sector overlaps the pinned region and never unloads.
+		bool pinned_ = false;
+	};
+
+	/// Divides the world into a square grid of sectors centered on the origin and keeps only the ones around the
+	/// focus node in the scene. Sector content comes from Sectors/Sector_<x>_<z>.xml when that file exists, read in
+	/// the background by the resource cache, and is generated otherwise. At most one sector is instantiated per
+	/// frame, sectors further away than the unload radius are removed, and the resident sectors are kept within a
+	/// memory budget by dropping the farthest ones first.
+	class WorldStreamer : public Component
+	{
+		URHO3D_OBJECT(WorldStreamer, Component);
+
+	public:
+		/// Construct.
+		explicit WorldStreamer(Context* context);
+
+		/// Set number of sectors along each side and the sector size in world units. Unloads everything.
+		void SetGrid(unsigned numSectors, float sectorSize);
+		/// Set node the sectors are streamed around.
+		void SetFocus(Node* focus) { focus_ = focus; }
+		/// Set region whose sectors stay resident, such as the arena the zombies walk in.
+		void SetPinnedRegion(const BoundingBox& region);
+		/// Set radius in sectors that is loaded around the focus, sectors unload one sector further out.
+		void SetLoadRadius(unsigned radius) { loadRadius_ = radius; }
+		/// Set memory budget of the resident sectors in bytes.
+		void SetMemoryBudget(unsigned bytes) { memoryBudget_ = bytes; }
+
+		/// Return bounds of the whole world.
+		BoundingBox GetWorldBounds() const;
+		/// Return number of resident sectors.
+		unsigned GetNumResidentSectors() const { return numResident_; }
+		/// Return estimated memory use of the resident sectors.
+		unsigned GetMemoryUse() const { return memoryUse_; }
+		/// Return spawn points of the resident sectors.
+		void GetSpawnPoints(ea::vector<Vector3>& points) const;
+
+	protected:
+		/// Handle scene being assigned.
+		void OnSceneSet(Scene* scene) override;
+
+	private:
+		/// Handle the frame update.
+		void HandleUpdate(StringHash eventType, VariantMap& eventData);
+		/// Handle a sector file finishing loading.
+		void HandleBackgroundLoaded(StringHash eventType, VariantMap& eventData);
+		/// Start reading a sector file, or mark the sector ready for generation.
+		void RequestSector(unsigned index);
+		/// Create the sector content in the scene.
+		void InstantiateSector(unsigned index);
+		/// Fill a sector without a file with a floor tile, a few static boxes and spawn points.
+		void GenerateSector(unsigned index, Node* node) const;
+		/// Remove the sector content and release its file.
+		void UnloadSector(unsigned index);
+		/// Remove all sectors.
+		void UnloadAll();
+
+		/// Return sector file name.
+		ea::string GetSectorFileName(unsigned index) const;
+		/// Return world center of a sector.
+		Vector3 GetSectorCenter(unsigned index) const;
+		/// Return grid distance of a sector from the focus sector.
+		unsigned GetDistance(unsigned index, int focusX, int focusZ) const;
+
+		/// Sectors in row order.
+		ea::vector<WorldSector> sectors_;
+		/// Sector index of every file being read.
+		ea::unordered_map<ea::string, unsigned> loadingFiles_;
+		/// Candidate sectors scratch list.
+		ea::vector<unsigned> candidates_;
+		/// Node the sectors are streamed around.
+		WeakPtr<Node> focus_;
+		/// Region whose sectors stay resident.
+		BoundingBox pinnedRegion_;
+		/// Sectors along each side.
+		unsigned numSectors_ = 0;
+		/// Sector size in world units.
+		float sectorSize_ = 50.0f;
+		/// Radius in sectors loaded around the focus.
+		unsigned loadRadius_ = 3;
+		/// Memory budget of the resident sectors.
+		unsigned memoryBudget_ = 2 * 1024 * 1024;
+		/// Estimated memory use of the resident sectors.
+		unsigned memoryUse_ = 0;
+		/// Number of resident sectors.
+		unsigned numResident_ = 0;
+	};
+}
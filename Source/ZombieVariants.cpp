@@ -0,0 +1,273 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "ZombieVariants.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+namespace
+{
+
+/// Sample rate of retargeted animations.
+const float RETARGET_FPS = 30.0f;
+
+/// Return rotation of an animation track at a time.
+Quaternion SampleRotation(const AnimationTrack& track, float time)
+{
+	const unsigned numKeyFrames = track.GetNumKeyFrames();
+	unsigned index = 0;
+	while (index + 1 < numKeyFrames && track.GetKeyFrame(index + 1)->time_ <= time)
+		++index;
+
+	const AnimationKeyFrame* keyFrame = track.GetKeyFrame(index);
+	if (index + 1 >= numKeyFrames)
+		return keyFrame->rotation_;
+
+	const AnimationKeyFrame* nextKeyFrame = track.GetKeyFrame(index + 1);
+	const float span = nextKeyFrame->time_ - keyFrame->time_;
+	const float t = span > 0.0f ? Clamp((time - keyFrame->time_) / span, 0.0f, 1.0f) : 0.0f;
+	return keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+}
+
+/// Return model space rotations of a skeleton in bind pose, or posed by the animation at a time.
+void GetModelRotations(const Skeleton& skeleton, const Animation* animation, float time, ea::vector<Quaternion>& rotations)
+{
+	const unsigned numBones = skeleton.GetNumBones();
+	rotations.resize(numBones);
+
+	// Parents come before their children in the bone list
+	for (unsigned i = 0; i < numBones; ++i)
+	{
+		const Bone* bone = skeleton.GetBone(i);
+
+		Quaternion local = bone->initialRotation_;
+		if (animation)
+		{
+			const AnimationTrack* track = animation->GetTrack(bone->nameHash_);
+			if (track && (track->channelMask_ & CHANNEL_ROTATION) && track->GetNumKeyFrames())
+				local = SampleRotation(*track, time);
+		}
+
+		const unsigned parent = bone->parentIndex_;
+		rotations[i] = parent < i ? rotations[parent] * local : local;
+	}
+}
+
+/// Return bone name without a rig prefix such as "mixamorig:".
+ea::string StripRigPrefix(const ea::string& name)
+{
+	const unsigned separator = name.find(':');
+	return separator == ea::string::npos ? name : name.substr(separator + 1);
+}
+
+}
+
+ZombieVariants::ZombieVariants(Context* context) :
+	Object(context)
+{
+}
+
+void ZombieVariants::AddBoneMapping(const ea::string& sourceBone, const ea::string& baseBone)
+{
+	boneMap_[sourceBone] = baseBone;
+}
+
+void ZombieVariants::AddMixamoToBipedMapping()
+{
+	static const char* mapping[][2] =
+	{
+		{ "Hips", "Bip01_Pelvis" },
+		{ "Spine", "Bip01_Spine" },
+		{ "Spine1", "Bip01_Spine1" },
+		{ "Spine2", "Bip01_Spine2" },
+		{ "Neck", "Bip01_Neck" },
+		{ "Head", "Bip01_Head" },
+		{ "LeftShoulder", "Bip01_L_Clavicle" },
+		{ "LeftArm", "Bip01_L_UpperArm" },
+		{ "LeftForeArm", "Bip01_L_Forearm" },
+		{ "LeftHand", "Bip01_L_Hand" },
+		{ "RightShoulder", "Bip01_R_Clavicle" },
+		{ "RightArm", "Bip01_R_UpperArm" },
+		{ "RightForeArm", "Bip01_R_Forearm" },
+		{ "RightHand", "Bip01_R_Hand" },
+		{ "LeftUpLeg", "Bip01_L_Thigh" },
+		{ "LeftLeg", "Bip01_L_Calf" },
+		{ "LeftFoot", "Bip01_L_Foot" },
+		{ "LeftToeBase", "Bip01_L_Toe0" },
+		{ "RightUpLeg", "Bip01_R_Thigh" },
+		{ "RightLeg", "Bip01_R_Calf" },
+		{ "RightFoot", "Bip01_R_Foot" },
+		{ "RightToeBase", "Bip01_R_Toe0" },
+	};
+
+	for (const auto& pair : mapping)
+		AddBoneMapping(pair[0], pair[1]);
+}
+
+unsigned ZombieVariants::AddVariant(Model* model, Animation* animation)
+{
+	Variant variant;
+	if (!model || MatchesBaseRig(model))
+	{
+		variant.model_ = model != baseModel_ ? model : nullptr;
+		variant.animation_ = animation;
+	}
+	else
+		variant.animation_ = Retarget(model, animation);
+
+	variants_.push_back(variant);
+	return variants_.size() - 1;
+}
+
+void ZombieVariants::Apply(Node* zombie, unsigned variant, float startTime) const
+{
+	if (variant >= variants_.size())
+		return;
+
+	const Variant& selected = variants_[variant];
+
+	// Matching rigs keep the bone nodes, only the mesh and its skinning change
+	auto* modelObject = zombie->GetComponent<AnimatedModel>();
+	if (selected.model_ && modelObject && modelObject->GetModel() != selected.model_)
+		modelObject->SetModel(selected.model_, false);
+
+	if (selected.animation_)
+	{
+		if (auto* animationController = zombie->GetComponent<AnimationController>())
+			animationController->PlayNewExclusive(AnimationParameters{ selected.animation_ }.Looped().Time(startTime));
+	}
+}
+
+bool ZombieVariants::MatchesBaseRig(Model* model) const
+{
+	if (!baseModel_)
+		return false;
+
+	const Skeleton& base = baseModel_->GetSkeleton();
+	const Skeleton& skeleton = model->GetSkeleton();
+	if (base.GetNumBones() != skeleton.GetNumBones())
+		return false;
+
+	for (unsigned i = 0; i < base.GetNumBones(); ++i)
+	{
+		if (base.GetBone(i)->nameHash_ != skeleton.GetBone(i)->nameHash_ ||
+			base.GetBone(i)->parentIndex_ != skeleton.GetBone(i)->parentIndex_)
+			return false;
+	}
+	return true;
+}
+
+SharedPtr<Animation> ZombieVariants::Retarget(Model* model, Animation* animation) const
+{
+	if (!baseModel_ || !animation)
+		return nullptr;
+
+	const Skeleton& source = model->GetSkeleton();
+	const Skeleton& target = baseModel_->GetSkeleton();
+
+	// Source bone of every base bone, if mapped
+	ea::vector<unsigned> sourceIndices(target.GetNumBones(), M_MAX_UNSIGNED);
+	unsigned numMapped = 0;
+	for (unsigned i = 0; i < source.GetNumBones(); ++i)
+	{
+		auto it = boneMap_.find(StripRigPrefix(source.GetBone(i)->name_));
+		if (it == boneMap_.end())
+			continue;
+
+		const unsigned targetIndex = target.GetBoneIndex(it->second);
+		if (targetIndex != M_MAX_UNSIGNED)
+		{
+			sourceIndices[targetIndex] = i;
+			++numMapped;
+		}
+	}
+
+	if (!numMapped)
+	{
+		URHO3D_LOGWARNING("No bones of " + model->GetName() + " map onto " + baseModel_->GetName());
+		return nullptr;
+	}
+
+	ea::vector<Quaternion> sourceBind;
+	ea::vector<Quaternion> targetBind;
+	GetModelRotations(source, nullptr, 0.0f, sourceBind);
+	GetModelRotations(target, nullptr, 0.0f, targetBind);
+
+	auto retargeted = MakeShared<Animation>(context_);
+	retargeted->SetName(animation->GetName() + "#" + baseModel_->GetName());
+	retargeted->SetLength(animation->GetLength());
+
+	// Rotations only, the base skeleton keeps its own proportions and the clip plays in place
+	ea::vector<AnimationTrack*> tracks(target.GetNumBones(), nullptr);
+	for (unsigned i = 0; i < target.GetNumBones(); ++i)
+	{
+		if (sourceIndices[i] == M_MAX_UNSIGNED)
+			continue;
+		tracks[i] = retargeted->CreateTrack(target.GetBone(i)->name_);
+		tracks[i]->channelMask_ = CHANNEL_ROTATION;
+	}
+
+	ea::vector<Quaternion> sourcePose;
+	ea::vector<Quaternion> targetPose(target.GetNumBones());
+	const unsigned numSamples = Max(CeilToInt(animation->GetLength() * RETARGET_FPS), 1) + 1;
+	for (unsigned n = 0; n < numSamples; ++n)
+	{
+		const float time = Min(n / RETARGET_FPS, animation->GetLength());
+		GetModelRotations(source, animation, time, sourcePose);
+
+		for (unsigned i = 0; i < target.GetNumBones(); ++i)
+		{
+			const Bone* bone = target.GetBone(i);
+			const unsigned parent = bone->parentIndex_;
+			const Quaternion parentPose = parent < i ? targetPose[parent] : Quaternion::IDENTITY;
+
+			// Mapped bones turn away from their bind pose as much as the source bone does in model space,
+			// unmapped bones stay in bind pose relative to their parent
+			const unsigned sourceIndex = sourceIndices[i];
+			if (sourceIndex == M_MAX_UNSIGNED)
+			{
+				targetPose[i] = parentPose * bone->initialRotation_;
+				continue;
+			}
+
+			targetPose[i] = sourcePose[sourceIndex] * sourceBind[sourceIndex].Inverse() * targetBind[i];
+
+			AnimationKeyFrame keyFrame;
+			keyFrame.time_ = time;
+			keyFrame.position_ = bone->initialPosition_;
+			keyFrame.rotation_ = (parentPose.Inverse() * targetPose[i]).Normalized();
+			keyFrame.scale_ = bone->initialScale_;
+			tracks[i]->AddKeyFrame(keyFrame);
+		}
+	}
+
+	GetSubsystem<ResourceCache>()->AddManualResource(retargeted);
+	return retargeted;
+}
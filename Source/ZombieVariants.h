@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/Model.h>
+
+#include <EASTL/unordered_map.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Node;
+}
+
+namespace MonsterDolls
+{
+	/// Mesh and animation sets a zombie can switch between without rebuilding its skeleton. Variants are prepared
+	/// against the base model the zombies are created with: a variant whose rig matches the base rig bone by bone
+	/// swaps the mesh on the existing bone nodes, a variant with a different rig keeps the base mesh and plays its
+	/// animation retargeted onto the base skeleton through a bone name map.
+	class ZombieVariants : public Object
+	{
+		URHO3D_OBJECT(ZombieVariants, Object);
+
+	public:
+		/// Construct.
+		explicit ZombieVariants(Context* context);
+
+		/// Set the model zombies are created with.
+		void SetBaseModel(Model* model) { baseModel_ = model; }
+		/// Map a bone of another rig onto a base rig bone for retargeting.
+		void AddBoneMapping(const ea::string& sourceBone, const ea::string& baseBone);
+		/// Map the Mixamo rig onto the 3ds Max biped rig of Jack.
+		void AddMixamoToBipedMapping();
+		/// Prepare a variant. Retargeting happens here, so Apply never has to. Return variant index.
+		unsigned AddVariant(Model* model, Animation* animation);
+		/// Switch a zombie to a variant.
+		void Apply(Node* zombie, unsigned variant, float startTime = 0.0f) const;
+
+		/// Return whether a variant uses its own mesh.
+		bool HasOwnModel(unsigned variant) const { return variants_[variant].model_ != nullptr; }
+
+	private:
+		/// Prepared variant.
+		struct Variant
+		{
+			/// Mesh with a rig matching the base rig, or null to keep the base mesh.
+			SharedPtr<Model> model_;
+			/// Animation playable on the base skeleton.
+			SharedPtr<Animation> animation_;
+		};
+
+		/// Return whether a model has the same bones as the base model.
+		bool MatchesBaseRig(Model* model) const;
+		/// Create the animation for the base skeleton from an animation of a model with another rig.
+		SharedPtr<Animation> Retarget(Model* model, Animation* animation) const;
+
+		/// Base model.
+		SharedPtr<Model> baseModel_;
+		/// Base bone name of every mapped source bone name.
+		ea::unordered_map<ea::string, ea::string> boneMap_;
+		/// Prepared variants.
+		ea::vector<Variant> variants_;
+	};
+}
@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "AnimationCooker.h"
+#include "Ragdolls.h"
+#include "Sample.h"
+
+#include <Urho3D/DebugNew.h>
+
+using namespace MonsterDolls;
+
+URHO3D_DEFINE_APPLICATION_MAIN(AnimationCooker);
+
+namespace
+{
+
+/// Clips cooked when none is given, missing ones are skipped.
+const char* DEFAULT_CLIPS[] =
+{
+	"Models/Jack_Walk.ani",
+	"Models/MeleeAttack.fbx.d/Animations/mixamo.com.ani",
+	"Models/Zombie Running.fbx.d/Animations/mixamo.com.ani"
+};
+
+}
+
+AnimationCooker::AnimationCooker(Context* context) :
+	Application(context)
+{
+}
+
+void AnimationCooker::Setup()
+{
+	engineParameters_[EP_APPLICATION_NAME] = "Monster Dolls Animation Cooker";
+	engineParameters_[EP_HEADLESS] = true;
+	engineParameters_[EP_SOUND] = false;
+	engineParameters_[EP_LOG_NAME] = "";
+	engineParameters_[EP_RESOURCE_PATHS] = "Data;CoreData";
+	engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";..;../..";
+}
+
+void AnimationCooker::Start()
+{
+	Ragdolls::RegisterComponents(context_);
+	ParseArguments();
+
+	unsigned failed = 0;
+	for (const ea::string& animationName : animationNames_)
+		failed += !Cook(animationName);
+
+	exitCode_ = failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	engine_->Exit();
+}
+
+void AnimationCooker::ParseArguments()
+{
+	// zombie-dolls-anim-cook [clip.ani ...] [--rate 30] [--tolerance 0.5] [--translation-tolerance 0.002]
+	//     [--bone-tolerance Bip01_Pelvis=0.25,Bip01_Spine1=0.5]
+	settings_.sampleRate_ = ToFloat(GetArgumentValue("--rate", "30"));
+	settings_.rotationTolerance_ = ToFloat(GetArgumentValue("--tolerance", "0.5"));
+	settings_.translationTolerance_ = ToFloat(GetArgumentValue("--translation-tolerance", "0.002"));
+
+	// The root and spine move everything below them, their error shows the most
+	settings_.boneToleranceScales_["Bip01_Pelvis"] = 0.25f;
+	settings_.boneToleranceScales_["Bip01_Spine1"] = 0.5f;
+	for (const ea::string& entry : GetArgumentValue("--bone-tolerance").split(','))
+	{
+		const ea::vector<ea::string> parts = entry.split('=');
+		if (parts.size() == 2)
+			settings_.boneToleranceScales_[parts[0]] = ToFloat(parts[1]);
+	}
+
+	const ea::vector<ea::string>& arguments = GetArguments();
+	for (unsigned i = 0; i < arguments.size(); ++i)
+	{
+		if (arguments[i].find("--") == 0)
+			++i;
+		else
+			animationNames_.push_back(arguments[i]);
+	}
+
+	if (animationNames_.empty())
+	{
+		for (const char* clip : DEFAULT_CLIPS)
+		{
+			if (GetSubsystem<ResourceCache>()->Exists(clip))
+				animationNames_.push_back(clip);
+		}
+	}
+}
+
+bool AnimationCooker::Cook(const ea::string& animationName)
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+	auto* animation = cache->GetResource<Animation>(animationName);
+	if (!animation)
+		return false;
+
+	auto compressed = MakeShared<CompressedAnimation>(context_);
+	if (!compressed->Compress(animation, settings_))
+		return false;
+
+	// The cooked clip goes next to the source, where CompressedAnimation::LoadClip looks for it
+	const ea::string fileName = ReplaceExtension(cache->GetResourceFileName(animationName), ".cani");
+	File file(context_);
+	if (!file.Open(fileName, FILE_WRITE) || !compressed->Save(file))
+	{
+		URHO3D_LOGERROR("Could not write {}", fileName);
+		return false;
+	}
+
+	unsigned sourceKeys = 0;
+	for (const auto& pair : animation->GetTracks())
+		sourceKeys += pair.second.GetNumKeyFrames();
+
+	PrintLine(Format("{}: {} -> {} keys, {} -> {} bytes, max error {:.3f} deg {:.4f} units", animationName, sourceKeys,
+		compressed->GetNumKeys(), animation->GetMemoryUse(), compressed->GetMemoryUse(), compressed->GetMaxRotationError(),
+		compressed->GetMaxTranslationError()));
+	return true;
+}
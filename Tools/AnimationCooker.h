@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+
+#include "CompressedAnimation.h"
+
+using namespace Urho3D;
+
+namespace MonsterDolls
+{
+	/// Offline cooker turning .ani clips into keyframe reduced, quantized .cani files next to them.
+	class AnimationCooker : public Application
+	{
+		URHO3D_OBJECT(AnimationCooker, Application);
+
+	public:
+		/// Construct.
+		explicit AnimationCooker(Context* context);
+
+		/// Setup before engine initialization. Runs headless without sound.
+		void Setup() override;
+		/// Cook the clips and exit.
+		void Start() override;
+
+	private:
+		/// Parse tolerances and clip names from the command line.
+		void ParseArguments();
+		/// Cook one clip, return success.
+		bool Cook(const ea::string& animationName);
+
+		/// Cooking tolerances.
+		AnimationCompressionSettings settings_;
+		/// Resource names of the clips to cook.
+		ea::vector<ea::string> animationNames_;
+	};
+}